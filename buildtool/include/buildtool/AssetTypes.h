@@ -4,7 +4,7 @@
 #include <fstream>
 
 #include "pugixml.hpp"
-#include "utility.h"
+#include "buildtool/Utility.h"
 
 
 namespace btools
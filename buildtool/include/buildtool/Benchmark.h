@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace btools
+{
+
+/**
+ * @brief Decodes every block of a compiled CGFB file, first one at a time and then all at once in
+ * parallel, and reports the compression ratio and decode throughput of each codec used. Stored blocks are
+ * read from the mapped file in place, so are reported as zero-copy and left out of the parallel run.
+ * @return The compiler's exit code
+ */
+int BenchmarkContentFile(const char* contentFile);
+
+/**
+ * @brief Writes scratch files of 1 MB up to maxMegabytes to the temp directory, and compares how quickly
+ * FileContents ingests them, read and mapped, against the chunked reader it replaced
+ * @return The compiler's exit code
+ */
+int BenchmarkFileIngest(uint64_t maxMegabytes);
+
+}
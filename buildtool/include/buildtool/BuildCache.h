@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "cgfb/CGFB.h"
+#include "cgfb/Hash.h"
+
+
+namespace btools
+{
+
+/**
+ * @brief The version of the build cache's layout; caches written in any other version are ignored
+ */
+constexpr uint32_t BUILD_CACHE_VERSION = 1;
+
+
+/**
+ * @brief Accumulates a hash of everything a cooked block depends on: its source's contents, the version
+ * of the cooker and the options it's cooked with. A block whose key hasn't changed since the last build
+ * doesn't need to be cooked again.
+ */
+class CookKey
+{
+public:
+	/**
+	 * @brief Adds integral, floating point and enum values
+	 */
+	template<typename T>
+	std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, CookKey&> Add(T value)
+	{
+		return AddBytes(std::span<const char>((const char*)&value, sizeof(value)));
+	}
+
+	/**
+	 * @brief Adds a string, prefixed with its length so consecutive strings can't be mistaken for one another
+	 */
+	CookKey& AddString(std::string_view string)
+	{
+		Add((uint64_t)string.size());
+
+		return AddBytes(std::span<const char>(string.data(), string.size()));
+	}
+
+	CookKey& AddBytes(std::span<const char> bytes)
+	{
+		m_Hash = cgfb::HashBytes(bytes.data(), bytes.size(), m_Hash);
+
+		return *this;
+	}
+
+	inline uint64_t Get() const
+	{
+		return m_Hash;
+	}
+
+private:
+	uint64_t m_Hash = cgfb::HashName("cgfb_compiler");
+};
+
+
+/**
+ * @brief Remembers the key each block of a pack was cooked from, in a file next to the pack named
+ * <pack>.buildcache, so the next build can copy blocks whose keys are unchanged straight out of the
+ * previous pack rather than cooking them again
+ */
+class BuildCache
+{
+public:
+	BuildCache() = default;
+
+	BuildCache(const BuildCache& other) = delete;
+
+	BuildCache& operator=(const BuildCache& other) = delete;
+
+	/**
+	 * @brief Loads the cache written by the previous build of packPath, and maps the pack itself
+	 * @return Whether a usable cache was found; if not, every block is cooked
+	 */
+	bool Open(const std::string& packPath);
+
+	/**
+	 * @brief Releases the previous pack, so that it can be replaced
+	 */
+	void Close();
+
+	/**
+	 * @brief Finds the block named name if the previous pack holds it, cooked from key; safe to call from any thread
+	 * @param entry Receives the block's directory entry
+	 * @param stored Receives the block exactly as it's stored, i.e. still compressed, which is valid until Close()
+	 * @return Whether the block was found
+	 */
+	bool Find(const std::string& name,
+		cgfb::BlockKind kind,
+		uint64_t key,
+		const cgfb::DirectoryEntry** entry,
+		std::span<const char>* stored) const;
+
+	/**
+	 * @brief Records the key a block of the pack being built was cooked from
+	 */
+	void Record(const std::string& name, uint64_t key);
+
+	/**
+	 * @brief Writes the keys recorded for the pack at packPath
+	 * @return Whether the cache was written
+	 */
+	bool Save(const std::string& packPath) const;
+
+	/**
+	 * @brief Deletes the cache of the pack at packPath. A cache must never outlive the pack it describes,
+	 * so it's deleted before the pack is replaced.
+	 */
+	static void Remove(const std::string& packPath);
+
+	static std::string GetCachePath(const std::string& packPath);
+
+private:
+	std::unordered_map<std::string, uint64_t> m_PreviousKeys;
+	std::unique_ptr<cgfb::CgfbFileReader> m_PreviousPack;
+	std::vector<std::pair<std::string, uint64_t>> m_Keys;
+};
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cgfb/CGFB.h"
+#include "cgfb/MeshFormat.h"
+
+
+namespace btools
+{
+
+/**
+ * @brief The version of the mesh cooker, which must be bumped whenever it changes what it writes for the
+ * same source and settings, so that incremental builds cook meshes again
+ */
+constexpr uint32_t MESH_COOKER_VERSION = 1;
+
+
+/**
+ * @brief A simplified level of detail of a cooked mesh, with a submesh for each of the mesh's submeshes
+ */
+struct CookedMeshLod
+{
+	cgfb::MeshLod Info;
+	std::vector<cgfb::MeshSubmesh> Submeshes;
+};
+
+
+/**
+ * @brief A mesh imported from its source file, in the layout it's cooked into. Every mesh in the
+ * source file becomes a submesh sharing the same vertex and index data.
+ */
+struct CookedMesh
+{
+	std::vector<cgfb::MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<cgfb::MeshSubmesh> Submeshes;
+
+	/**
+	 * @brief Levels of detail beyond the full detail mesh described by Submeshes, in decreasing detail
+	 */
+	std::vector<CookedMeshLod> Lods;
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+};
+
+
+/**
+ * @brief The optimizations applied to each submesh of a cooked mesh, which the project descriptor
+ * specifies like <MeshOptimization VertexCache="true" Overdraw="true" VertexFetch="true"/>
+ */
+struct MeshOptimizationSettings
+{
+	/**
+	 * @brief Reorders triangles to make better use of the post-transform vertex cache
+	 */
+	bool VertexCache = true;
+
+	/**
+	 * @brief Reorders clusters of triangles to reduce overdraw, trading up to OverdrawThreshold times
+	 * the vertex cache's miss ratio for it
+	 */
+	bool Overdraw = false;
+	float OverdrawThreshold = 1.05f;
+
+	/**
+	 * @brief Reorders vertices into the order they're first referenced in, dropping unused vertices
+	 */
+	bool VertexFetch = true;
+};
+
+
+/**
+ * @brief The levels of detail generated for a cooked mesh, which the project descriptor specifies like
+ * <LodChain Ratios="0.5 0.25 0.1" ScreenSizes="0.4 0.2 0.05" MaxError="0.05"/>
+ */
+struct MeshLodSettings
+{
+	/**
+	 * @brief The fraction of LOD 0's triangles targeted by each level of detail
+	 */
+	std::vector<float> Ratios;
+
+	/**
+	 * @brief The projected size, as a fraction of the screen's height, below which each level of
+	 * detail is drawn; defaults to the level's ratio
+	 */
+	std::vector<float> ScreenSizes;
+
+	/**
+	 * @brief The largest deviation simplification may introduce, relative to the mesh's extents
+	 */
+	float MaxError = 0.05f;
+};
+
+
+/**
+ * @brief How well a mesh's index order uses the post-transform vertex cache, summed across its submeshes
+ */
+struct VertexCacheStats
+{
+	/**
+	 * @brief The average number of vertices transformed per triangle (the average cache miss ratio)
+	 */
+	float ACMR = 0.0f;
+
+	/**
+	 * @brief The average number of times each vertex referenced by an index is transformed
+	 */
+	float ATVR = 0.0f;
+};
+
+
+/**
+ * @brief Imports a mesh from the contents of a source file (i.e. an FBX file)
+ * @param formatHint The source file's extension, without the leading dot
+ * @return Whether the mesh was imported; if not, error describes why
+ */
+bool ImportMesh(const char* data, size_t size, const char* formatHint, CookedMesh* out, std::string* error);
+
+/**
+ * @brief Reorders each submesh's triangles and vertices as requested by settings
+ */
+void OptimizeMesh(CookedMesh* mesh, const MeshOptimizationSettings& settings);
+
+/**
+ * @brief Generates a simplified level of detail of each of the mesh's submeshes per requested ratio.
+ * Levels of detail are appended to the mesh's index data and share its vertices, so this must run
+ * after vertices have been reordered.
+ */
+void GenerateLods(CookedMesh* mesh, const MeshLodSettings& settings);
+
+/**
+ * @brief Simulates drawing the mesh through a FIFO post-transform vertex cache of cacheSize entries
+ */
+VertexCacheStats AnalyzeVertexCache(const CookedMesh& mesh, unsigned int cacheSize = 16);
+
+/**
+ * @brief Parses the name of a vertex attribute format as it's written in the project descriptor,
+ * i.e. "Unorm16x4" for PositionFormat::Unorm16x4
+ * @return Whether the name was recognized
+ */
+bool ParsePositionFormat(std::string_view name, cgfb::PositionFormat* out);
+bool ParseNormalFormat(std::string_view name, cgfb::NormalFormat* out);
+bool ParseUVFormat(std::string_view name, cgfb::UVFormat* out);
+
+/**
+ * @brief Writes a cooked mesh block in the layout described by cgfb/MeshFormat.h, encoding its
+ * vertices in the given format. Indices are narrowed to 16 bits when every submesh's vertices can
+ * be addressed with them.
+ */
+void WriteCookedMesh(cgfb::CgfbWriter& out, const CookedMesh& mesh, const cgfb::VertexFormat& format = {});
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "cgfb/CGFB.h"
+#include "cgfb/TextureFormat.h"
+#include "cgfb/ThreadPool.h"
+
+
+namespace btools
+{
+
+/**
+ * @brief Bumped whenever the texture cooker's output changes for the same image and settings, i.e. when
+ * an encoder is improved, so that textures cached by earlier builds are cooked again
+ */
+constexpr uint32_t TEXTURE_COOKER_VERSION = 1;
+
+
+/**
+ * @brief An uncompressed RGBA8 image
+ */
+struct TextureImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels;
+};
+
+
+/**
+ * @brief How a texture is cooked, which the project descriptor specifies like
+ * <TextureEncoding Format="BC7" SRGB="true" Mips="true"/>
+ */
+struct TextureSettings
+{
+	cgfb::TextureEncoding Encoding = cgfb::TextureEncoding::RGBA8;
+
+	/**
+	 * @brief Whether color channels are in the sRGB color space. Mip levels of sRGB textures are
+	 * filtered in linear space.
+	 */
+	bool SRGB = true;
+
+	bool GenerateMips = true;
+};
+
+
+/**
+ * @brief Parses the name of a texture encoding as it's written in the project descriptor, i.e. "BC7"
+ * @return Whether the name was recognized
+ */
+bool ParseTextureEncoding(std::string_view name, cgfb::TextureEncoding* out);
+
+const char* GetTextureEncodingName(cgfb::TextureEncoding encoding);
+
+/**
+ * @brief Generates the full mip chain of an image, down to 1x1, with an alpha-weighted box filter. Each
+ * level's rows are filtered in parallel.
+ * @return Every mip level, starting with the image itself
+ */
+std::vector<TextureImage> GenerateMipChain(TextureImage image, bool srgb, cgfb::ThreadPool* pool = nullptr);
+
+/**
+ * @brief Encodes an image, compressing each 4x4 block of pixels in parallel for block compressed
+ * encodings. Blocks overhanging the image's edges repeat its edge pixels.
+ */
+std::vector<uint8_t> EncodeImage(const TextureImage& image, cgfb::TextureEncoding encoding, cgfb::ThreadPool* pool = nullptr);
+
+/**
+ * @brief Encodes every mip level like EncodeImage(), spreading the blocks of all levels across the pool at once
+ * @return Each level's encoded data, in the same order as mips
+ */
+std::vector<std::vector<uint8_t>> EncodeMipChain(const std::vector<TextureImage>& mips, cgfb::TextureEncoding encoding, cgfb::ThreadPool* pool = nullptr);
+
+/**
+ * @brief Encodes each mip level and writes a cooked texture block in the layout described by
+ * cgfb/TextureFormat.h
+ */
+void WriteCookedTexture(cgfb::CgfbWriter& out, const std::vector<TextureImage>& mips, const TextureSettings& settings, cgfb::ThreadPool* pool = nullptr);
+
+/**
+ * @brief Writes a cooked texture block from mip levels already encoded by EncodeMipChain()
+ */
+void WriteCookedTexture(cgfb::CgfbWriter& out, 
+	const std::vector<TextureImage>& mips, 
+	const std::vector<std::vector<uint8_t>>& encodedMips, 
+	const TextureSettings& settings);
+
+}
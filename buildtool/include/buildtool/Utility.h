@@ -1,11 +1,94 @@
 #pragma once
 
-#define FILE_READ_CHUNK_SIZE (1 << 18)
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "cgfb/MappedFile.h"
 
 
 namespace btools
 {
 
-void ReadFileContents(const char* filePath, char** buff, int* buffSize);
+/**
+ * @brief Files at least this large are mapped by FileContents rather than read, as faulting their pages
+ * in on demand is cheaper than copying them into a buffer
+ */
+constexpr size_t FILE_MAP_THRESHOLD = 1024 * 1024;
+
+
+enum class FileReadMode
+{
+	/**
+	 * @brief Maps files of at least FILE_MAP_THRESHOLD bytes and reads smaller ones
+	 */
+	Auto,
+
+	/**
+	 * @brief Reads the whole file into a buffer with a single read
+	 */
+	Read,
+
+	/**
+	 * @brief Maps the file, falling back on reading it if it can't be mapped
+	 */
+	Map
+};
+
+
+/**
+ * @brief The bytes of a whole source file, sized from the file system up front and either read into a
+ * buffer owned by the object or mapped, so cookers can be handed them without copying. Opening files is
+ * safe from any thread.
+ */
+class FileContents
+{
+public:
+	FileContents() = default;
+
+	FileContents(const char* filePath, FileReadMode mode = FileReadMode::Auto);
+
+	FileContents(const FileContents& other) = delete;
+
+	FileContents& operator=(const FileContents& other) = delete;
+
+	/**
+	 * @brief Reads or maps the file at filePath, releasing any file previously held
+	 * @return Whether the file was opened. Empty files open successfully, with no bytes.
+	 */
+	bool Open(const char* filePath, FileReadMode mode = FileReadMode::Auto);
+
+	void Close();
+
+	inline const char* GetData() const
+	{
+		return m_Mapping.IsOpen() ? m_Mapping.GetData() : m_Buffer.data();
+	}
+
+	inline size_t GetSize() const
+	{
+		return m_Mapping.IsOpen() ? m_Mapping.GetSize() : m_Buffer.size();
+	}
+
+	inline std::span<const char> GetBytes() const
+	{
+		return std::span<const char>(GetData(), GetSize());
+	}
+
+	inline bool IsOpen() const
+	{
+		return m_Open;
+	}
+
+	inline bool IsMapped() const
+	{
+		return m_Mapping.IsOpen();
+	}
+
+private:
+	bool m_Open = false;
+	std::vector<char> m_Buffer;
+	cgfb::MappedFile m_Mapping;
+};
 	
-}
\ No newline at end of file
+}
@@ -1,24 +1,170 @@
 #pragma once
 
 #include <unordered_map>
+#include <algorithm>
 #include <type_traits>
+#include <string_view>
 #include <fstream>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <span>
+
+#include "cgfb/MappedFile.h"
+#include "cgfb/Compression.h"
+#include "cgfb/ThreadPool.h"
+#include "cgfb/Hash.h"
 
 
 /**
  * @brief The current CGFB implementation is a bit of a hack job as unforeseen functionality kept arising.
- * It will be overhauled in the future, once the performance hit is non-negligible. 
- * 
+ * It will be overhauled in the future, once the performance hit is non-negligible.
+ *
  */
 namespace cgfb
 {
+
+/**
+ * @brief Identifies v2+ CGFB files; reads as "CGFB" in a hex editor. v1 files have no header.
+ */
+constexpr uint32_t CGFB_MAGIC = 0x42464743;
+
+/**
+ * @brief The format version written by CgfbFileWriter
+ */
+constexpr uint32_t CGFB_VERSION = 2;
+
+/**
+ * @brief The block alignment used when none is requested
+ */
+constexpr uint32_t CGFB_DEFAULT_ALIGNMENT = 16;
+
+/**
+ * @brief Blocks read as a batch are merged into a single read when they're separated by no more than this
+ * many bytes, as reading through a small gap is cheaper than seeking past it
+ */
+constexpr uint64_t CGFB_COALESCE_GAP = 256 * 1024;
+
+/**
+ * @brief CgfbFileWriter gathers writes into a buffer of this many bytes, so the file is written in a few
+ * large chunks however small the blocks are, and however large the pack grows
+ */
+constexpr size_t CGFB_WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+
+/**
+ * @brief The type of asset stored in a block, so readers can validate what they're decoding
+ */
+enum class BlockKind : uint32_t
+{
+	Raw,
+	Material,
+	Mesh,
+	Texture,
+
+	/**
+	 * @brief A list of assets which are loaded together; see cgfb/ManifestFormat.h
+	 */
+	Manifest,
+
+	/**
+	 * @brief The assets each asset depends on; see cgfb/ManifestFormat.h
+	 */
+	Dependencies
+};
+
+
+/**
+ * @brief Describes a block while it's being written, and blocks of v1 files, whose directories
+ * are serialized maps of names to block infos
+ */
 struct BlockInfo
 {
 	std::string Name;
-	int StartIndex;
-	int Size;
+
+	/**
+	 * @brief Absolute offset of the block's payload from the start of the file
+	 */
+	uint64_t Offset = 0;
+
+	/**
+	 * @brief The size of the block as stored in the file, i.e. after compression
+	 */
+	uint64_t Size = 0;
+	uint64_t UncompressedSize = 0;
+	uint32_t Alignment = 1;
+	BlockKind Kind = BlockKind::Raw;
+	CompressionCodec Compression = CompressionCodec::None;
+
+	/**
+	 * @brief The time spent compressing the block, in seconds
+	 */
+	double EncodeTime = 0.0;
+};
+
+
+/**
+ * @brief A single entry of a v2+ block directory. Directories are an array of entries sorted by name
+ * hash followed by a table of the entries' names, so they're searched in place rather than parsed.
+ *
+ * Entries are read straight out of the file's bytes and so must match their serialized layout exactly.
+ */
+struct DirectoryEntry
+{
+	uint64_t NameHash;
+	uint64_t Offset;
+	uint64_t Size;
+	uint64_t UncompressedSize;
+	uint32_t NameOffset;
+	uint32_t NameLength;
+	uint32_t Alignment;
+	BlockKind Kind;
+	CompressionCodec Compression;
+	uint32_t Reserved;
+};
+
+static_assert(sizeof(DirectoryEntry) == 56, "DirectoryEntry must match its serialized size");
+
+
+/**
+ * @brief A contiguous span of a file covering one or more blocks, which is read as a single request
+ */
+struct BlockRange
+{
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+
+	/**
+	 * @brief The first block the range covers, as an index into the entries it was coalesced from
+	 */
+	size_t FirstBlock = 0;
+	size_t BlockCount = 0;
+};
+
+
+/**
+ * @brief Groups blocks into the ranges they're read with, merging neighbouring blocks separated by no
+ * more than maxGap bytes
+ * @param entries Blocks sorted by offset
+ */
+std::vector<BlockRange> CoalesceBlocks(std::span<const DirectoryEntry* const> entries, uint64_t maxGap = CGFB_COALESCE_GAP);
+
+
+/**
+ * @brief The fixed-size header at the start of every v2+ CGFB file. The block directory is
+ * written after all block payloads so blocks can be emitted before the directory is known.
+ */
+struct CgfbHeader
+{
+	uint32_t Magic = CGFB_MAGIC;
+	uint32_t Version = CGFB_VERSION;
+	uint64_t DirectoryOffset = 0;
+	uint64_t DirectorySize = 0;
+	uint64_t BlockCount = 0;
+
+	static constexpr uint64_t SerializedSize = 32;
 };
 
 
@@ -27,8 +173,31 @@ class AbstractStream
 public:
 	AbstractStream() = default;
 
-	virtual inline int GetPosition() = 0;
-	virtual inline void SetPosition(int position) = 0;
+	virtual inline int64_t GetPosition() = 0;
+	virtual inline void SetPosition(int64_t position) = 0;
+
+	/**
+	 * @brief The CGFB version whose encoding rules the stream follows. Version 1 writes every
+	 * integral and length prefix as 32 bits; version 2 widens 64-bit integrals and length prefixes.
+	 */
+	inline uint32_t GetFormatVersion() const
+	{
+		return m_FormatVersion;
+	}
+
+	inline void SetFormatVersion(uint32_t version)
+	{
+		m_FormatVersion = version;
+	}
+
+protected:
+	template<typename T>
+	inline bool IsWide() const
+	{
+		return sizeof(T) > sizeof(int32_t) && m_FormatVersion >= 2;
+	}
+
+	uint32_t m_FormatVersion = CGFB_VERSION;
 };
 
 
@@ -39,13 +208,31 @@ class CgfbWriter : public AbstractStream
 {
 public:
 	/**
-	 * @brief Writes integral types as signed 32-bit integers
+	 * @brief Writes integral types as signed 32-bit integers, or 64-bit integers if T is 64 bits wide
+	 * and the stream is version 2 or above
 	 */
 	template <typename T>
 	std::enable_if_t<std::is_integral_v<T>> Write(T value)
 	{
+		if(IsWide<T>())
+		{
+			int64_t i64Value = value;
+			WriteToStream((const char*)&i64Value, sizeof(i64Value));
+
+			return;
+		}
+
 		int32_t i32Value = value;
-		WriteToStream((char*)&i32Value, sizeof(i32Value));
+		WriteToStream((const char*)&i32Value, sizeof(i32Value));
+	}
+
+	/**
+	 * @brief Writes enums as their underlying integral type
+	 */
+	template <typename T>
+	std::enable_if_t<std::is_enum_v<T>> Write(T value)
+	{
+		Write((std::underlying_type_t<T>)value);
 	}
 
 	/**
@@ -55,7 +242,7 @@ public:
 	std::enable_if_t<std::is_floating_point_v<T>> Write(T value)
 	{
 		float f32Value = value;
-		WriteToStream((char*)&f32Value, sizeof(f32Value));
+		WriteToStream((const char*)&f32Value, sizeof(f32Value));
 	}
 
 	/**
@@ -64,16 +251,15 @@ public:
 	template <typename T>
 	std::enable_if_t<std::is_same_v<T, const char *>> Write(T value)
 	{
-		int len = strlen(value);
-		Write(len);
+		WriteLength(strlen(value));
 
-		WriteToStream((char*)value, len);
+		WriteToStream(value, strlen(value));
 	}
 
 	/**
 	 * @brief Writes count bytes from data
 	 */
-	void Write(char* data, int count)
+	void Write(const char* data, size_t count)
 	{
 		WriteToStream(data, count);
 	}
@@ -84,9 +270,9 @@ public:
 	template<typename T>
 	void Write(const std::vector<T>& vector)
 	{
-		Write(vector.size());
+		WriteLength(vector.size());
 
-		WriteToStream((char*)vector.data(), vector.size() * sizeof(T));
+		WriteToStream((const char*)vector.data(), vector.size() * sizeof(T));
 	}
 
 	/**
@@ -95,19 +281,50 @@ public:
 	template <typename T>
 	std::enable_if_t<std::is_same_v<T, std::string>> Write(T value)
 	{
-		Write(value.size());
+		WriteLength(value.size());
 
 		WriteToStream(value.data(), value.size());
 	}
 
 	/**
-	 * @brief Writes a standard string
+	 * @brief Writes a v1 directory's block location
 	 */
 	template <typename T>
 	std::enable_if_t<std::is_same_v<T, BlockInfo>> Write(T value)
 	{
-		Write(value.StartIndex);
+		Write((int32_t)value.Offset);
+		Write((int32_t)value.Size);
+	}
+
+	/**
+	 * @brief Writes a v2+ directory entry
+	 */
+	template <typename T>
+	std::enable_if_t<std::is_same_v<T, DirectoryEntry>> Write(T value)
+	{
+		Write(value.NameHash);
+		Write(value.Offset);
 		Write(value.Size);
+		Write(value.UncompressedSize);
+		Write(value.NameOffset);
+		Write(value.NameLength);
+		Write(value.Alignment);
+		Write(value.Kind);
+		Write(value.Compression);
+		Write(value.Reserved);
+	}
+
+	/**
+	 * @brief Writes a v2+ file header
+	 */
+	template <typename T>
+	std::enable_if_t<std::is_same_v<T, CgfbHeader>> Write(T value)
+	{
+		Write(value.Magic);
+		Write(value.Version);
+		Write(value.DirectoryOffset);
+		Write(value.DirectorySize);
+		Write(value.BlockCount);
 	}
 
 	/**
@@ -125,31 +342,67 @@ public:
 		}
 	}
 
+	/**
+	 * @brief Writes the element count or byte length prefixed to strings and arrays
+	 */
+	void WriteLength(size_t length)
+	{
+		if(m_FormatVersion < 2)
+		{
+			Write((int32_t)length);
+			return;
+		}
+
+		Write((uint64_t)length);
+	}
+
 protected:
 	/**
 	 * @brief Writes some data into an arbitrary stream. Implementation behaviour is determined
 	 * by derived classes (i.e. CgfbFileWriter)
 	 */
-	virtual void WriteToStream(char* data, int count) = 0;
+	virtual void WriteToStream(const char* data, size_t count) = 0;
 };
 
 
 /**
- * @brief An abstract interface to read compatible C++ types from a CGFB formatted stream 
+ * @brief An abstract interface to read compatible C++ types from a CGFB formatted stream
  */
 class CgfbReader : public AbstractStream
 {
 public:
 	/**
-	 * @brief Reads a 32-bit integer from the current CGFB file into an integral variable
+	 * @brief Reads a 32-bit integer from the current CGFB file into an integral variable, or a
+	 * 64-bit integer if T is 64 bits wide and the stream is version 2 or above
 	 */
 	template <typename T>
 	std::enable_if_t<std::is_integral_v<T>> Read(T *out)
 	{
+		if(IsWide<T>())
+		{
+			int64_t i64;
+			ReadFromStream((char*)&i64, sizeof(i64));
+
+			*out = (T)i64;
+			return;
+		}
+
 		int32_t i32;
 		ReadFromStream((char*)&i32, sizeof(i32));
 
-		*out = i32;
+		*out = (T)i32;
+	}
+
+	/**
+	 * @brief Reads an enum from its underlying integral type
+	 */
+	template <typename T>
+	std::enable_if_t<std::is_enum_v<T>> Read(T *out)
+	{
+		std::underlying_type_t<T> value;
+		Read(&value);
+
+		*out = (T)value;
 	}
 
 	/**
@@ -170,28 +423,45 @@ public:
 	template <typename T>
 	std::enable_if_t<std::is_same_v<T, std::string>> Read(T* out)
 	{
-		int len;
-		Read(&len);
+		size_t len = ReadLength();
 
-		char* buff = new char[len];
-		ReadFromStream(buff, len);
-		*out = std::string(buff, len);
+		out->resize(len);
+		ReadFromStream(out->data(), len);
 	}
 
 	/**
-	 * @brief Reads a standard string from the current CGFB file
+	 * @brief Reads a v1 directory's block location
 	 */
 	template <typename T>
 	std::enable_if_t<std::is_same_v<T, BlockInfo>> Read(T* out)
 	{
-		Read(&out->StartIndex);
-		Read(&out->Size);
+		int32_t startIndex, size;
+		Read(&startIndex);
+		Read(&size);
+
+		out->Offset = startIndex;
+		out->Size = size;
+		out->Alignment = 1;
+		out->Kind = BlockKind::Raw;
+	}
+
+	/**
+	 * @brief Reads a v2+ file header
+	 */
+	template <typename T>
+	std::enable_if_t<std::is_same_v<T, CgfbHeader>> Read(T* out)
+	{
+		Read(&out->Magic);
+		Read(&out->Version);
+		Read(&out->DirectoryOffset);
+		Read(&out->DirectorySize);
+		Read(&out->BlockCount);
 	}
 
 	/**
 	 * @brief Reads a string of bytes
 	 */
-	void Read(char* buff, int count)
+	void Read(char* buff, size_t count)
 	{
 		ReadFromStream(buff, count);
 	}
@@ -202,10 +472,9 @@ public:
 	template<typename T>
 	void Read(std::vector<T>* vector)
 	{
-		int size;
-		Read(&size);
+		size_t size = ReadLength();
 
-		vector->reserve(size);
+		vector->resize(size);
 		ReadFromStream((char*)vector->data(), size * sizeof(T));
 	}
 
@@ -231,12 +500,31 @@ public:
 		}
 	}
 
+	/**
+	 * @brief Reads the element count or byte length prefixed to strings and arrays
+	 */
+	size_t ReadLength()
+	{
+		if(m_FormatVersion < 2)
+		{
+			int32_t length;
+			Read(&length);
+
+			return length;
+		}
+
+		uint64_t length;
+		Read(&length);
+
+		return length;
+	}
+
 protected:
 	/**
 	 * @brief Reads some data from an arbitrary stream. Implementation behaviour is determined
 	 * by derived classes (i.e. CgfbFileReader)
 	 */
-	virtual void ReadFromStream(char* data, int count) = 0;
+	virtual void ReadFromStream(char* data, size_t count) = 0;
 };
 
 
@@ -251,20 +539,28 @@ public:
 	inline const std::vector<char>& GetBuffer() const
 	{
 		return m_Buffer;
-	}	
-	
-	inline void SetPosition(int position) override
+	}
+
+	/**
+	 * @brief Empties the buffer, keeping its capacity
+	 */
+	inline void Clear()
+	{
+		m_Buffer.clear();
+	}
+
+	inline void SetPosition(int64_t position) override
 	{
-		
+
 	}
 
-	inline int GetPosition() override
+	inline int64_t GetPosition() override
 	{
-		return 0;
+		return m_Buffer.size();
 	}
 
 protected:
-	void WriteToStream(char *data, int count) override;
+	void WriteToStream(const char *data, size_t count) override;
 
 private:
 	std::vector<char> m_Buffer;
@@ -273,11 +569,18 @@ private:
 
 /**
  * @brief Reads compatible values from a block of memory containing CGFB data
+ *
+ * Besides copying reads, string and byte-array fields can be read as views into the
+ * underlying buffer. Views remain valid for as long as the buffer does, i.e. the lifetime
+ * of this reader if it owns its block, or that of the mapped file the block was read from.
  */
 class CgfbMemoryReader : public CgfbReader
 {
 public:
-	CgfbMemoryReader(char* buffer, int bufferSize);
+	/**
+	 * @brief Reads from a buffer owned by the caller
+	 */
+	CgfbMemoryReader(const char* buffer, size_t bufferSize, uint32_t formatVersion = CGFB_VERSION);
 
 	CgfbMemoryReader(struct CgfbBlock&& block);
 
@@ -285,28 +588,73 @@ public:
 
 	~CgfbMemoryReader();
 
-	inline void SetPosition(int position) override
+	/**
+	 * @brief Reads a standard string as a view into the buffer rather than a copy
+	 */
+	void ReadView(std::string_view* out)
+	{
+		size_t len = ReadLength();
+
+		*out = std::string_view(m_Buffer + m_Position, len);
+		m_Position += len;
+	}
+
+	/**
+	 * @brief Reads count bytes as a view into the buffer rather than a copy
+	 */
+	void ReadView(std::span<const char>* out, size_t count)
 	{
-		throw;
+		*out = std::span<const char>(m_Buffer + m_Position, count);
+		m_Position += count;
 	}
 
-	inline int GetPosition() override
+	inline void SetPosition(int64_t position) override
 	{
-		throw;
-		return 0;
+		m_Position = position;
+	}
+
+	inline int64_t GetPosition() override
+	{
+		return m_Position;
 	}
 
 protected:
-	void ReadFromStream(char *data, int count) override;
+	void ReadFromStream(char *data, size_t count) override;
 
 private:
-	int m_Position = 0;
-	char* m_Buffer;
+	size_t m_Position = 0;
+	const char* m_Buffer;
+	bool m_OwnsBuffer = false;
 };
 
 
+/**
+ * @brief Writes a v2+ block directory: an entry per block sorted by name hash, then the name table
+ */
+void WriteDirectory(CgfbWriter& out, std::vector<BlockInfo> blocks);
+
+
+/**
+ * @brief Compresses a block's payload the way CgfbFileWriter stores it; safe to call from any thread
+ * @param encodeTime If given, receives the time spent compressing, in seconds
+ * @return The compressed payload, or an empty buffer if the payload is stored uncompressed because it
+ * doesn't shrink (or no codec was requested)
+ */
+std::vector<char> EncodeBlock(std::span<const char> payload, 
+	const CompressionSettings& compression, 
+	ThreadPool* pool = nullptr,
+	double* encodeTime = nullptr);
+
+
 /**
  * @brief Formats and writes compatible values into a CGFB file
+ *
+ * Files are laid out as a CgfbHeader, followed by each block's payload padded to the block's
+ * alignment, followed by the block directory.
+ *
+ * Blocks are streamed to the file as they're ended, so only the block being written and the write buffer
+ * are held in memory. The header's space is reserved up front, and it's written once the directory's
+ * location is known.
  */
 class CgfbFileWriter : public CgfbWriter
 {
@@ -315,120 +663,298 @@ public:
 
 	~CgfbFileWriter();
 
-	void StartBlock(std::string name)
+	/**
+	 * @param alignment The alignment of the block's offset within the file, i.e. 16 for SIMD-friendly
+	 * payloads or 4096 for payloads uploaded straight from a mapped page. Must be a power of two.
+	 * @param compression How the block is compressed. Readers decompress blocks transparently, though
+	 * compressed blocks can no longer be viewed in place when the file is mapped.
+	 */
+	void StartBlock(std::string name, 
+		BlockKind kind = BlockKind::Raw, 
+		uint32_t alignment = CGFB_DEFAULT_ALIGNMENT,
+		CompressionSettings compression = CompressionSettings())
 	{
 		if (m_WithinBlock)
 		{
 			EndBlock();
 		}
 
+		assert(alignment && (alignment & (alignment - 1)) == 0);
+
 		m_WithinBlock = true;
-		m_CurrentBlockName = name;
-		m_CurrentBlockStart = GetStreamSize();
+		m_CurrentBlock = BlockInfo();
+		m_CurrentBlock.Name = name;
+		m_CurrentBlock.Alignment = alignment;
+		m_CurrentBlock.Kind = kind;
+		m_CurrentCompression = compression;
+		m_BlockStream.Clear();
 	}
 
-	void EndBlock()
-	{
-		m_WithinBlock = false;
+	void EndBlock();
 
-		BlockInfo newBlock;
-		newBlock.StartIndex = m_CurrentBlockStart;
-		newBlock.Size = GetStreamSize() - m_CurrentBlockStart;
-		newBlock.Name = m_CurrentBlockName;
+	/**
+	 * @brief Writes a whole block which has already been encoded, i.e. by EncodeBlock() or as read by
+	 * CgfbFileReader::ReadStoredBlock(). Ends the current block first, if there is one.
+	 * @param info The block's name, kind, alignment, compression and uncompressed size
+	 * @param stored The block's payload exactly as it's stored in the file
+	 */
+	void WriteEncodedBlock(BlockInfo info, std::span<const char> stored);
 
-		assert(newBlock.Size > 0);
+	/**
+	 * @return Every block ended so far
+	 */
+	inline const std::vector<BlockInfo>& GetBlocks() const
+	{
+		return m_BlockData;
+	}
+
+	/**
+	 * @brief Sets the pool blocks are compressed on; by default none is, and blocks are compressed on the
+	 * writing thread
+	 */
+	inline void SetThreadPool(ThreadPool* pool)
+	{
+		m_ThreadPool = pool;
+	}
 
-		m_BlockData[m_CurrentBlockName] = newBlock;
+	/**
+	 * @return The number of bytes written after the header so far
+	 */
+	uint64_t GetStreamSize() const
+	{
+		return m_FileOffset - CgfbHeader::SerializedSize;
 	}
 
-	int GetStreamSize() const 
+	inline void SetPosition(int64_t position) override
 	{
-		return m_DataStream.GetBuffer().size();
+
 	}
 
-	inline void SetPosition(int position) override
+	inline int64_t GetPosition() override
 	{
-		
+		return m_FileOffset;
 	}
 
-	inline int GetPosition() override
+	/**
+	 * @brief Ends the current block, writes the directory and patches the header. Only the first call has any effect.
+	 * @return Whether the whole file was written successfully
+	 */
+	bool Flush();
+
+protected:
+	void WriteToStream(const char* data, size_t count) override;
+
+	/**
+	 * @return The offset from the start of the file that the next write will land at
+	 */
+	uint64_t GetFileOffset() const
 	{
-		return m_File.tellp();
+		return m_FileOffset;
 	}
 
-	void Flush()
+	/**
+	 * @brief Zero-fills the file until the next write is aligned to alignment bytes
+	 */
+	void Pad(uint32_t alignment)
 	{
-		if(m_WithinBlock)
+		static const char zeros[4096] = {};
+
+		uint64_t padding = (alignment - GetFileOffset() % alignment) % alignment;
+
+		while(padding > 0)
 		{
-			EndBlock();
+			uint64_t count = std::min<uint64_t>(padding, sizeof(zeros));
+			WriteToFile(zeros, count);
+			padding -= count;
 		}
+	}
 
-		CgfbMemoryWriter fileData;
-		fileData.Write(m_BlockData);
-		fileData.Write((char*)m_DataStream.GetBuffer().data(), (int)m_DataStream.GetBuffer().size());
+	/**
+	 * @brief Appends count bytes to the file, through the write buffer unless they'd fill it by themselves
+	 */
+	void WriteToFile(const char* data, size_t count);
 
-		m_File.write(fileData.GetBuffer().data(), fileData.GetBuffer().size());
-	}
-	
-protected:
-	void WriteToStream(char* data, int count) override;
+	/**
+	 * @brief Writes out everything gathered in the write buffer
+	 */
+	void FlushWriteBuffer();
 
 private:
 	bool m_WithinBlock = false;
-	std::string m_CurrentBlockName;
-	int m_CurrentBlockStart;
-	CgfbMemoryWriter m_DataStream;
-	std::unordered_map<std::string, BlockInfo> m_BlockData;
+	bool m_Flushed = false;
+	BlockInfo m_CurrentBlock;
+	CompressionSettings m_CurrentCompression;
+	CgfbMemoryWriter m_BlockStream;
+	std::vector<char> m_WriteBuffer;
+	uint64_t m_FileOffset = 0;
+	ThreadPool* m_ThreadPool = nullptr;
+	std::vector<BlockInfo> m_BlockData;
 	std::ofstream m_File;
 };
 
 
+/**
+ * @brief The contents of a single block. Blocks read from a mapped file don't own their data;
+ * they view directly into the mapping instead.
+ */
 struct CgfbBlock
 {
 	CgfbBlock() = default;
 
-	CgfbBlock(char* data, size_t count);
+	CgfbBlock(const char* data, size_t count, bool ownsData = true);
 
 	CgfbBlock(const CgfbBlock& other) = delete;
-	
+
+	CgfbBlock(CgfbBlock&& other);
+
 	~CgfbBlock();
 
 	CgfbBlock& operator=(const CgfbBlock& other) = delete;
-	
-	char* Data = nullptr;
+
+	CgfbBlock& operator=(CgfbBlock&& other);
+
+	const char* Data = nullptr;
 	size_t Count = 0;
+	bool OwnsData = true;
+	BlockKind Kind = BlockKind::Raw;
+
+	/**
+	 * @brief The version of the file the block was read from, which determines how its contents are decoded
+	 */
+	uint32_t FormatVersion = CGFB_VERSION;
+};
+
+
+enum class CgfbReadMode
+{
+	/**
+	 * @brief Blocks are read through a file stream into a buffer owned by each block
+	 */
+	Stream,
+
+	/**
+	 * @brief The file is memory-mapped and blocks are non-owning views into the mapping
+	 */
+	Mapped
 };
 
 
 /**
- * @brief Reads compatible values from a CGFB file
+ * @brief Reads compatible values from a CGFB file. Both headerless v1 files and v2 files are supported.
  */
 class CgfbFileReader : public CgfbReader
 {
 public:
-	CgfbFileReader(const char* filePath);
-	
-	void SeekStreamPosition(int position, std::ios_base::seekdir way = std::ios_base::beg);	
+	/**
+	 * @throws std::runtime_error if the file can't be opened, or mapped in CgfbReadMode::Mapped, or if its
+	 * header or directory is unsupported or runs past the end of the file, e.g. as it was truncated. Reads
+	 * running past the end of the file throw likewise.
+	 */
+	CgfbFileReader(const char* filePath, CgfbReadMode mode = CgfbReadMode::Stream);
+
+	void SeekStreamPosition(int64_t position, std::ios_base::seekdir way = std::ios_base::beg);
+
+	/**
+	 * @brief Finds a block's directory entry with a binary search over the directory
+	 * @return The block's entry; nullptr if no block is named blockName
+	 */
+	const DirectoryEntry* FindBlock(std::string_view blockName) const;
+
+	/**
+	 * @return Whether the block was found
+	 * @throws std::runtime_error if the block is corrupt, see ReadBlock(const DirectoryEntry&, CgfbBlock&)
+	 */
+	bool ReadBlock(std::string_view blockName, CgfbBlock& out);
 
-	void ReadBlock(std::string blockName, CgfbBlock& out);
+	/**
+	 * @brief Reads a block, decompressing it if it's compressed
+	 * @throws std::runtime_error if the block fails to decompress, naming the block
+	 */
+	void ReadBlock(const DirectoryEntry& entry, CgfbBlock& out);
+
+	/**
+	 * @brief Reads a block exactly as it's stored in the file, without decompressing it
+	 */
+	void ReadStoredBlock(const DirectoryEntry& entry, CgfbBlock& out);
+
+	/**
+	 * @brief Reads several blocks at once in file order, coalescing neighbouring blocks into single reads,
+	 * then decompresses compressed blocks in parallel
+	 * @return Whether every block was found; blocks which weren't are left empty
+	 * @throws std::runtime_error if any block fails to decompress, once every other block is decoded
+	 */
+	bool ReadBlocks(std::span<const std::string_view> blockNames, std::vector<CgfbBlock>& out);
+
+	/**
+	 * @brief Hints that blocks are about to be read, so the OS can start reading them in as a few large
+	 * reads in file order rather than faulting them in page by page. Returns without waiting for the reads,
+	 * and has no effect in stream mode, where ReadBlocks() coalesces reads instead.
+	 */
+	void Prefetch(std::span<const DirectoryEntry* const> entries);
+
+	/**
+	 * @brief Sets the pool blocks are decompressed on; by default none is, and blocks are decompressed on the
+	 * reading thread, so a game reading from its own jobs doesn't start a second set of workers
+	 */
+	inline void SetThreadPool(ThreadPool* pool)
+	{
+		m_ThreadPool = pool;
+	}
+
+	inline std::span<const DirectoryEntry> GetBlocks() const
+	{
+		return std::span<const DirectoryEntry>(m_Entries, m_EntryCount);
+	}
+
+	inline std::string_view GetBlockName(const DirectoryEntry& entry) const
+	{
+		return std::string_view(m_StringTable + entry.NameOffset, entry.NameLength);
+	}
+
+	inline void SetPosition(int64_t position) override
+	{
+
+	}
 
-	inline void SetPosition(int position) override
+	inline int64_t GetPosition() override
 	{
-		
+		return m_Mode == CgfbReadMode::Mapped ? m_MappedPosition : (int64_t)m_File.tellg();
 	}
 
-	inline int GetPosition() override
+	inline CgfbReadMode GetReadMode() const
 	{
-		return m_File.tellg();
+		return m_Mode;
 	}
 
 protected:
-	void ReadFromStream(char *data, int count) override;
+	void ReadFromStream(char *data, size_t count) override;
 
 private:
-	int m_BlockDataOffset = 0;
-	std::unordered_map<std::string, BlockInfo> m_BlockData;
+	/**
+	 * @brief Finishes reading a block, decompressing its stored payload into out if it's compressed
+	 */
+	void DecodeBlock(const DirectoryEntry& entry, CgfbBlock&& stored, CgfbBlock& out);
+
+	void ReadDirectory();
+
+	void ReadLegacyDirectory();
+
+	/**
+	 * @brief Throws if size bytes from offset don't lie within the file
+	 */
+	void CheckRange(uint64_t offset, uint64_t size, const char* what) const;
+
+	CgfbReadMode m_Mode;
+	const DirectoryEntry* m_Entries = nullptr;
+	const char* m_StringTable = nullptr;
+	uint64_t m_EntryCount = 0;
+	std::vector<char> m_DirectoryStorage;
 	std::ifstream m_File;
+	std::mutex m_FileMutex;
+	ThreadPool* m_ThreadPool = nullptr;
+	MappedFile m_Mapping;
+	uint64_t m_MappedPosition = 0;
+	uint64_t m_FileSize = 0;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include <span>
+
+
+namespace cgfb
+{
+
+class ThreadPool;
+
+
+enum class CompressionCodec : uint32_t
+{
+	None,
+
+	/**
+	 * @brief Fast to decode at a moderate ratio; suits assets which are loaded often, like meshes
+	 */
+	LZ4,
+
+	/**
+	 * @brief A higher ratio at a slower (though still fast) decode; suits large assets, like textures
+	 */
+	Zstd
+};
+
+
+struct CompressionSettings
+{
+	CompressionCodec Codec = CompressionCodec::None;
+
+	/**
+	 * @brief The codec-specific compression level; 0 selects the codec's default
+	 */
+	int Level = 0;
+};
+
+
+/**
+ * @brief Blocks are compressed in independent chunks of this many bytes, so a single large block
+ * can be decoded in parallel
+ */
+constexpr uint32_t COMPRESSION_CHUNK_SIZE = 1 << 20;
+
+
+/**
+ * @brief Parses a codec name as written in a project descriptor ("None", "LZ4" or "Zstd")
+ * @return Whether the name was recognized
+ */
+bool ParseCompressionCodec(std::string_view name, CompressionCodec* out);
+
+const char* GetCompressionCodecName(CompressionCodec codec);
+
+/**
+ * @brief Compresses a block's payload into a chunk table followed by each compressed chunk
+ * @param pool If not null, chunks are compressed in parallel on the pool
+ */
+std::vector<char> CompressBlock(std::span<const char> data, const CompressionSettings& settings, ThreadPool* pool = nullptr);
+
+/**
+ * @brief Decompresses a block compressed by CompressBlock into out, which must be exactly the size
+ * of the uncompressed payload
+ * @param pool If not null, chunks are decompressed in parallel on the pool
+ * @return Whether the block was decompressed successfully
+ */
+bool DecompressBlock(std::span<const char> compressed, CompressionCodec codec, std::span<char> out, ThreadPool* pool = nullptr);
+
+}
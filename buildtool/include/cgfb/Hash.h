@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+
+namespace cgfb
+{
+
+/**
+ * @brief Hashes a block of bytes with 64-bit FNV-1a, optionally continuing from a previous hash
+ */
+constexpr uint64_t HashBytes(const char* data, size_t count, uint64_t hash = 0xcbf29ce484222325ull)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		hash ^= (uint8_t)data[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+
+/**
+ * @brief Hashes a block or asset name. Stored in CGFB block directories, so this must never change
+ * without a format version bump.
+ */
+constexpr uint64_t HashName(std::string_view name)
+{
+	return HashBytes(name.data(), name.size());
+}
+
+}
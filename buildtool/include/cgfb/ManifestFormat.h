@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cgfb/CGFB.h"
+
+
+/**
+ * Besides assets, cgfb_compiler writes a dependency table, recording which assets each asset needs in
+ * order to be used, and a manifest per group of assets which are loaded together (i.e. everything a
+ * scene uses). Runtimes expand a manifest through the dependency table to find every block to preload.
+ */
+namespace cgfb
+{
+
+/**
+ * @brief The version of the dependency table and manifest layouts written by cgfb_compiler
+ */
+constexpr uint32_t MANIFEST_FORMAT_VERSION = 1;
+
+/**
+ * @brief The name of the block holding the dependency table. Names starting with '$' are reserved.
+ */
+constexpr const char* CGFB_DEPENDENCY_BLOCK = "$Dependencies";
+
+
+struct AssetDependencies
+{
+	std::string Name;
+	std::vector<std::string> Dependencies;
+};
+
+
+/**
+ * @brief Writes a dependency table: the format version and entry count, then each entry's asset name
+ * followed by the names of the assets it depends on
+ */
+inline void WriteDependencyTable(CgfbWriter& out, const std::vector<AssetDependencies>& table)
+{
+	out.Write(MANIFEST_FORMAT_VERSION);
+	out.WriteLength(table.size());
+
+	for(const AssetDependencies& entry : table)
+	{
+		out.Write(entry.Name);
+		out.WriteLength(entry.Dependencies.size());
+
+		for(const std::string& dependency : entry.Dependencies)
+		{
+			out.Write(dependency);
+		}
+	}
+}
+
+
+/**
+ * @return Whether the table was written in a supported format
+ */
+inline bool ReadDependencyTable(CgfbReader& in, std::vector<AssetDependencies>* table)
+{
+	uint32_t version;
+	in.Read(&version);
+
+	if(version != MANIFEST_FORMAT_VERSION)
+	{
+		return false;
+	}
+
+	table->resize(in.ReadLength());
+
+	for(AssetDependencies& entry : *table)
+	{
+		in.Read(&entry.Name);
+		entry.Dependencies.resize(in.ReadLength());
+
+		for(std::string& dependency : entry.Dependencies)
+		{
+			in.Read(&dependency);
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * @brief Writes a manifest: the format version and asset count, then each asset's name
+ */
+inline void WriteManifest(CgfbWriter& out, const std::vector<std::string>& assets)
+{
+	out.Write(MANIFEST_FORMAT_VERSION);
+	out.WriteLength(assets.size());
+
+	for(const std::string& asset : assets)
+	{
+		out.Write(asset);
+	}
+}
+
+
+/**
+ * @return Whether the manifest was written in a supported format
+ */
+inline bool ReadManifest(CgfbReader& in, std::vector<std::string>* assets)
+{
+	uint32_t version;
+	in.Read(&version);
+
+	if(version != MANIFEST_FORMAT_VERSION)
+	{
+		return false;
+	}
+
+	assets->resize(in.ReadLength());
+
+	for(std::string& asset : *assets)
+	{
+		in.Read(&asset);
+	}
+
+	return true;
+}
+
+}
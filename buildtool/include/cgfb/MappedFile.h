@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace cgfb
+{
+
+/**
+ * @brief A read-only view of an entire file mapped into the address space of the process.
+ *
+ * Pages are only faulted in once they're touched, and are shared through the OS page cache
+ * with any other process mapping the same file.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+
+	MappedFile(const char* filePath);
+
+	MappedFile(const MappedFile& other) = delete;
+
+	~MappedFile();
+
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	/**
+	 * @brief Maps the file at filePath, unmapping any file previously held
+	 * @return Whether the file was successfully mapped
+	 */
+	bool Open(const char* filePath);
+
+	void Close();
+
+	inline const char* GetData() const
+	{
+		return m_Data;
+	}
+
+	inline size_t GetSize() const
+	{
+		return m_Size;
+	}
+
+	/**
+	 * @brief Asks the OS to start reading a range of the file into memory ahead of it being touched,
+	 * without waiting for it to be read
+	 */
+	void Prefetch(size_t offset, size_t size) const;
+
+	inline bool IsOpen() const
+	{
+		return m_Data != nullptr;
+	}
+
+private:
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+
+#ifdef _WIN32
+	void* m_FileHandle = nullptr;
+	void* m_MappingHandle = nullptr;
+#endif
+};
+
+}
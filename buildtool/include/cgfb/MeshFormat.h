@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cgfb/CGFB.h"
+
+
+/**
+ * Cooked mesh blocks are laid out as a MeshHeader, followed by a MeshLod per level of detail, followed
+ * by a MeshSubmesh per submesh of each level of detail (all of LOD 0's submeshes first), followed by
+ * the vertex data and the index data. Every level of detail has the same number of submeshes, and
+ * they share the vertex data. Both data sections are 16-byte aligned within the block and
+ * are ready to be uploaded as they are. Vertices are tightly packed in the order position, normal,
+ * UV0, each attribute stored as described by the header's VertexFormat.
+ */
+namespace cgfb
+{
+
+/**
+ * @brief The version of the cooked mesh layout written by cgfb_compiler
+ */
+constexpr uint32_t MESH_FORMAT_VERSION = 3;
+
+
+/**
+ * @brief The layout of each vertex in a cooked mesh's vertex data when it's stored at full precision,
+ * and the layout meshes are cooked in before they're quantized
+ */
+struct MeshVertex
+{
+	float Position[3];
+	float Normal[3];
+	float UV0[2];
+};
+
+
+enum class PositionFormat : uint32_t
+{
+	Float3,
+
+	/**
+	 * @brief Normalized 16-bit coordinates relative to the mesh's bounds, with an unused fourth
+	 * component to keep the attribute 4-byte aligned
+	 */
+	Unorm16x4
+};
+
+
+enum class NormalFormat : uint32_t
+{
+	Float3,
+
+	/**
+	 * @brief Signed normalized 8-bit components, with an unused fourth component
+	 */
+	Snorm8x4,
+
+	/**
+	 * @brief A signed normalized 16-bit octahedral encoding, which shaders must decode
+	 */
+	Oct16
+};
+
+
+enum class UVFormat : uint32_t
+{
+	Float2,
+	Half2
+};
+
+
+/**
+ * @brief Describes how each attribute of a cooked mesh's vertices is stored
+ */
+struct VertexFormat
+{
+	PositionFormat Position = PositionFormat::Float3;
+	NormalFormat Normal = NormalFormat::Float3;
+	UVFormat UV0 = UVFormat::Float2;
+
+	bool operator==(const VertexFormat& other) const = default;
+};
+
+
+inline uint32_t GetPositionSize(PositionFormat format)
+{
+	return format == PositionFormat::Float3 ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+}
+
+
+inline uint32_t GetNormalSize(NormalFormat format)
+{
+	switch(format)
+	{
+	case NormalFormat::Snorm8x4: return 4 * sizeof(int8_t);
+	case NormalFormat::Oct16: return 2 * sizeof(int16_t);
+	default: return 3 * sizeof(float);
+	}
+}
+
+
+inline uint32_t GetUVSize(UVFormat format)
+{
+	return format == UVFormat::Float2 ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+}
+
+
+inline uint32_t GetVertexStride(const VertexFormat& format)
+{
+	return GetPositionSize(format.Position) + GetNormalSize(format.Normal) + GetUVSize(format.UV0);
+}
+
+
+enum class IndexFormat : uint32_t
+{
+	UInt16,
+	UInt32
+};
+
+
+/**
+ * @brief A range of a mesh's shared index buffer that's drawn with a single material. Its indices
+ * are relative to BaseVertex.
+ */
+struct MeshSubmesh
+{
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+	uint32_t BaseVertex = 0;
+	uint32_t VertexCount = 0;
+	uint32_t MaterialSlot = 0;
+};
+
+
+/**
+ * @brief A simplified version of a mesh, drawn in place of more detailed ones when the mesh's
+ * bounding sphere is projected to less than ScreenSize of the screen's height
+ */
+struct MeshLod
+{
+	float ScreenSize = 1.0f;
+
+	/**
+	 * @brief The deviation from LOD 0 introduced by simplification, relative to the mesh's extents
+	 */
+	float Error = 0.0f;
+};
+
+
+struct MeshHeader
+{
+	uint32_t Version = MESH_FORMAT_VERSION;
+	VertexFormat Format;
+	uint32_t VertexStride = sizeof(MeshVertex);
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	IndexFormat Indices = IndexFormat::UInt32;
+	uint32_t SubmeshCount = 0;
+	uint32_t LodCount = 1;
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+
+	/**
+	 * @brief Offsets of the vertex and index data from the start of the block
+	 */
+	uint64_t VertexDataOffset = 0;
+	uint64_t IndexDataOffset = 0;
+};
+
+
+inline uint32_t GetIndexSize(IndexFormat format)
+{
+	return format == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+
+inline void WriteMeshHeader(CgfbWriter& out, const MeshHeader& header)
+{
+	out.Write(header.Version);
+	out.Write(header.Format.Position);
+	out.Write(header.Format.Normal);
+	out.Write(header.Format.UV0);
+	out.Write(header.VertexStride);
+	out.Write(header.VertexCount);
+	out.Write(header.IndexCount);
+	out.Write(header.Indices);
+	out.Write(header.SubmeshCount);
+	out.Write(header.LodCount);
+
+	for(int i = 0; i < 3; i++) out.Write(header.BoundsMin[i]);
+	for(int i = 0; i < 3; i++) out.Write(header.BoundsMax[i]);
+
+	out.Write(header.VertexDataOffset);
+	out.Write(header.IndexDataOffset);
+}
+
+
+inline void ReadMeshHeader(CgfbReader& in, MeshHeader* header)
+{
+	in.Read(&header->Version);
+	in.Read(&header->Format.Position);
+	in.Read(&header->Format.Normal);
+	in.Read(&header->Format.UV0);
+	in.Read(&header->VertexStride);
+	in.Read(&header->VertexCount);
+	in.Read(&header->IndexCount);
+	in.Read(&header->Indices);
+	in.Read(&header->SubmeshCount);
+	in.Read(&header->LodCount);
+
+	for(int i = 0; i < 3; i++) in.Read(&header->BoundsMin[i]);
+	for(int i = 0; i < 3; i++) in.Read(&header->BoundsMax[i]);
+
+	in.Read(&header->VertexDataOffset);
+	in.Read(&header->IndexDataOffset);
+}
+
+
+inline void WriteMeshLod(CgfbWriter& out, const MeshLod& lod)
+{
+	out.Write(lod.ScreenSize);
+	out.Write(lod.Error);
+}
+
+
+inline void ReadMeshLod(CgfbReader& in, MeshLod* lod)
+{
+	in.Read(&lod->ScreenSize);
+	in.Read(&lod->Error);
+}
+
+
+inline void WriteMeshSubmesh(CgfbWriter& out, const MeshSubmesh& submesh)
+{
+	out.Write(submesh.FirstIndex);
+	out.Write(submesh.IndexCount);
+	out.Write(submesh.BaseVertex);
+	out.Write(submesh.VertexCount);
+	out.Write(submesh.MaterialSlot);
+}
+
+
+inline void ReadMeshSubmesh(CgfbReader& in, MeshSubmesh* submesh)
+{
+	in.Read(&submesh->FirstIndex);
+	in.Read(&submesh->IndexCount);
+	in.Read(&submesh->BaseVertex);
+	in.Read(&submesh->VertexCount);
+	in.Read(&submesh->MaterialSlot);
+}
+
+}
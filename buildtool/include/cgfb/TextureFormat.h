@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cgfb/CGFB.h"
+
+
+/**
+ * Cooked texture blocks are laid out as a TextureHeader, followed by a TextureMip per mip level (largest
+ * first), followed by each mip level's data. Mip data is 16-byte aligned within the block and is stored
+ * exactly as it's uploaded: rows of pixels for uncompressed encodings, or rows of 4x4 blocks for block
+ * compressed ones.
+ */
+namespace cgfb
+{
+
+/**
+ * @brief The version of the cooked texture layout written by cgfb_compiler
+ */
+constexpr uint32_t TEXTURE_FORMAT_VERSION = 1;
+
+
+enum class TextureEncoding : uint32_t
+{
+	RGBA8,
+
+	/**
+	 * @brief Opaque RGB at 4 bits per pixel
+	 */
+	BC1,
+
+	/**
+	 * @brief RGB with interpolated alpha at 8 bits per pixel
+	 */
+	BC3,
+
+	/**
+	 * @brief Two independent channels (red and green) at 8 bits per pixel, i.e. for normal maps
+	 */
+	BC5,
+
+	/**
+	 * @brief High quality RGBA at 8 bits per pixel
+	 */
+	BC7
+};
+
+
+struct TextureHeader
+{
+	uint32_t Version = TEXTURE_FORMAT_VERSION;
+	TextureEncoding Encoding = TextureEncoding::RGBA8;
+
+	/**
+	 * @brief Whether color channels are stored in the sRGB color space, rather than linearly
+	 */
+	uint32_t SRGB = 1;
+
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 1;
+};
+
+
+struct TextureMip
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+
+	/**
+	 * @brief The size of each row of pixels, or of 4x4 blocks for block compressed encodings
+	 */
+	uint32_t RowPitch = 0;
+
+	/**
+	 * @brief The offset of the mip level's data from the start of the block
+	 */
+	uint64_t DataOffset = 0;
+	uint64_t DataSize = 0;
+};
+
+
+/**
+ * @return The size of each 4x4 block of a block compressed encoding, or 0 for uncompressed encodings
+ */
+inline uint32_t GetBlockSize(TextureEncoding encoding)
+{
+	switch(encoding)
+	{
+	case TextureEncoding::BC1: return 8;
+	case TextureEncoding::BC3:
+	case TextureEncoding::BC5:
+	case TextureEncoding::BC7: return 16;
+	default: return 0;
+	}
+}
+
+
+inline uint32_t GetRowPitch(TextureEncoding encoding, uint32_t width)
+{
+	const uint32_t blockSize = GetBlockSize(encoding);
+
+	return blockSize ? (width + 3) / 4 * blockSize : width * 4;
+}
+
+
+inline uint64_t GetMipDataSize(TextureEncoding encoding, uint32_t width, uint32_t height)
+{
+	const uint32_t rows = GetBlockSize(encoding) ? (height + 3) / 4 : height;
+
+	return (uint64_t)GetRowPitch(encoding, width) * rows;
+}
+
+
+inline void WriteTextureHeader(CgfbWriter& out, const TextureHeader& header)
+{
+	out.Write(header.Version);
+	out.Write(header.Encoding);
+	out.Write(header.SRGB);
+	out.Write(header.Width);
+	out.Write(header.Height);
+	out.Write(header.MipCount);
+}
+
+
+inline void ReadTextureHeader(CgfbReader& in, TextureHeader* header)
+{
+	in.Read(&header->Version);
+	in.Read(&header->Encoding);
+	in.Read(&header->SRGB);
+	in.Read(&header->Width);
+	in.Read(&header->Height);
+	in.Read(&header->MipCount);
+}
+
+
+inline void WriteTextureMip(CgfbWriter& out, const TextureMip& mip)
+{
+	out.Write(mip.Width);
+	out.Write(mip.Height);
+	out.Write(mip.RowPitch);
+	out.Write(mip.DataOffset);
+	out.Write(mip.DataSize);
+}
+
+
+inline void ReadTextureMip(CgfbReader& in, TextureMip* mip)
+{
+	in.Read(&mip->Width);
+	in.Read(&mip->Height);
+	in.Read(&mip->RowPitch);
+	in.Read(&mip->DataOffset);
+	in.Read(&mip->DataSize);
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+
+namespace cgfb
+{
+
+/**
+ * @brief A fixed set of worker threads which CGFB streams use to encode and decode blocks in parallel
+ *
+ * Each worker has its own queue. Tasks submitted from a worker are queued on that worker's queue, which it
+ * takes the newest task from, so work a task spawns tends to run on the thread whose cache holds its data.
+ * Idle workers steal the oldest tasks from other workers' queues, and tasks submitted from outside the pool
+ * are shared by every worker.
+ */
+class ThreadPool
+{
+public:
+	/**
+	 * @param workerCount The number of workers; defaults to one less than the number of hardware
+	 * threads, as the thread calling ParallelFor also does work
+	 */
+	ThreadPool(unsigned int workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
+	ThreadPool(const ThreadPool& other) = delete;
+
+	~ThreadPool();
+
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	/**
+	 * @brief Queues a task to be run on the next available worker
+	 */
+	void Submit(std::function<void()> task);
+
+	/**
+	 * @brief Calls task(i) for every i in [0, count), spreading the calls across the workers and
+	 * the calling thread, and returns once all calls have completed. Safe to call from within a task.
+	 */
+	void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	inline unsigned int GetWorkerCount() const
+	{
+		return m_Workers.size();
+	}
+
+	/**
+	 * @return A pool shared by every stream which isn't given one explicitly
+	 */
+	static ThreadPool& GetShared();
+
+private:
+	struct TaskQueue
+	{
+		std::mutex Mutex;
+		std::deque<std::function<void()>> Tasks;
+	};
+
+	void RunWorker(size_t index);
+
+	/**
+	 * @brief Takes the newest task from the worker's own queue, or failing that the oldest task from any other
+	 */
+	bool TryTakeTask(size_t index, std::function<void()>& task);
+
+	bool m_Stopping = false;
+	std::atomic<size_t> m_QueuedCount = 0;
+	std::atomic<size_t> m_SleepingCount = 0;
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskAvailable;
+
+	/**
+	 * @brief A queue per worker, followed by the queue shared by threads outside the pool
+	 */
+	std::vector<std::unique_ptr<TaskQueue>> m_Queues;
+	std::vector<std::thread> m_Workers;
+};
+
+}
@@ -0,0 +1,265 @@
+#include "buildtool/Benchmark.h"
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <filesystem>
+#include <functional>
+
+#include "cgfb/CGFB.h"
+#include "buildtool/Utility.h"
+
+#define LOG(x) std::cout << x << std::endl;
+
+
+using namespace cgfb;
+
+
+namespace
+{
+
+struct CodecStats
+{
+	uint64_t BlockCount = 0;
+	uint64_t StoredBytes = 0;
+	uint64_t RawBytes = 0;
+	double DecodeTime = 0.0;
+};
+
+
+double ToMegabytes(uint64_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+
+/**
+ * @brief The chunked reader FileContents replaced, kept as the benchmark's baseline. It grows its buffer
+ * by a chunk at a time, copying everything read so far on every chunk. The original leaked each old
+ * buffer as well; this one frees them, so large files can be measured without running out of memory.
+ */
+std::vector<char> ReadChunkedBaseline(const char* filePath)
+{
+	constexpr int chunkSize = 1 << 18;
+
+	std::vector<char> chunk (chunkSize);
+	std::ifstream file (filePath, std::ios_base::binary);
+
+	char* readBuffer = nullptr;
+	size_t readBufferSize = 0;
+
+	do
+	{
+		file.read(chunk.data(), chunkSize);
+		size_t bytesRead = file.gcount();
+
+		char* resizedReadBuffer = new char[readBufferSize + bytesRead];
+
+		if(readBuffer)
+		{
+			std::memcpy(resizedReadBuffer, readBuffer, readBufferSize);
+		}
+
+		std::memcpy(resizedReadBuffer + readBufferSize, chunk.data(), bytesRead);
+
+		delete[] readBuffer;
+		readBuffer = resizedReadBuffer;
+		readBufferSize += bytesRead;
+	}
+	while(file.is_open() && !file.eof());
+
+	std::vector<char> contents (readBuffer, readBuffer + readBufferSize);
+	delete[] readBuffer;
+
+	return contents;
+}
+
+
+/**
+ * @brief Reads one byte from every page, so mapped files are faulted in as they would be by a cooker
+ */
+uint64_t TouchPages(std::span<const char> bytes)
+{
+	uint64_t sum = 0;
+
+	for(size_t i = 0; i < bytes.size(); i += 4096)
+	{
+		sum += (unsigned char)bytes[i];
+	}
+
+	return sum;
+}
+
+}
+
+
+int btools::BenchmarkContentFile(const char* contentFile)
+{
+	using Clock = std::chrono::steady_clock;
+
+	CgfbFileReader reader (contentFile, CgfbReadMode::Mapped);
+	reader.SetThreadPool(&ThreadPool::GetShared());
+
+	CodecStats stats[3];
+	uint64_t totalRawBytes = 0;
+	size_t blockCount = 0;
+
+	// The blocks which are actually decoded; stored ones are read from the mapping in place
+	std::vector<std::string_view> names;
+
+	// Blocks are first decoded one at a time, so each codec's throughput is measured in isolation
+	for(const DirectoryEntry& entry : reader.GetBlocks())
+	{
+		auto start = Clock::now();
+
+		CgfbBlock block;
+		reader.ReadBlock(entry, block);
+
+		CodecStats& codecStats = stats[(int)entry.Compression];
+		codecStats.DecodeTime += std::chrono::duration<double>(Clock::now() - start).count();
+		codecStats.BlockCount++;
+		codecStats.StoredBytes += entry.Size;
+		codecStats.RawBytes += entry.UncompressedSize;
+		blockCount++;
+
+		if(entry.Compression != CompressionCodec::None)
+		{
+			totalRawBytes += entry.UncompressedSize;
+			names.push_back(reader.GetBlockName(entry));
+		}
+	}
+
+	LOG("Read " << blockCount << " blocks from " << contentFile);
+	std::cout << std::fixed << std::setprecision(2);
+
+	for(CompressionCodec codec : { CompressionCodec::None, CompressionCodec::LZ4, CompressionCodec::Zstd })
+	{
+		const CodecStats& codecStats = stats[(int)codec];
+
+		if(codecStats.BlockCount == 0)
+		{
+			continue;
+		}
+
+		// Reading a stored block from a mapping only points into it, so its time isn't a decode rate
+		if(codec == CompressionCodec::None)
+		{
+			LOG("  " << std::setw(5) << GetCompressionCodecName(codec) << ": "
+				<< codecStats.BlockCount << " blocks, "
+				<< ToMegabytes(codecStats.RawBytes) << " MB, zero-copy");
+
+			continue;
+		}
+
+		LOG("  " << std::setw(5) << GetCompressionCodecName(codec) << ": "
+			<< codecStats.BlockCount << " blocks, "
+			<< ToMegabytes(codecStats.RawBytes) << " MB -> " << ToMegabytes(codecStats.StoredBytes) << " MB "
+			<< "(ratio " << (double)codecStats.RawBytes / codecStats.StoredBytes << "), "
+			<< ToMegabytes(codecStats.RawBytes) / codecStats.DecodeTime << " MB/s decoded");
+	}
+
+	if(names.empty())
+	{
+		return 0;
+	}
+
+	auto start = Clock::now();
+
+	std::vector<CgfbBlock> blocks;
+	reader.ReadBlocks(names, blocks);
+
+	double parallelTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+	LOG("  Parallel: " << ToMegabytes(totalRawBytes) << " MB of compressed blocks in " << parallelTime * 1000.0 << " ms, "
+		<< ToMegabytes(totalRawBytes) / parallelTime << " MB/s decoded on "
+		<< ThreadPool::GetShared().GetWorkerCount() + 1 << " threads");
+
+	return 0;
+}
+
+
+int btools::BenchmarkFileIngest(uint64_t maxMegabytes)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// The baseline's copying grows with the square of the file's size, so it's only run on smaller files
+	constexpr uint64_t baselineLimit = 128;
+	constexpr int repeatCount = 3;
+
+	std::cout << std::fixed << std::setprecision(2);
+	LOG("Ingesting files of up to " << maxMegabytes << " MB, best of " << repeatCount << " runs with a warm page cache");
+
+	for(uint64_t megabytes : { 1, 16, 128, 1024 })
+	{
+		if(megabytes > maxMegabytes)
+		{
+			break;
+		}
+
+		const uint64_t size = megabytes * 1024 * 1024;
+		const std::string path = (std::filesystem::temp_directory_path() / ("cgfb_ingest_" + std::to_string(megabytes) + ".bin")).string();
+
+		{
+			std::vector<char> chunk (4 * 1024 * 1024);
+			std::ofstream file (path, std::ios_base::binary);
+
+			for(uint64_t written = 0; written < size; written += chunk.size())
+			{
+				for(size_t i = 0; i < chunk.size(); i++)
+				{
+					chunk[i] = (char)((written + i) * 2654435761u >> 24);
+				}
+
+				file.write(chunk.data(), std::min<uint64_t>(chunk.size(), size - written));
+			}
+
+			if(!file)
+			{
+				LOG("Failed to write " << path);
+				return 1;
+			}
+		}
+
+		auto measure = [&](const char* label, const std::function<uint64_t()>& ingest)
+		{
+			double bestTime = 1e30;
+			uint64_t sum = 0;
+
+			for(int i = 0; i < repeatCount; i++)
+			{
+				auto start = Clock::now();
+				sum += ingest();
+				bestTime = std::min(bestTime, std::chrono::duration<double>(Clock::now() - start).count());
+			}
+
+			LOG("  " << std::setw(7) << megabytes << " MB " << std::setw(8) << label << ": "
+				<< bestTime * 1000.0 << " ms, " << megabytes / bestTime << " MB/s");
+
+			return sum;
+		};
+
+		uint64_t sum = 0;
+
+		if(megabytes <= baselineLimit)
+		{
+			sum += measure("Chunked", [&]() { return TouchPages(ReadChunkedBaseline(path.c_str())); });
+		}
+
+		sum += measure("Read", [&]() { return TouchPages(FileContents(path.c_str(), FileReadMode::Read).GetBytes()); });
+		sum += measure("Mapped", [&]() { return TouchPages(FileContents(path.c_str(), FileReadMode::Map).GetBytes()); });
+
+		// Keeps the pages being touched from being optimized away
+		if(sum == 0)
+		{
+			LOG("  (every sampled byte was zero)");
+		}
+
+		std::error_code error;
+		std::filesystem::remove(path, error);
+	}
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include "buildtool/BuildCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+
+using namespace btools;
+using namespace cgfb;
+
+
+bool BuildCache::Open(const std::string& packPath)
+{
+	Close();
+
+	std::error_code error;
+
+	if(!std::filesystem::exists(packPath, error) || std::filesystem::file_size(packPath, error) == 0)
+	{
+		return false;
+	}
+
+	std::ifstream file (GetCachePath(packPath), std::ios_base::binary | std::ios_base::ate);
+
+	if(!file)
+	{
+		return false;
+	}
+
+	std::vector<char> buffer (file.tellg());
+	file.seekg(0);
+	file.read(buffer.data(), buffer.size());
+
+	CgfbMemoryReader reader (buffer.data(), buffer.size());
+
+	// Reads past the end of a truncated cache are caught before they're made
+	auto remaining = [&]() { return buffer.size() - reader.GetPosition(); };
+
+	uint32_t version = 0;
+
+	if(remaining() < sizeof(uint32_t) + sizeof(uint64_t))
+	{
+		return false;
+	}
+
+	reader.Read(&version);
+	const size_t count = reader.ReadLength();
+
+	if(version != BUILD_CACHE_VERSION)
+	{
+		return false;
+	}
+
+	std::unordered_map<std::string, uint64_t> keys;
+
+	for(size_t i = 0; i < count; i++)
+	{
+		if(remaining() < sizeof(uint64_t))
+		{
+			return false;
+		}
+
+		const size_t nameLength = reader.ReadLength();
+
+		if(remaining() < nameLength + sizeof(uint64_t))
+		{
+			return false;
+		}
+
+		std::string name (nameLength, '\0');
+		reader.Read(name.data(), nameLength);
+		reader.Read(&keys[name]);
+	}
+
+	std::unique_ptr<CgfbFileReader> pack;
+
+	// A pack left truncated, e.g. by an interrupted copy, or written by a newer version has nothing to reuse
+	try
+	{
+		pack = std::make_unique<CgfbFileReader>(packPath.c_str(), CgfbReadMode::Mapped);
+	}
+	catch(const std::runtime_error& error)
+	{
+		return false;
+	}
+
+	// Blocks are copied as they're stored, so they must be encoded as this version would encode them
+	if(pack->GetFormatVersion() != CGFB_VERSION)
+	{
+		return false;
+	}
+
+	m_PreviousKeys = std::move(keys);
+	m_PreviousPack = std::move(pack);
+
+	return true;
+}
+
+
+void BuildCache::Close()
+{
+	m_PreviousKeys.clear();
+	m_PreviousPack.reset();
+}
+
+
+bool BuildCache::Find(const std::string& name, BlockKind kind, uint64_t key, const DirectoryEntry** entry, std::span<const char>* stored) const
+{
+	auto previousKey = m_PreviousKeys.find(name);
+
+	if(previousKey == m_PreviousKeys.end() || previousKey->second != key)
+	{
+		return false;
+	}
+
+	const DirectoryEntry* previousEntry = m_PreviousPack->FindBlock(name);
+
+	if(!previousEntry || previousEntry->Kind != kind)
+	{
+		return false;
+	}
+
+	CgfbBlock block;
+	m_PreviousPack->ReadStoredBlock(*previousEntry, block);
+
+	// Blocks of a mapped pack view straight into the mapping, which outlives them
+	*entry = previousEntry;
+	*stored = std::span<const char>(block.Data, block.Count);
+
+	return true;
+}
+
+
+void BuildCache::Record(const std::string& name, uint64_t key)
+{
+	m_Keys.emplace_back(name, key);
+}
+
+
+bool BuildCache::Save(const std::string& packPath) const
+{
+	CgfbMemoryWriter cache;
+	cache.Write(BUILD_CACHE_VERSION);
+	cache.WriteLength(m_Keys.size());
+
+	for(const auto& [name, key] : m_Keys)
+	{
+		cache.Write(name);
+		cache.Write(key);
+	}
+
+	std::ofstream file (GetCachePath(packPath), std::ios_base::binary);
+	file.write(cache.GetBuffer().data(), cache.GetBuffer().size());
+
+	return file.good();
+}
+
+
+void BuildCache::Remove(const std::string& packPath)
+{
+	std::error_code error;
+	std::filesystem::remove(GetCachePath(packPath), error);
+}
+
+
+std::string BuildCache::GetCachePath(const std::string& packPath)
+{
+	return packPath + ".buildcache";
+}
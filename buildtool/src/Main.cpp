@@ -1,15 +1,28 @@
 #include <string>
 #include <vector>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <functional>
+#include <memory>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 
 #include "pugixml.hpp"
 
 #include "cgfb/CGFB.h"
+#include "cgfb/ManifestFormat.h"
 #include "stb/stb_image.h"
 #include "buildtool/Assets.h"
 #include "buildtool/AssetTypes.h"
+#include "buildtool/Benchmark.h"
+#include "buildtool/BuildCache.h"
+#include "buildtool/MeshCooker.h"
+#include "buildtool/TextureCooker.h"
+#include "buildtool/Utility.h"
 
 #define LOG(x) std::cout << (x) << std::endl;
 
@@ -33,12 +46,238 @@ enum class AssetType
 	Mesh,
 	Texture,
 
+	/**
+	 * @brief Dependencies and manifests, compiled after every asset they refer to
+	 */
+	Manifest,
+
 	NumTypes
 };
 
 
+/**
+ * @brief Finds the compression requested for an asset type, which the project descriptor specifies like
+ * <Compression Type="Texture" Codec="Zstd" Level="19"/>. Assets are left uncompressed by default.
+ */
+CompressionSettings GetCompressionSettings(pugi::xml_document& document, const char* assetType)
+{
+	CompressionSettings settings;
+
+	pugi::xml_node node = document.child("Assets").find_child_by_attribute("Compression", "Type", assetType);
+
+	if(!node)
+	{
+		return settings;
+	}
+
+	if(!ParseCompressionCodec(node.attribute("Codec").as_string(), &settings.Codec))
+	{
+		LOG("Unrecognized compression codec " + std::string(node.attribute("Codec").as_string()) + " for " + assetType + " assets");
+	}
+
+	settings.Level = node.attribute("Level").as_int(0);
+
+	return settings;
+}
+
+
+/**
+ * @brief Finds the optimizations requested for cooked meshes, which the project descriptor specifies like
+ * <MeshOptimization VertexCache="true" Overdraw="true" VertexFetch="true"/>
+ */
+MeshOptimizationSettings GetMeshOptimizationSettings(pugi::xml_document& document)
+{
+	MeshOptimizationSettings settings;
+
+	pugi::xml_node node = document.child("Assets").child("MeshOptimization");
+
+	if(!node)
+	{
+		return settings;
+	}
+
+	settings.VertexCache = node.attribute("VertexCache").as_bool(settings.VertexCache);
+	settings.Overdraw = node.attribute("Overdraw").as_bool(settings.Overdraw);
+	settings.OverdrawThreshold = node.attribute("OverdrawThreshold").as_float(settings.OverdrawThreshold);
+	settings.VertexFetch = node.attribute("VertexFetch").as_bool(settings.VertexFetch);
+
+	return settings;
+}
+
+
+/**
+ * @brief Reads a vertex format, specified like <VertexFormat Position="Unorm16x4" Normal="Oct16" UV="Half2"/>,
+ * from node. Attributes which aren't specified are left as they are in format.
+ */
+VertexFormat ReadVertexFormat(pugi::xml_node node, VertexFormat format)
+{
+	if(!node)
+	{
+		return format;
+	}
+
+	pugi::xml_attribute position = node.attribute("Position");
+	pugi::xml_attribute normal = node.attribute("Normal");
+	pugi::xml_attribute uv = node.attribute("UV");
+
+	if(position && !ParsePositionFormat(position.as_string(), &format.Position))
+	{
+		LOG("Unrecognized position format " + std::string(position.as_string()));
+	}
+
+	if(normal && !ParseNormalFormat(normal.as_string(), &format.Normal))
+	{
+		LOG("Unrecognized normal format " + std::string(normal.as_string()));
+	}
+
+	if(uv && !ParseUVFormat(uv.as_string(), &format.UV0))
+	{
+		LOG("Unrecognized UV format " + std::string(uv.as_string()));
+	}
+
+	return format;
+}
+
+
+/**
+ * @brief Reads the levels of detail requested by node, specified like
+ * <LodChain Ratios="0.5 0.25 0.1" ScreenSizes="0.4 0.2 0.05" MaxError="0.05"/>; if node doesn't
+ * exist, settings are returned unchanged
+ */
+MeshLodSettings ReadLodSettings(pugi::xml_node node, MeshLodSettings settings)
+{
+	if(!node)
+	{
+		return settings;
+	}
+
+	auto readList = [](const char* list)
+	{
+		std::vector<float> values;
+		std::istringstream stream (list);
+		float value;
+
+		while(stream >> value)
+		{
+			values.push_back(value);
+		}
+
+		return values;
+	};
+
+	settings.Ratios = readList(node.attribute("Ratios").as_string());
+	settings.ScreenSizes = readList(node.attribute("ScreenSizes").as_string());
+	settings.MaxError = node.attribute("MaxError").as_float(settings.MaxError);
+
+	return settings;
+}
+
+
+/**
+ * @brief Reads how a texture is cooked, specified like <TextureEncoding Format="BC7" SRGB="true" Mips="true"/>,
+ * from node. Attributes which aren't specified are left as they are in settings.
+ */
+TextureSettings ReadTextureSettings(pugi::xml_node node, TextureSettings settings)
+{
+	if(!node)
+	{
+		return settings;
+	}
+
+	pugi::xml_attribute format = node.attribute("Format");
+
+	if(format && !ParseTextureEncoding(format.as_string(), &settings.Encoding))
+	{
+		LOG("Unrecognized texture format " + std::string(format.as_string()));
+	}
+
+	settings.SRGB = node.attribute("SRGB").as_bool(settings.SRGB);
+	settings.GenerateMips = node.attribute("Mips").as_bool(settings.GenerateMips);
+
+	return settings;
+}
+
+
+/**
+ * @brief An asset to be cooked into a block. Every asset in the project descriptor is gathered into a
+ * job before any are cooked, so they can be cooked in parallel and still be written out in the order
+ * they're declared in.
+ */
+struct CookJob
+{
+	std::string Name;
+	BlockKind Kind = BlockKind::Raw;
+	CompressionSettings Compression;
+
+	/**
+	 * @brief Reads the asset's source, adding everything its block depends on to key: the source's
+	 * contents, the cooker's version and the settings it's cooked with
+	 * @return Whether the source could be read
+	 */
+	std::function<bool(CookKey& key, std::ostream& log)> Load;
+
+	/**
+	 * @brief Steps of cooking which run after Load and before Cook, in order, each as a separate task, i.e.
+	 * decoding an image and then generating its mips. Stages hand their results on through state they
+	 * share with Cook.
+	 * @return Whether the stage succeeded
+	 */
+	std::vector<std::function<bool(std::ostream& log)>> Stages;
+
+	/**
+	 * @brief Cooks the source read by Load, and anything prepared by Stages, into the block's payload
+	 * @return Whether the asset was cooked
+	 */
+	std::function<bool(CgfbWriter& out, std::ostream& log)> Cook;
+};
+
+
+CookKey& AddToKey(CookKey& key, const CompressionSettings& settings)
+{
+	return key.Add(settings.Codec).Add(settings.Level);
+}
+
+
+CookKey& AddToKey(CookKey& key, const MeshOptimizationSettings& settings)
+{
+	return key.Add(settings.VertexCache).Add(settings.Overdraw).Add(settings.OverdrawThreshold).Add(settings.VertexFetch);
+}
+
+
+CookKey& AddToKey(CookKey& key, const MeshLodSettings& settings)
+{
+	key.Add((uint64_t)settings.Ratios.size());
+
+	for(float ratio : settings.Ratios)
+	{
+		key.Add(ratio);
+	}
+
+	key.Add((uint64_t)settings.ScreenSizes.size());
+
+	for(float screenSize : settings.ScreenSizes)
+	{
+		key.Add(screenSize);
+	}
+
+	return key.Add(settings.MaxError);
+}
+
+
+CookKey& AddToKey(CookKey& key, const VertexFormat& format)
+{
+	return key.Add(format.Position).Add(format.Normal).Add(format.UV0);
+}
+
+
+CookKey& AddToKey(CookKey& key, const TextureSettings& settings)
+{
+	return key.Add(settings.Encoding).Add(settings.SRGB).Add(settings.GenerateMips);
+}
+
+
 template<AssetType AssetT>
-void CompileAssetType(CgfbFileWriter& out, pugi::xml_document& descriptor)
+void CompileAssetType(std::vector<CookJob>& jobs, pugi::xml_document& descriptor)
 {
 	LOG("No compiler implemented for asset type " + std::to_string((int)AssetT));
 }
@@ -48,9 +287,9 @@ void CompileAssetType(CgfbFileWriter& out, pugi::xml_document& descriptor)
  * @brief Compiles material info into a CGFB asset file
  */
 template<>
-void CompileAssetType<AssetType::Material>(CgfbFileWriter& out, pugi::xml_document& document)
+void CompileAssetType<AssetType::Material>(std::vector<CookJob>& jobs, pugi::xml_document& document)
 {
-	LOG("Compiling materials...");
+	CompressionSettings compression = GetCompressionSettings(document, "Material");
 
 	for(auto& v : document.child("Assets").children("Material"))
 	{
@@ -58,38 +297,122 @@ void CompileAssetType<AssetType::Material>(CgfbFileWriter& out, pugi::xml_docume
 		std::string domain = v.child_value("Domain");
 		std::string path = v.child_value("ShaderFile");
 
-		char* source;
-		int sourceLen;
-		ReadFileContents(path.c_str(), &source, &sourceLen);
-
-		out.StartBlock(name);
-		out.Write(domain);
-		out.Write(sourceLen);
-		out.Write(source, sourceLen);
+		auto source = std::make_shared<FileContents>();
+
+		CookJob& job = jobs.emplace_back();
+		job.Name = name;
+		job.Kind = BlockKind::Material;
+		job.Compression = compression;
+
+		job.Load = [=](CookKey& key, std::ostream& log)
+		{
+			if(!source->Open(path.c_str()))
+			{
+				log << "Failed to read material " << name << " from " << path << std::endl;
+				return false;
+			}
+
+			key.AddString(domain).AddBytes(source->GetBytes());
+			return true;
+		};
+
+		job.Cook = [=](CgfbWriter& out, std::ostream& log)
+		{
+			out.Write(domain);
+			out.WriteLength(source->GetSize());
+			out.Write(source->GetData(), source->GetSize());
+
+			return true;
+		};
 	}
 }
 
 
 /**
- * @brief Compiles mesh info into a CGFB asset file
+ * @brief Cooks meshes into CGFB blocks which can be uploaded without any further processing
  */
 template<>
-void CompileAssetType<AssetType::Mesh>(CgfbFileWriter& out, pugi::xml_document& document)
+void CompileAssetType<AssetType::Mesh>(std::vector<CookJob>& jobs, pugi::xml_document& document)
 {
-	LOG("Compiling meshes...");
+	CompressionSettings compression = GetCompressionSettings(document, "Mesh");
+	MeshOptimizationSettings optimization = GetMeshOptimizationSettings(document);
+
+	// Meshes are stored at full precision unless the project, or the mesh itself, asks for a quantized format
+	VertexFormat defaultFormat = ReadVertexFormat(document.child("Assets").child("VertexFormat"), {});
+	MeshLodSettings defaultLods = ReadLodSettings(document.child("Assets").child("LodChain"), {});
 
 	for(auto& v : document.child("Assets").children("Mesh"))
 	{
 		std::string name = v.child_value("Name");
 		std::string path = v.child_value("File");
-
-		char* source;
-		int sourceLen;
-		ReadFileContents(path.c_str(), &source, &sourceLen);
-
-		out.StartBlock(name);
-		out.Write(sourceLen);
-		out.Write(source, sourceLen);
+		std::string extension = std::filesystem::path(path).extension().string();
+
+		VertexFormat format = ReadVertexFormat(v.child("VertexFormat"), defaultFormat);
+		MeshLodSettings lods = ReadLodSettings(v.child("LodChain"), defaultLods);
+
+		auto source = std::make_shared<FileContents>();
+
+		CookJob& job = jobs.emplace_back();
+		job.Name = name;
+		job.Kind = BlockKind::Mesh;
+		job.Compression = compression;
+
+		job.Load = [=](CookKey& key, std::ostream& log)
+		{
+			if(!source->Open(path.c_str()))
+			{
+				log << "Failed to read mesh " << name << " from " << path << std::endl;
+				return false;
+			}
+
+			key.Add(MESH_COOKER_VERSION).Add(MESH_FORMAT_VERSION).AddString(extension);
+			AddToKey(key, optimization);
+			AddToKey(key, lods);
+			AddToKey(key, format);
+			key.AddBytes(source->GetBytes());
+
+			return true;
+		};
+
+		job.Cook = [=](CgfbWriter& out, std::ostream& log)
+		{
+			std::string error;
+			CookedMesh mesh;
+
+			if(!ImportMesh(source->GetData(), source->GetSize(), extension.empty() ? "" : extension.c_str() + 1, &mesh, &error))
+			{
+				log << "Failed to import mesh " << name << " from " << path << ": " << error << std::endl;
+				return false;
+			}
+
+			VertexCacheStats before = AnalyzeVertexCache(mesh);
+			OptimizeMesh(&mesh, optimization);
+			VertexCacheStats after = AnalyzeVertexCache(mesh);
+
+			const size_t triangleCount = mesh.Indices.size() / 3;
+			GenerateLods(&mesh, lods);
+
+			log << std::fixed << std::setprecision(3) << "  " << name << ": "
+				<< triangleCount << " triangles, " << mesh.Vertices.size() << " vertices, "
+				<< "ACMR " << before.ACMR << " -> " << after.ACMR << ", ATVR " << before.ATVR << " -> " << after.ATVR;
+
+			for(const CookedMeshLod& lod : mesh.Lods)
+			{
+				size_t lodTriangleCount = 0;
+
+				for(const MeshSubmesh& submesh : lod.Submeshes)
+				{
+					lodTriangleCount += submesh.IndexCount / 3;
+				}
+
+				log << "\n    LOD below " << lod.Info.ScreenSize << " of the screen: " << lodTriangleCount << " triangles, error " << lod.Info.Error;
+			}
+
+			log << std::endl;
+
+			WriteCookedMesh(out, mesh, format);
+			return true;
+		};
 	}
 }
 
@@ -98,58 +421,582 @@ void CompileAssetType<AssetType::Mesh>(CgfbFileWriter& out, pugi::xml_document&
  * @brief Compiles texture info into a CGFB asset file
  */
 template<>
-void CompileAssetType<AssetType::Texture>(CgfbFileWriter& out, pugi::xml_document& document)
+void CompileAssetType<AssetType::Texture>(std::vector<CookJob>& jobs, pugi::xml_document& document)
 {
-	LOG("Compiling textures...");
+	CompressionSettings compression = GetCompressionSettings(document, "Texture");
+
+	// Textures are stored uncompressed, with mips, unless the project or the texture itself asks otherwise
+	TextureSettings defaultSettings = ReadTextureSettings(document.child("Assets").child("TextureEncoding"), {});
 
 	for(auto& v : document.child("Assets").children("Texture")) 
 	{
 		std::string name = v.child_value("Name");
 		std::string path = v.child_value("File");
 
-		int x, y, channels;
-		unsigned char* data = stbi_load(path.c_str(), &x, &y, &channels, 4);
+		TextureSettings requestedSettings = ReadTextureSettings(v.child("TextureEncoding"), defaultSettings);
+
+		auto source = std::make_shared<FileContents>();
+
+		CookJob& job = jobs.emplace_back();
+		job.Name = name;
+		job.Kind = BlockKind::Texture;
+		job.Compression = compression;
+
+		job.Load = [=](CookKey& key, std::ostream& log)
+		{
+			if(!source->Open(path.c_str()))
+			{
+				log << "Failed to read texture " << name << " from " << path << std::endl;
+				return false;
+			}
+
+			key.Add(TEXTURE_COOKER_VERSION).Add(TEXTURE_FORMAT_VERSION);
+			AddToKey(key, requestedSettings);
+			key.AddBytes(source->GetBytes());
+
+			return true;
+		};
+
+		// Handed from each stage to the next
+		struct TextureState
+		{
+			TextureSettings Settings;
+			TextureImage Image;
+			std::vector<TextureImage> Mips;
+			std::vector<std::vector<uint8_t>> EncodedMips;
+		};
+
+		auto state = std::make_shared<TextureState>();
+
+		// Decodes the image and settles how it can be stored
+		job.Stages.push_back([=](std::ostream& log)
+		{
+			int x, y, channels;
+			unsigned char* data = stbi_load_from_memory((const stbi_uc*)source->GetData(), source->GetSize(), &x, &y, &channels, 4);
+
+			if(!data)
+			{
+				log << "Failed to load texture " << name << " from " << path << ": " << stbi_failure_reason() << std::endl;
+				return false;
+			}
+
+			state->Image.Width = x;
+			state->Image.Height = y;
+			state->Image.Pixels.assign(data, data + (size_t)x * y * 4);
+			stbi_image_free(data);
+
+			// The source is no longer needed, and may be large
+			source->Close();
+
+			TextureSettings& settings = state->Settings;
+			settings = requestedSettings;
+
+			if(settings.Encoding == TextureEncoding::BC5 && settings.SRGB)
+			{
+				log << "  " << name << ": BC5 has no sRGB variant, so it's stored linearly" << std::endl;
+				settings.SRGB = false;
+			}
+
+			// Graphics APIs require the top level of a block compressed texture to be a whole number of blocks
+			if(GetBlockSize(settings.Encoding) && (x % 4 || y % 4))
+			{
+				log << "  " << name << ": " << x << "x" << y << " isn't a multiple of 4, so it's stored as RGBA8" << std::endl;
+				settings.Encoding = TextureEncoding::RGBA8;
+			}
+
+			return true;
+		});
+
+		job.Stages.push_back([=](std::ostream& log)
+		{
+			if(state->Settings.GenerateMips)
+			{
+				state->Mips = GenerateMipChain(std::move(state->Image), state->Settings.SRGB);
+			}
+			else
+			{
+				state->Mips.push_back(std::move(state->Image));
+			}
+
+			return true;
+		});
+
+		job.Stages.push_back([=](std::ostream& log)
+		{
+			state->EncodedMips = EncodeMipChain(state->Mips, state->Settings.Encoding);
+			return true;
+		});
+
+		job.Cook = [=](CgfbWriter& out, std::ostream& log)
+		{
+			const TextureSettings& settings = state->Settings;
+			const TextureImage& top = state->Mips.front();
+
+			uint64_t encodedSize = 0;
+
+			for(const std::vector<uint8_t>& encoded : state->EncodedMips)
+			{
+				encodedSize += encoded.size();
+			}
+
+			log << std::fixed << std::setprecision(2) << "  " << name << ": " << top.Width << "x" << top.Height << ", "
+				<< state->Mips.size() << " mips, " << GetTextureEncodingName(settings.Encoding) << (settings.SRGB ? " sRGB" : "")
+				<< ", " << encodedSize / 1024.0 << " KiB" << std::endl;
+
+			WriteCookedTexture(out, state->Mips, state->EncodedMips, settings);
+			return true;
+		};
+	}
+}
+
+
+/**
+ * @brief Records the assets each asset depends on, listed like <Dependency>Atlas</Dependency> inside the
+ * asset, and compiles manifests of assets which are loaded together, i.e. by a scene, listed like
+ * <Manifest><Name>Dev</Name><Asset>Sprite</Asset></Manifest>. Runtimes preload a manifest's assets, and
+ * everything they depend on, as a single batch.
+ */
+template<>
+void CompileAssetType<AssetType::Manifest>(std::vector<CookJob>& jobs, pugi::xml_document& document)
+{
+	std::unordered_set<std::string> declared;
+
+	for(const CookJob& job : jobs)
+	{
+		declared.insert(job.Name);
+	}
+
+	auto checkDeclared = [&](const std::string& name, const std::string& referrer)
+	{
+		if(!declared.contains(name))
+		{
+			LOG("  " + referrer + " refers to " + name + ", which isn't an asset");
+		}
+	};
+
+	auto dependencies = std::make_shared<std::vector<AssetDependencies>>();
+
+	for(pugi::xml_node v : document.child("Assets").children())
+	{
+		if(std::string(v.name()) == "Manifest")
+		{
+			continue;
+		}
+
+		AssetDependencies entry;
+		entry.Name = v.child_value("Name");
+
+		for(pugi::xml_node dependency : v.children("Dependency"))
+		{
+			entry.Dependencies.push_back(dependency.child_value());
+			checkDeclared(entry.Dependencies.back(), entry.Name);
+		}
+
+		if(!entry.Dependencies.empty())
+		{
+			dependencies->push_back(std::move(entry));
+		}
+	}
+
+	std::sort(dependencies->begin(), dependencies->end(), [](const AssetDependencies& a, const AssetDependencies& b)
+	{
+		return a.Name < b.Name;
+	});
 
-		out.StartBlock(name);
-		out.Write("Abcdefg");
-		out.Write(x);
-		out.Write(y);
-		out.Write((char*)data, x * y * 4);
+	// Both kinds of block are cheap to write, but are keyed like any other so unchanged builds copy everything
+	auto addListJob = [&](std::string name, BlockKind kind, std::function<void(CgfbWriter&)> write)
+	{
+		CgfbMemoryWriter contents;
+		write(contents);
+
+		CookJob& job = jobs.emplace_back();
+		job.Name = name;
+		job.Kind = kind;
+
+		job.Load = [contents = contents.GetBuffer()](CookKey& key, std::ostream& log)
+		{
+			key.AddBytes(contents);
+			return true;
+		};
+
+		job.Cook = [write](CgfbWriter& out, std::ostream& log)
+		{
+			write(out);
+			return true;
+		};
+	};
+
+	if(!dependencies->empty())
+	{
+		addListJob(CGFB_DEPENDENCY_BLOCK, BlockKind::Dependencies, [dependencies](CgfbWriter& out)
+		{
+			WriteDependencyTable(out, *dependencies);
+		});
+	}
+
+	for(auto& v : document.child("Assets").children("Manifest"))
+	{
+		std::string name = v.child_value("Name");
+
+		// Manifests share the directory with assets, whose names must be unique
+		if(declared.contains(name))
+		{
+			LOG("  Manifest " + name + " has the same name as another block, so it's skipped");
+			continue;
+		}
+
+		auto assets = std::make_shared<std::vector<std::string>>();
+
+		for(pugi::xml_node asset : v.children("Asset"))
+		{
+			assets->push_back(asset.child_value());
+			checkDeclared(assets->back(), "Manifest " + name);
+		}
+
+		declared.insert(name);
+
+		addListJob(name, BlockKind::Manifest, [assets](CgfbWriter& out)
+		{
+			WriteManifest(out, *assets);
+		});
 	}
 }
 
 
 template<size_t... TypeIndices>
-void CompileAssetTypesFromTypeIndices(std::index_sequence<TypeIndices...> indices, CgfbFileWriter& out, pugi::xml_document& descriptor)
+void CompileAssetTypesFromTypeIndices(std::index_sequence<TypeIndices...> indices, std::vector<CookJob>& jobs, pugi::xml_document& descriptor)
 {
 	( 
-		CompileAssetType<(AssetType)TypeIndices>(out, descriptor), 
+		CompileAssetType<(AssetType)TypeIndices>(jobs, descriptor), 
 		... 
 	);
 }
 
 
-void CompileAssets(CgfbFileWriter& out, pugi::xml_document& descriptor)
+/**
+ * @brief Gathers every asset in the project descriptor into a cook job, in the order they're declared in
+ */
+std::vector<CookJob> CompileAssets(pugi::xml_document& descriptor)
+{
+	std::vector<CookJob> jobs;
+	CompileAssetTypesFromTypeIndices(std::make_index_sequence<(size_t)AssetType::NumTypes>(), jobs, descriptor);
+
+	return jobs;
+}
+
+
+/**
+ * @brief Cooks every job in parallel, except those whose block can be copied out of the previous build
+ * because its key is unchanged, and writes each block out in the order the jobs were gathered in. Output
+ * doesn't depend on which jobs were cached or the order they finished in, so builds are deterministic.
+ * @return The number of jobs which failed, whose blocks are missing from the output
+ */
+size_t CookAssets(std::vector<CookJob>& jobs, CgfbFileWriter& out, BuildCache& cache)
+{
+	struct CookResult
+	{
+		bool Succeeded = false;
+		bool Cached = false;
+		uint64_t Key = 0;
+		BlockInfo Info;
+		CgfbMemoryWriter Payload;
+		std::vector<char> Compressed;
+		std::span<const char> Stored;
+		std::ostringstream Log;
+	};
+
+	// Only a window of jobs is in flight at once, and each is written out and released as soon as every
+	// job before it has been, so the cooked pack is never held in memory as a whole. This also bounds how
+	// many jobs can be queued at any one stage.
+	ThreadPool& pool = ThreadPool::GetShared();
+	const size_t window = (pool.GetWorkerCount() + 1) * 2;
+
+	std::vector<std::unique_ptr<CookResult>> results (jobs.size());
+	std::vector<bool> finished (jobs.size());
+	std::mutex finishedMutex;
+	std::condition_variable jobFinished;
+
+	// Reads the job's source and keys it. Jobs whose block can be copied from the previous build end here.
+	auto load = [&](CookJob& job, CookResult& result)
+	{
+		result.Info.Name = job.Name;
+		result.Info.Kind = job.Kind;
+		result.Info.Alignment = CGFB_DEFAULT_ALIGNMENT;
+
+		CookKey key;
+		key.Add(job.Kind).Add(result.Info.Alignment);
+		AddToKey(key, job.Compression);
+
+		if(!job.Load(key, result.Log))
+		{
+			return false;
+		}
+
+		result.Key = key.Get();
+
+		const DirectoryEntry* entry;
+
+		if(cache.Find(job.Name, job.Kind, result.Key, &entry, &result.Stored))
+		{
+			result.Info.Alignment = entry->Alignment;
+			result.Info.Compression = entry->Compression;
+			result.Info.UncompressedSize = entry->UncompressedSize;
+			result.Succeeded = result.Cached = true;
+
+			return false;
+		}
+
+		return true;
+	};
+
+	auto compress = [&](CookJob& job, CookResult& result)
+	{
+		result.Info.UncompressedSize = result.Payload.GetBuffer().size();
+		result.Compressed = EncodeBlock(result.Payload.GetBuffer(), job.Compression, nullptr, &result.Info.EncodeTime);
+
+		if(result.Compressed.empty())
+		{
+			result.Stored = result.Payload.GetBuffer();
+		}
+		else
+		{
+			result.Info.Compression = job.Compression.Codec;
+			result.Stored = result.Compressed;
+		}
+
+		result.Succeeded = true;
+	};
+
+	// Each job runs as a pipeline of tasks: loading, the job's own stages, cooking, then compression. A
+	// worker queues the next stage of a job on its own queue, so it usually carries the job on while its
+	// data is still in cache, and idle workers steal whichever stages are waiting.
+	std::function<void(size_t, size_t)> runStage = [&](size_t i, size_t stage)
+	{
+		CookJob& job = jobs[i];
+		CookResult& result = *results[i];
+
+		const size_t cookStage = job.Stages.size() + 1;
+		bool proceed = false;
+
+		if(stage == 0)
+		{
+			proceed = load(job, result);
+		}
+		else if(stage < cookStage)
+		{
+			proceed = job.Stages[stage - 1](result.Log);
+		}
+		else if(stage == cookStage)
+		{
+			proceed = job.Cook(result.Payload, result.Log);
+		}
+		else
+		{
+			compress(job, result);
+		}
+
+		if(proceed)
+		{
+			pool.Submit([&runStage, i, stage]() { runStage(i, stage + 1); });
+			return;
+		}
+
+		// Releases the job's source, and anything its stages kept, as soon as it's done
+		job.Load = nullptr;
+		job.Stages.clear();
+		job.Cook = nullptr;
+
+		std::lock_guard lock (finishedMutex);
+		finished[i] = true;
+		jobFinished.notify_all();
+	};
+
+	auto submit = [&](size_t i)
+	{
+		results[i] = std::make_unique<CookResult>();
+		pool.Submit([&runStage, i]() { runStage(i, 0); });
+	};
+
+	for(size_t i = 0; i < std::min(window, jobs.size()); i++)
+	{
+		submit(i);
+	}
+
+	size_t cachedCount = 0, cookedCount = 0, failedCount = 0;
+
+	for(size_t i = 0; i < jobs.size(); i++)
+	{
+		{
+			std::unique_lock lock (finishedMutex);
+			jobFinished.wait(lock, [&]() { return finished[i]; });
+		}
+
+		if(i + window < jobs.size())
+		{
+			submit(i + window);
+		}
+
+		CookResult& result = *results[i];
+		std::cout << result.Log.str();
+
+		if(result.Succeeded)
+		{
+			out.WriteEncodedBlock(result.Info, result.Stored);
+			cache.Record(result.Info.Name, result.Key);
+
+			(result.Cached ? cachedCount : cookedCount)++;
+		}
+		else
+		{
+			failedCount++;
+		}
+
+		results[i].reset();
+	}
+
+	LOG("Cooked " + std::to_string(cookedCount) + " assets, copied " + std::to_string(cachedCount) + " unchanged assets from the previous build");
+
+	return failedCount;
+}
+
+
+/**
+ * @brief Logs the compression ratio and encode throughput achieved for each kind of block
+ */
+void ReportCompression(const CgfbFileWriter& out)
 {
-	CompileAssetTypesFromTypeIndices(std::make_index_sequence<(size_t)AssetType::NumTypes>(), out, descriptor);
+	const char* kindNames[] = { "Raw", "Material", "Mesh", "Texture", "Manifest", "Dependencies" };
+
+	for(BlockKind kind : { BlockKind::Raw, BlockKind::Material, BlockKind::Mesh, BlockKind::Texture, BlockKind::Manifest, BlockKind::Dependencies })
+	{
+		uint64_t rawBytes = 0, storedBytes = 0, encodedBytes = 0;
+		double encodeTime = 0.0;
+
+		for(const BlockInfo& block : out.GetBlocks())
+		{
+			if(block.Kind == kind)
+			{
+				rawBytes += block.UncompressedSize;
+				storedBytes += block.Size;
+				encodeTime += block.EncodeTime;
+
+				// Blocks copied from the previous build weren't encoded by this one
+				encodedBytes += block.EncodeTime > 0.0 ? block.UncompressedSize : 0;
+			}
+		}
+
+		if(rawBytes == 0)
+		{
+			continue;
+		}
+
+		std::ostringstream report;
+		report << std::fixed << std::setprecision(2) << kindNames[(int)kind] << ": "
+			<< rawBytes / 1048576.0 << " MB -> " << storedBytes / 1048576.0 << " MB (ratio " << (double)rawBytes / storedBytes << ")";
+
+		if(encodeTime > 0.0)
+		{
+			report << ", " << encodedBytes / 1048576.0 / encodeTime << " MB/s encoded";
+		}
+
+		LOG(report.str());
+	}
 }
 
 
 int main(int argc, char* argv[])
 {
-	const char* projectFile = argc == 0 ? DEV_IN : argv[1];
-	const char* binaryFile = argc == 0 ? DEV_OUT : argv[2];
+	if(argc == 3 && std::string(argv[1]) == "--benchmark")
+	{
+		return BenchmarkContentFile(argv[2]);
+	}
+
+	if(argc >= 2 && std::string(argv[1]) == "--bench-ingest")
+	{
+		return BenchmarkFileIngest(argc >= 3 ? std::stoull(argv[2]) : 1024);
+	}
 
-	LOG("Compiling from " + std::string(projectFile) + " to " + std::string(binaryFile));
+	// Unchanged assets are copied from the previous build unless a full rebuild is requested
+	const bool rebuild = argc > 1 && std::string(argv[1]) == "--rebuild";
 
-	stbi_set_flip_vertically_on_load(true);
+	if(rebuild)
+	{
+		argc--;
+		argv++;
+	}
+
+	const char* projectFile = argc < 3 ? DEV_IN : argv[1];
+	const std::string binaryFile = argc < 3 ? DEV_OUT : argv[2];
+	const std::string tempFile = binaryFile + ".tmp";
 
-	CgfbFileWriter stream (binaryFile);
+	LOG("Compiling from " + std::string(projectFile) + " to " + binaryFile);
+
+	stbi_set_flip_vertically_on_load(true);
 
 	pugi::xml_document document;
 	document.load_file(projectFile);
 
-	CompileAssets(stream, document);
+	BuildCache cache;
+
+	if(!rebuild && !cache.Open(binaryFile))
+	{
+		LOG("No previous build to reuse, so every asset is cooked");
+	}
+
+	std::vector<CookJob> jobs = CompileAssets(document);
+
+	// The pack is written beside the previous one, which blocks may be copied from, and only replaces it once
+	// complete; an incomplete pack is removed once its stream is closed
+	size_t failedCount = 0;
+	bool written = false;
+
+	try
+	{
+		CgfbFileWriter stream (tempFile.c_str());
+		stream.SetThreadPool(&ThreadPool::GetShared());
+
+		failedCount = CookAssets(jobs, stream, cache);
+
+		written = stream.Flush();
+
+		if(written && failedCount == 0)
+		{
+			ReportCompression(stream);
+		}
+	}
+	catch(...)
+	{
+		std::error_code error;
+		std::filesystem::remove(tempFile, error);
+
+		throw;
+	}
+
+	if(failedCount > 0)
+	{
+		LOG(std::to_string(failedCount) + " assets failed to cook, so " + binaryFile + " was left as it was");
+
+		std::error_code error;
+		std::filesystem::remove(tempFile, error);
+
+		return 1;
+	}
+
+	if(!written)
+	{
+		LOG("Failed to write " + tempFile);
+
+		std::error_code error;
+		std::filesystem::remove(tempFile, error);
+
+		return 1;
+	}
+
+	cache.Close();
+
+	BuildCache::Remove(binaryFile);
+	std::filesystem::rename(tempFile, binaryFile);
+	cache.Save(binaryFile);
 
-	LOG("Compiled to " + std::string(binaryFile));
+	LOG("Compiled to " + binaryFile);
 }
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "buildtool/MeshCooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+
+#include "meshoptimizer.h"
+
+
+using namespace cgfb;
+
+
+namespace
+{
+
+constexpr uint32_t MESH_DATA_ALIGNMENT = 16;
+
+
+void WritePadding(CgfbWriter& out, uint64_t size)
+{
+	static const char zeros[MESH_DATA_ALIGNMENT] = {};
+
+	out.Write(zeros, size);
+}
+
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+/**
+ * @brief Writes everything preceding a cooked mesh's vertex data: its header, LOD table and submesh table
+ */
+void WriteMeshTables(CgfbWriter& out, const MeshHeader& header, const btools::CookedMesh& mesh)
+{
+	WriteMeshHeader(out, header);
+	WriteMeshLod(out, MeshLod());
+
+	for(const btools::CookedMeshLod& lod : mesh.Lods)
+	{
+		WriteMeshLod(out, lod.Info);
+	}
+
+	for(const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		WriteMeshSubmesh(out, submesh);
+	}
+
+	for(const btools::CookedMeshLod& lod : mesh.Lods)
+	{
+		for(const MeshSubmesh& submesh : lod.Submeshes)
+		{
+			WriteMeshSubmesh(out, submesh);
+		}
+	}
+}
+
+
+/**
+ * @brief Maps a unit vector onto the octahedron |x| + |y| + |z| = 1, then unfolds the octahedron's
+ * lower half onto the square [-1, 1]^2
+ */
+void EncodeOctahedral(const float normal[3], float* x, float* y)
+{
+	const float l1 = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+
+	if(l1 == 0.0f)
+	{
+		*x = *y = 0.0f;
+		return;
+	}
+
+	*x = normal[0] / l1;
+	*y = normal[1] / l1;
+
+	if(normal[2] < 0.0f)
+	{
+		const float foldedX = (1.0f - std::abs(*y)) * (*x >= 0.0f ? 1.0f : -1.0f);
+		const float foldedY = (1.0f - std::abs(*x)) * (*y >= 0.0f ? 1.0f : -1.0f);
+
+		*x = foldedX;
+		*y = foldedY;
+	}
+}
+
+
+/**
+ * @brief Appends a vertex to out, encoded in the given format
+ */
+void EncodeVertex(const MeshVertex& vertex, const VertexFormat& format, const float boundsMin[3], const float boundsExtent[3], std::vector<char>& out)
+{
+	auto append = [&out](const auto& value)
+	{
+		out.insert(out.end(), (const char*)&value, (const char*)&value + sizeof(value));
+	};
+
+	if(format.Position == PositionFormat::Unorm16x4)
+	{
+		uint16_t position[4] = {};
+
+		for(int axis = 0; axis < 3; axis++)
+		{
+			const float normalized = boundsExtent[axis] > 0.0f ? (vertex.Position[axis] - boundsMin[axis]) / boundsExtent[axis] : 0.0f;
+			position[axis] = meshopt_quantizeUnorm(normalized, 16);
+		}
+
+		append(position);
+	}
+	else
+	{
+		append(vertex.Position);
+	}
+
+	switch(format.Normal)
+	{
+	case NormalFormat::Snorm8x4:
+	{
+		int8_t normal[4] = {};
+
+		for(int axis = 0; axis < 3; axis++)
+		{
+			normal[axis] = meshopt_quantizeSnorm(vertex.Normal[axis], 8);
+		}
+
+		append(normal);
+		break;
+	}
+
+	case NormalFormat::Oct16:
+	{
+		float x, y;
+		EncodeOctahedral(vertex.Normal, &x, &y);
+
+		int16_t normal[2] = { (int16_t)meshopt_quantizeSnorm(x, 16), (int16_t)meshopt_quantizeSnorm(y, 16) };
+		append(normal);
+		break;
+	}
+
+	default:
+		append(vertex.Normal);
+		break;
+	}
+
+	if(format.UV0 == UVFormat::Half2)
+	{
+		uint16_t uv[2] = { meshopt_quantizeHalf(vertex.UV0[0]), meshopt_quantizeHalf(vertex.UV0[1]) };
+		append(uv);
+	}
+	else
+	{
+		append(vertex.UV0);
+	}
+}
+
+}
+
+
+bool btools::ImportMesh(const char* data, size_t size, const char* formatHint, CookedMesh* out, std::string* error)
+{
+	Assimp::Importer importer;
+
+	// Node transforms are baked into the vertices, since every submesh is drawn with the mesh's transform
+	const aiScene* scene = importer.ReadFileFromMemory(data, size,
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices |
+		aiProcess_PreTransformVertices,
+		formatHint);
+
+	if(!scene || !scene->mNumMeshes)
+	{
+		*error = scene ? "No mesh found" : importer.GetErrorString();
+		return false;
+	}
+
+	out->Vertices.clear();
+	out->Indices.clear();
+	out->Submeshes.clear();
+
+	std::fill_n(out->BoundsMin, 3, std::numeric_limits<float>::max());
+	std::fill_n(out->BoundsMax, 3, std::numeric_limits<float>::lowest());
+
+	for(unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+	{
+		const aiMesh* mesh = scene->mMeshes[meshIndex];
+
+		if(!mesh->mNumVertices || !mesh->mNumFaces)
+		{
+			continue;
+		}
+
+		// Indices are relative to the submesh's base vertex, so 16-bit indices only have to address a single submesh
+		MeshSubmesh submesh;
+		submesh.FirstIndex = out->Indices.size();
+		submesh.BaseVertex = out->Vertices.size();
+		submesh.VertexCount = mesh->mNumVertices;
+		submesh.MaterialSlot = mesh->mMaterialIndex;
+
+		for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+		{
+			// Points and lines are left in by triangulation, but can't be drawn as part of a triangle list
+			if(mesh->mFaces[i].mNumIndices != 3)
+			{
+				continue;
+			}
+
+			out->Indices.insert(out->Indices.end(), mesh->mFaces[i].mIndices, mesh->mFaces[i].mIndices + 3);
+		}
+
+		submesh.IndexCount = out->Indices.size() - submesh.FirstIndex;
+
+		for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+		{
+			MeshVertex vertex;
+			const aiVector3D& pos = mesh->mVertices[i];
+
+			vertex.Position[0] = pos.x;
+			vertex.Position[1] = pos.y;
+			vertex.Position[2] = pos.z;
+
+			const aiVector3D nrm = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D();
+
+			vertex.Normal[0] = nrm.x;
+			vertex.Normal[1] = nrm.y;
+			vertex.Normal[2] = nrm.z;
+
+			const aiVector3D uv0 = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][i] : aiVector3D();
+
+			vertex.UV0[0] = uv0.x;
+			vertex.UV0[1] = uv0.y;
+
+			for(int axis = 0; axis < 3; axis++)
+			{
+				out->BoundsMin[axis] = std::min(out->BoundsMin[axis], vertex.Position[axis]);
+				out->BoundsMax[axis] = std::max(out->BoundsMax[axis], vertex.Position[axis]);
+			}
+
+			out->Vertices.push_back(vertex);
+		}
+
+		out->Submeshes.push_back(submesh);
+	}
+
+	if(out->Submeshes.empty())
+	{
+		*error = "No triangles found";
+		return false;
+	}
+
+	return true;
+}
+
+
+void btools::OptimizeMesh(CookedMesh* mesh, const MeshOptimizationSettings& settings)
+{
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh->Vertices.size());
+
+	for(MeshSubmesh& submesh : mesh->Submeshes)
+	{
+		uint32_t* indices = mesh->Indices.data() + submesh.FirstIndex;
+		const MeshVertex* sourceVertices = mesh->Vertices.data() + submesh.BaseVertex;
+
+		if(settings.VertexCache)
+		{
+			meshopt_optimizeVertexCache(indices, indices, submesh.IndexCount, submesh.VertexCount);
+		}
+
+		if(settings.Overdraw)
+		{
+			meshopt_optimizeOverdraw(indices, indices, submesh.IndexCount,
+				sourceVertices->Position, submesh.VertexCount, sizeof(MeshVertex), settings.OverdrawThreshold);
+		}
+
+		const uint32_t baseVertex = vertices.size();
+
+		if(settings.VertexFetch)
+		{
+			vertices.resize(baseVertex + submesh.VertexCount);
+
+			submesh.VertexCount = meshopt_optimizeVertexFetch(vertices.data() + baseVertex, indices, submesh.IndexCount,
+				sourceVertices, submesh.VertexCount, sizeof(MeshVertex));
+
+			vertices.resize(baseVertex + submesh.VertexCount);
+		}
+		else
+		{
+			vertices.insert(vertices.end(), sourceVertices, sourceVertices + submesh.VertexCount);
+		}
+
+		submesh.BaseVertex = baseVertex;
+	}
+
+	mesh->Vertices = std::move(vertices);
+}
+
+
+void btools::GenerateLods(CookedMesh* mesh, const MeshLodSettings& settings)
+{
+	mesh->Lods.clear();
+
+	size_t previousIndexCount = mesh->Indices.size();
+
+	for(size_t level = 0; level < settings.Ratios.size(); level++)
+	{
+		const float ratio = settings.Ratios[level];
+
+		CookedMeshLod lod;
+		lod.Info.ScreenSize = level < settings.ScreenSizes.size() ? settings.ScreenSizes[level] : ratio;
+
+		const size_t firstLodIndex = mesh->Indices.size();
+		std::vector<uint32_t> simplified;
+
+		for(const MeshSubmesh& source : mesh->Submeshes)
+		{
+			// Every level is simplified from LOD 0, so error doesn't accumulate down the chain
+			const size_t targetIndexCount = (size_t)(source.IndexCount * ratio) / 3 * 3;
+			float error = 0.0f;
+
+			simplified.resize(source.IndexCount);
+			simplified.resize(meshopt_simplify(simplified.data(), mesh->Indices.data() + source.FirstIndex, source.IndexCount,
+				mesh->Vertices[source.BaseVertex].Position, source.VertexCount, sizeof(MeshVertex),
+				targetIndexCount, settings.MaxError, 0, &error));
+
+			meshopt_optimizeVertexCache(simplified.data(), simplified.data(), simplified.size(), source.VertexCount);
+
+			MeshSubmesh submesh = source;
+			submesh.FirstIndex = mesh->Indices.size();
+			submesh.IndexCount = simplified.size();
+
+			mesh->Indices.insert(mesh->Indices.end(), simplified.begin(), simplified.end());
+			lod.Submeshes.push_back(submesh);
+			lod.Info.Error = std::max(lod.Info.Error, error);
+		}
+
+		const size_t lodIndexCount = mesh->Indices.size() - firstLodIndex;
+
+		// Simplification stops short of the target once MaxError is reached, and a level which isn't
+		// any simpler than the one before it would only cost memory
+		if(lodIndexCount == 0 || lodIndexCount >= previousIndexCount)
+		{
+			mesh->Indices.resize(firstLodIndex);
+			break;
+		}
+
+		previousIndexCount = lodIndexCount;
+		mesh->Lods.push_back(std::move(lod));
+	}
+}
+
+
+btools::VertexCacheStats btools::AnalyzeVertexCache(const CookedMesh& mesh, unsigned int cacheSize)
+{
+	uint64_t transformed = 0, vertexCount = 0;
+	std::vector<bool> referenced;
+
+	for(const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		const uint32_t* indices = mesh.Indices.data() + submesh.FirstIndex;
+
+		meshopt_VertexCacheStatistics stats = meshopt_analyzeVertexCache(indices,
+			submesh.IndexCount, submesh.VertexCount, cacheSize, 0, 0);
+
+		transformed += stats.vertices_transformed;
+
+		// Until vertex fetch optimization drops them, submeshes may hold vertices no triangle uses
+		referenced.assign(submesh.VertexCount, false);
+
+		for(uint32_t i = 0; i < submesh.IndexCount; i++)
+		{
+			if(!referenced[indices[i]])
+			{
+				referenced[indices[i]] = true;
+				vertexCount++;
+			}
+		}
+	}
+
+	VertexCacheStats stats;
+
+	if(!mesh.Indices.empty() && vertexCount)
+	{
+		stats.ACMR = (float)transformed / (mesh.Indices.size() / 3);
+		stats.ATVR = (float)transformed / vertexCount;
+	}
+
+	return stats;
+}
+
+
+bool btools::ParsePositionFormat(std::string_view name, PositionFormat* out)
+{
+	if(name == "Float3") *out = PositionFormat::Float3;
+	else if(name == "Unorm16x4") *out = PositionFormat::Unorm16x4;
+	else return false;
+
+	return true;
+}
+
+
+bool btools::ParseNormalFormat(std::string_view name, NormalFormat* out)
+{
+	if(name == "Float3") *out = NormalFormat::Float3;
+	else if(name == "Snorm8x4") *out = NormalFormat::Snorm8x4;
+	else if(name == "Oct16") *out = NormalFormat::Oct16;
+	else return false;
+
+	return true;
+}
+
+
+bool btools::ParseUVFormat(std::string_view name, UVFormat* out)
+{
+	if(name == "Float2") *out = UVFormat::Float2;
+	else if(name == "Half2") *out = UVFormat::Half2;
+	else return false;
+
+	return true;
+}
+
+
+void btools::WriteCookedMesh(CgfbWriter& out, const CookedMesh& mesh, const VertexFormat& format)
+{
+	MeshHeader header;
+	header.Format = format;
+	header.VertexStride = GetVertexStride(format);
+	header.VertexCount = mesh.Vertices.size();
+	header.IndexCount = mesh.Indices.size();
+	header.Indices = IndexFormat::UInt16;
+
+	for(const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		if(submesh.VertexCount > std::numeric_limits<uint16_t>::max() + 1)
+		{
+			header.Indices = IndexFormat::UInt32;
+		}
+	}
+
+	header.SubmeshCount = mesh.Submeshes.size();
+	header.LodCount = 1 + mesh.Lods.size();
+
+	std::copy_n(mesh.BoundsMin, 3, header.BoundsMin);
+	std::copy_n(mesh.BoundsMax, 3, header.BoundsMax);
+
+	// The header's serialized size depends on the stream's format version, so it's measured rather than assumed
+	CgfbMemoryWriter prefix;
+	prefix.SetFormatVersion(out.GetFormatVersion());
+	WriteMeshTables(prefix, header, mesh);
+
+	float boundsExtent[3];
+
+	for(int axis = 0; axis < 3; axis++)
+	{
+		boundsExtent[axis] = mesh.BoundsMax[axis] - mesh.BoundsMin[axis];
+	}
+
+	std::vector<char> vertexData;
+	vertexData.reserve((size_t)mesh.Vertices.size() * header.VertexStride);
+
+	for(const MeshVertex& vertex : mesh.Vertices)
+	{
+		EncodeVertex(vertex, format, mesh.BoundsMin, boundsExtent, vertexData);
+	}
+
+	const uint64_t vertexDataSize = vertexData.size();
+	const uint64_t prefixSize = prefix.GetBuffer().size();
+
+	header.VertexDataOffset = AlignUp(prefixSize, MESH_DATA_ALIGNMENT);
+	header.IndexDataOffset = AlignUp(header.VertexDataOffset + vertexDataSize, MESH_DATA_ALIGNMENT);
+
+	WriteMeshTables(out, header, mesh);
+
+	WritePadding(out, header.VertexDataOffset - prefixSize);
+	out.Write(vertexData.data(), vertexDataSize);
+	WritePadding(out, header.IndexDataOffset - header.VertexDataOffset - vertexDataSize);
+
+	if(header.Indices == IndexFormat::UInt16)
+	{
+		std::vector<uint16_t> narrowed (mesh.Indices.begin(), mesh.Indices.end());
+		out.Write((const char*)narrowed.data(), narrowed.size() * sizeof(uint16_t));
+	}
+	else
+	{
+		out.Write((const char*)mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+	}
+}
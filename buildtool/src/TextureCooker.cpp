@@ -0,0 +1,1270 @@
+#include "buildtool/TextureCooker.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <span>
+
+
+using namespace cgfb;
+
+
+namespace
+{
+
+constexpr uint32_t TEXTURE_DATA_ALIGNMENT = 16;
+
+
+void WritePadding(CgfbWriter& out, uint64_t size)
+{
+	static const char zeros[TEXTURE_DATA_ALIGNMENT] = {};
+
+	out.Write(zeros, size);
+}
+
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+/**
+ * @brief Writes everything preceding a cooked texture's mip data: its header and mip table
+ */
+void WriteTextureTables(CgfbWriter& out, const TextureHeader& header, const std::vector<TextureMip>& mips)
+{
+	WriteTextureHeader(out, header);
+
+	for(const TextureMip& mip : mips)
+	{
+		WriteTextureMip(out, mip);
+	}
+}
+
+
+const float* GetSRGBToLinearTable()
+{
+	static const auto table = []()
+	{
+		std::array<float, 256> values;
+
+		for(int i = 0; i < 256; i++)
+		{
+			const float c = i / 255.0f;
+			values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		return values;
+	}();
+
+	return table.data();
+}
+
+
+uint8_t LinearToSRGB(float c)
+{
+	c = std::clamp(c, 0.0f, 1.0f);
+	c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+
+	return (uint8_t)std::lround(c * 255.0f);
+}
+
+
+uint8_t ToUnorm8(float c)
+{
+	return (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+}
+
+
+/**
+ * @brief Calls filterRows(firstRow, endRow) over bands of an image's rows in parallel. Bands are sized so
+ * each is worth a task however narrow the image is, and the smallest mips are filtered in a single band.
+ */
+template<typename F>
+void ForEachRowBand(ThreadPool& pool, uint32_t width, uint32_t height, const F& filterRows)
+{
+	constexpr size_t bandPixelCount = 64 * 1024;
+
+	const uint32_t bandHeight = (uint32_t)std::clamp<size_t>(bandPixelCount / std::max(width, 1u), 1, height);
+	const uint32_t bandCount = (height + bandHeight - 1) / bandHeight;
+
+	pool.ParallelFor(bandCount, [&](size_t band)
+	{
+		const uint32_t firstRow = band * bandHeight;
+		filterRows(firstRow, std::min(firstRow + bandHeight, height));
+	});
+}
+
+
+/**
+ * @brief An image with linear, premultiplied color channels, which mip levels are filtered in so that
+ * transparent pixels' colors don't bleed into their neighbours
+ */
+struct FilterImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<float> Pixels;
+};
+
+
+FilterImage ToFilterImage(const btools::TextureImage& image, bool srgb, ThreadPool& pool)
+{
+	const float* toLinear = GetSRGBToLinearTable();
+
+	FilterImage result;
+	result.Width = image.Width;
+	result.Height = image.Height;
+	result.Pixels.resize(image.Pixels.size());
+
+	ForEachRowBand(pool, image.Width, image.Height, [&](uint32_t firstRow, uint32_t endRow)
+	{
+		for(size_t i = (size_t)firstRow * image.Width * 4; i < (size_t)endRow * image.Width * 4; i += 4)
+		{
+			const float alpha = image.Pixels[i + 3] / 255.0f;
+
+			for(int channel = 0; channel < 3; channel++)
+			{
+				const uint8_t value = image.Pixels[i + channel];
+				result.Pixels[i + channel] = (srgb ? toLinear[value] : value / 255.0f) * alpha;
+			}
+
+			result.Pixels[i + 3] = alpha;
+		}
+	});
+
+	return result;
+}
+
+
+btools::TextureImage FromFilterImage(const FilterImage& image, bool srgb, ThreadPool& pool)
+{
+	btools::TextureImage result;
+	result.Width = image.Width;
+	result.Height = image.Height;
+	result.Pixels.resize(image.Pixels.size());
+
+	ForEachRowBand(pool, image.Width, image.Height, [&](uint32_t firstRow, uint32_t endRow)
+	{
+		for(size_t i = (size_t)firstRow * image.Width * 4; i < (size_t)endRow * image.Width * 4; i += 4)
+		{
+			const float alpha = image.Pixels[i + 3];
+
+			for(int channel = 0; channel < 3; channel++)
+			{
+				const float value = alpha > 0.0f ? image.Pixels[i + channel] / alpha : 0.0f;
+				result.Pixels[i + channel] = srgb ? LinearToSRGB(value) : ToUnorm8(value);
+			}
+
+			result.Pixels[i + 3] = ToUnorm8(alpha);
+		}
+	});
+
+	return result;
+}
+
+
+/**
+ * @brief Halves an image with a box filter over each destination pixel's footprint, which for odd
+ * dimensions spans three source pixels so that none are dropped
+ */
+FilterImage Downsample(const FilterImage& image, ThreadPool& pool)
+{
+	FilterImage result;
+	result.Width = std::max(image.Width / 2, 1u);
+	result.Height = std::max(image.Height / 2, 1u);
+	result.Pixels.resize((size_t)result.Width * result.Height * 4);
+
+	ForEachRowBand(pool, result.Width, result.Height, [&](uint32_t firstRow, uint32_t endRow)
+	{
+		for(uint32_t y = firstRow; y < endRow; y++)
+		{
+			const uint32_t y0 = y * image.Height / result.Height;
+			const uint32_t y1 = std::max(y0 + 1, (y + 1) * image.Height / result.Height);
+
+			for(uint32_t x = 0; x < result.Width; x++)
+			{
+				const uint32_t x0 = x * image.Width / result.Width;
+				const uint32_t x1 = std::max(x0 + 1, (x + 1) * image.Width / result.Width);
+
+				float sum[4] = {};
+
+				for(uint32_t sy = y0; sy < y1; sy++)
+				{
+					for(uint32_t sx = x0; sx < x1; sx++)
+					{
+						const float* source = &image.Pixels[((size_t)sy * image.Width + sx) * 4];
+
+						for(int channel = 0; channel < 4; channel++)
+						{
+							sum[channel] += source[channel];
+						}
+					}
+				}
+
+				const float weight = 1.0f / ((y1 - y0) * (x1 - x0));
+				float* dest = &result.Pixels[((size_t)y * result.Width + x) * 4];
+
+				for(int channel = 0; channel < 4; channel++)
+				{
+					dest[channel] = sum[channel] * weight;
+				}
+			}
+		}
+	});
+
+	return result;
+}
+
+
+using PixelBlock = uint8_t[16][4];
+
+
+void FetchBlock(const btools::TextureImage& image, uint32_t blockX, uint32_t blockY, PixelBlock block)
+{
+	for(uint32_t y = 0; y < 4; y++)
+	{
+		const uint32_t sy = std::min(blockY * 4 + y, image.Height - 1);
+
+		for(uint32_t x = 0; x < 4; x++)
+		{
+			const uint32_t sx = std::min(blockX * 4 + x, image.Width - 1);
+
+			std::memcpy(block[y * 4 + x], &image.Pixels[((size_t)sy * image.Width + sx) * 4], 4);
+		}
+	}
+}
+
+
+/**
+ * @brief Packs bits into a block, least significant bit first
+ */
+struct BitWriter
+{
+	uint8_t* Out;
+	uint32_t Position = 0;
+
+	void Write(uint32_t value, uint32_t bitCount)
+	{
+		for(uint32_t i = 0; i < bitCount; i++, Position++)
+		{
+			if((value >> i) & 1)
+			{
+				Out[Position / 8] |= 1 << (Position % 8);
+			}
+		}
+	}
+};
+
+
+/**
+ * @brief Finds the line best fitting a block's pixels, by power iteration on their covariance
+ * @param mean Set to the pixels' mean
+ * @param axis Set to the direction of the line, or zero if every pixel is the same
+ */
+template<int Channels>
+void FitLine(const float pixels[16][4], float mean[4], float axis[4])
+{
+	float covariance[Channels][Channels] = {};
+	float min[Channels], max[Channels];
+
+	for(int c = 0; c < Channels; c++)
+	{
+		mean[c] = 0.0f;
+		min[c] = std::numeric_limits<float>::max();
+		max[c] = std::numeric_limits<float>::lowest();
+
+		for(int i = 0; i < 16; i++)
+		{
+			mean[c] += pixels[i][c] / 16.0f;
+			min[c] = std::min(min[c], pixels[i][c]);
+			max[c] = std::max(max[c], pixels[i][c]);
+		}
+	}
+
+	for(int i = 0; i < 16; i++)
+	{
+		for(int a = 0; a < Channels; a++)
+		{
+			for(int b = 0; b < Channels; b++)
+			{
+				covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+			}
+		}
+	}
+
+	// The bounding box's diagonal is a good first guess, and the iteration converges within a few steps
+	for(int c = 0; c < Channels; c++)
+	{
+		axis[c] = max[c] - min[c];
+	}
+
+	for(int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[Channels] = {};
+		float length = 0.0f;
+
+		for(int a = 0; a < Channels; a++)
+		{
+			for(int b = 0; b < Channels; b++)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+
+			length = std::max(length, std::abs(next[a]));
+		}
+
+		if(length <= 0.0f)
+		{
+			break;
+		}
+
+		for(int c = 0; c < Channels; c++)
+		{
+			axis[c] = next[c] / length;
+		}
+	}
+}
+
+
+/**
+ * @brief Finds the endpoints of the segment of a line spanning a block's pixels
+ */
+template<int Channels>
+void GetLineExtents(const float pixels[16][4], const float mean[4], const float axis[4], float start[4], float end[4])
+{
+	float lengthSquared = 0.0f;
+
+	for(int c = 0; c < Channels; c++)
+	{
+		lengthSquared += axis[c] * axis[c];
+	}
+
+	float minT = 0.0f, maxT = 0.0f;
+
+	if(lengthSquared > 0.0f)
+	{
+		minT = std::numeric_limits<float>::max();
+		maxT = std::numeric_limits<float>::lowest();
+
+		for(int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+
+			for(int c = 0; c < Channels; c++)
+			{
+				t += (pixels[i][c] - mean[c]) * axis[c];
+			}
+
+			minT = std::min(minT, t / lengthSquared);
+			maxT = std::max(maxT, t / lengthSquared);
+		}
+	}
+
+	for(int c = 0; c < Channels; c++)
+	{
+		start[c] = mean[c] + axis[c] * minT;
+		end[c] = mean[c] + axis[c] * maxT;
+	}
+}
+
+
+/**
+ * @brief Finds the endpoints minimizing the squared error of each pixel against its interpolated
+ * palette entry, given the fraction of the way from start to end each pixel's index selects
+ * @return False if the weights are degenerate, i.e. every pixel selects the same entry
+ */
+template<int Channels>
+bool FitEndpoints(const float pixels[16][4], const float weights[16], float start[4], float end[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+
+	for(int i = 0; i < 16; i++)
+	{
+		const float a = 1.0f - weights[i];
+		const float b = weights[i];
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for(int c = 0; c < Channels; c++)
+		{
+			ax[c] += a * pixels[i][c];
+			bx[c] += b * pixels[i][c];
+		}
+	}
+
+	const float determinant = aa * bb - ab * ab;
+
+	if(std::abs(determinant) < 1e-6f)
+	{
+		return false;
+	}
+
+	for(int c = 0; c < Channels; c++)
+	{
+		start[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+		end[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+	}
+
+	return true;
+}
+
+
+void ToFloatBlock(const PixelBlock block, float pixels[16][4])
+{
+	for(int i = 0; i < 16; i++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			pixels[i][c] = block[i][c];
+		}
+	}
+}
+
+
+uint16_t PackRGB565(const float color[4])
+{
+	const uint32_t r = std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f);
+	const uint32_t g = std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f);
+	const uint32_t b = std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f);
+
+	return (r << 11) | (g << 5) | b;
+}
+
+
+void UnpackRGB565(uint16_t packed, int color[3])
+{
+	const int r = (packed >> 11) & 31;
+	const int g = (packed >> 5) & 63;
+	const int b = packed & 31;
+
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+
+/**
+ * @brief Picks the nearest of a BC1 block's four colors for each pixel
+ * @return The block's total squared error
+ */
+int SelectColorIndices(const PixelBlock block, uint16_t color0, uint16_t color1, uint8_t indices[16])
+{
+	int palette[4][3];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+
+	for(int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	// Equal endpoints select BC1's three color mode, in which the fourth color is black
+	const int paletteSize = color0 == color1 ? 1 : 4;
+	int totalError = 0;
+
+	for(int i = 0; i < 16; i++)
+	{
+		int bestError = std::numeric_limits<int>::max();
+
+		for(int entry = 0; entry < paletteSize; entry++)
+		{
+			int error = 0;
+
+			for(int c = 0; c < 3; c++)
+			{
+				const int difference = block[i][c] - palette[entry][c];
+				error += difference * difference;
+			}
+
+			if(error < bestError)
+			{
+				bestError = error;
+				indices[i] = entry;
+			}
+		}
+
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+
+/**
+ * @brief Encodes the color of a block as BC1 in its four color mode, ignoring alpha. BC3 blocks embed
+ * the same encoding.
+ */
+void EncodeColorBlock(const PixelBlock block, uint8_t* out)
+{
+	float pixels[16][4], mean[4], axis[4], start[4], end[4];
+	ToFloatBlock(block, pixels);
+
+	FitLine<3>(pixels, mean, axis);
+	GetLineExtents<3>(pixels, mean, axis, start, end);
+
+	uint16_t color0 = PackRGB565(end);
+	uint16_t color1 = PackRGB565(start);
+	uint8_t indices[16];
+	int error = SelectColorIndices(block, color0, color1, indices);
+
+	// Refitting the endpoints to the chosen indices recovers much of the error lost to quantization
+	static constexpr float INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	for(int iteration = 0; iteration < 2 && error > 0; iteration++)
+	{
+		float weights[16];
+
+		for(int i = 0; i < 16; i++)
+		{
+			weights[i] = INDEX_WEIGHTS[indices[i]];
+		}
+
+		if(!FitEndpoints<3>(pixels, weights, start, end))
+		{
+			break;
+		}
+
+		const uint16_t refined0 = PackRGB565(start);
+		const uint16_t refined1 = PackRGB565(end);
+		uint8_t refinedIndices[16];
+		const int refinedError = SelectColorIndices(block, refined0, refined1, refinedIndices);
+
+		if(refinedError >= error)
+		{
+			break;
+		}
+
+		color0 = refined0;
+		color1 = refined1;
+		error = refinedError;
+		std::memcpy(indices, refinedIndices, sizeof(indices));
+	}
+
+	// The four color mode requires the first endpoint to be the greater; swapping the endpoints swaps
+	// the interpolated colors too
+	if(color0 < color1)
+	{
+		static constexpr uint8_t SWAPPED_INDICES[4] = { 1, 0, 3, 2 };
+
+		std::swap(color0, color1);
+
+		for(uint8_t& index : indices)
+		{
+			index = SWAPPED_INDICES[index];
+		}
+	}
+
+	uint32_t packedIndices = 0;
+
+	for(int i = 0; i < 16; i++)
+	{
+		packedIndices |= (uint32_t)indices[i] << (i * 2);
+	}
+
+	out[0] = color0 & 0xFF;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF;
+	out[3] = color1 >> 8;
+	std::memcpy(out + 4, &packedIndices, 4);
+}
+
+
+/**
+ * @brief Encodes a single channel of a block as BC4, as used for BC3's alpha and each of BC5's channels
+ */
+void EncodeChannelBlock(const PixelBlock block, int channel, uint8_t* out)
+{
+	uint8_t min = 255, max = 0;
+
+	for(int i = 0; i < 16; i++)
+	{
+		min = std::min(min, block[i][channel]);
+		max = std::max(max, block[i][channel]);
+	}
+
+	std::memset(out, 0, 8);
+	out[0] = max;
+	out[1] = min;
+
+	if(min == max)
+	{
+		return;
+	}
+
+	// With the first endpoint the greater, the other six values are interpolated between the two
+	int palette[8] = { max, min };
+
+	for(int entry = 2; entry < 8; entry++)
+	{
+		palette[entry] = ((8 - entry) * max + (entry - 1) * min) / 7;
+	}
+
+	BitWriter bits { out + 2 };
+
+	for(int i = 0; i < 16; i++)
+	{
+		int bestIndex = 0;
+		int bestError = std::numeric_limits<int>::max();
+
+		for(int entry = 0; entry < 8; entry++)
+		{
+			const int error = std::abs(block[i][channel] - palette[entry]);
+
+			if(error < bestError)
+			{
+				bestError = error;
+				bestIndex = entry;
+			}
+		}
+
+		bits.Write(bestIndex, 3);
+	}
+}
+
+
+constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+/**
+ * @brief A pair of BC7 mode 6 endpoints, each with 7 bits per channel and a shared low bit
+ */
+struct Mode6Endpoints
+{
+	uint8_t Values[2][4];
+	uint8_t PBits[2];
+
+	uint8_t Expand(int endpoint, int channel) const
+	{
+		return (Values[endpoint][channel] << 1) | PBits[endpoint];
+	}
+};
+
+
+uint8_t QuantizeMode6(float value, int pBit)
+{
+	return (uint8_t)std::clamp<long>(std::lround((value - pBit) / 2.0f), 0, 127);
+}
+
+
+/**
+ * @brief Picks the nearest of a BC7 mode 6 block's sixteen colors for each pixel
+ * @return The block's total squared error
+ */
+int SelectMode6Indices(const PixelBlock block, const Mode6Endpoints& endpoints, uint8_t indices[16])
+{
+	int palette[16][4];
+
+	for(int entry = 0; entry < 16; entry++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			palette[entry][c] = ((64 - BC7_WEIGHTS[entry]) * endpoints.Expand(0, c) + BC7_WEIGHTS[entry] * endpoints.Expand(1, c) + 32) >> 6;
+		}
+	}
+
+	int totalError = 0;
+
+	for(int i = 0; i < 16; i++)
+	{
+		int bestError = std::numeric_limits<int>::max();
+
+		for(int entry = 0; entry < 16; entry++)
+		{
+			int error = 0;
+
+			for(int c = 0; c < 4; c++)
+			{
+				const int difference = block[i][c] - palette[entry][c];
+				error += difference * difference;
+			}
+
+			if(error < bestError)
+			{
+				bestError = error;
+				indices[i] = entry;
+			}
+		}
+
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+
+/**
+ * @brief Quantizes a pair of endpoints, trying every combination of low bits
+ * @return The block's total squared error with the best combination
+ */
+int QuantizeMode6Endpoints(const PixelBlock block, const float start[4], const float end[4], Mode6Endpoints* endpoints, uint8_t indices[16])
+{
+	int bestError = std::numeric_limits<int>::max();
+
+	for(int pBits = 0; pBits < 4; pBits++)
+	{
+		Mode6Endpoints candidate;
+		candidate.PBits[0] = pBits & 1;
+		candidate.PBits[1] = pBits >> 1;
+
+		for(int c = 0; c < 4; c++)
+		{
+			candidate.Values[0][c] = QuantizeMode6(start[c], candidate.PBits[0]);
+			candidate.Values[1][c] = QuantizeMode6(end[c], candidate.PBits[1]);
+		}
+
+		uint8_t candidateIndices[16];
+		const int error = SelectMode6Indices(block, candidate, candidateIndices);
+
+		if(error < bestError)
+		{
+			bestError = error;
+			*endpoints = candidate;
+			std::memcpy(indices, candidateIndices, 16);
+		}
+	}
+
+	return bestError;
+}
+
+
+/**
+ * @brief Fits a block with BC7 mode 6: a single RGBA line with 4 bit indices
+ * @return The block's total squared error
+ */
+int FitMode6(const PixelBlock block, const float pixels[16][4], Mode6Endpoints* endpoints, uint8_t indices[16])
+{
+	float mean[4], axis[4], start[4], end[4];
+
+	FitLine<4>(pixels, mean, axis);
+	GetLineExtents<4>(pixels, mean, axis, start, end);
+
+	int error = QuantizeMode6Endpoints(block, start, end, endpoints, indices);
+
+	for(int iteration = 0; iteration < 2 && error > 0; iteration++)
+	{
+		float weights[16];
+
+		for(int i = 0; i < 16; i++)
+		{
+			weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+		}
+
+		if(!FitEndpoints<4>(pixels, weights, start, end))
+		{
+			break;
+		}
+
+		Mode6Endpoints refined;
+		uint8_t refinedIndices[16];
+		const int refinedError = QuantizeMode6Endpoints(block, start, end, &refined, refinedIndices);
+
+		if(refinedError >= error)
+		{
+			break;
+		}
+
+		*endpoints = refined;
+		error = refinedError;
+		std::memcpy(indices, refinedIndices, 16);
+	}
+
+	return error;
+}
+
+
+void WriteMode6(Mode6Endpoints endpoints, uint8_t indices[16], uint8_t* out)
+{
+	// The first pixel's index is stored without its high bit, so it must select the first half of
+	// the palette; swapping the endpoints mirrors every index
+	if(indices[0] >= 8)
+	{
+		std::swap(endpoints.Values[0], endpoints.Values[1]);
+		std::swap(endpoints.PBits[0], endpoints.PBits[1]);
+
+		for(int i = 0; i < 16; i++)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	std::memset(out, 0, 16);
+	BitWriter bits { out };
+
+	bits.Write(1 << 6, 7);
+
+	for(int c = 0; c < 4; c++)
+	{
+		bits.Write(endpoints.Values[0][c], 7);
+		bits.Write(endpoints.Values[1][c], 7);
+	}
+
+	bits.Write(endpoints.PBits[0], 1);
+	bits.Write(endpoints.PBits[1], 1);
+
+	for(int i = 0; i < 16; i++)
+	{
+		bits.Write(indices[i], i == 0 ? 3 : 4);
+	}
+}
+
+
+constexpr int BC7_WEIGHTS_2BIT[4] = { 0, 21, 43, 64 };
+
+
+/**
+ * @brief A pair of BC7 mode 5 endpoints: 7 bits per color channel, and 8 bits of alpha interpolated
+ * along its own line
+ */
+struct Mode5Endpoints
+{
+	uint8_t Color[2][3];
+	uint8_t Alpha[2];
+
+	uint8_t Expand(int endpoint, int channel) const
+	{
+		return (Color[endpoint][channel] << 1) | (Color[endpoint][channel] >> 6);
+	}
+};
+
+
+/**
+ * @brief Picks the nearest of a BC7 mode 5 block's four colors and four alphas for each pixel
+ * @return The block's total squared error
+ */
+int SelectMode5Indices(const PixelBlock block, const Mode5Endpoints& endpoints, uint8_t colorIndices[16], uint8_t alphaIndices[16])
+{
+	int colors[4][3], alphas[4];
+
+	for(int entry = 0; entry < 4; entry++)
+	{
+		const int weight = BC7_WEIGHTS_2BIT[entry];
+
+		for(int c = 0; c < 3; c++)
+		{
+			colors[entry][c] = ((64 - weight) * endpoints.Expand(0, c) + weight * endpoints.Expand(1, c) + 32) >> 6;
+		}
+
+		alphas[entry] = ((64 - weight) * endpoints.Alpha[0] + weight * endpoints.Alpha[1] + 32) >> 6;
+	}
+
+	int totalError = 0;
+
+	for(int i = 0; i < 16; i++)
+	{
+		int bestColorError = std::numeric_limits<int>::max();
+		int bestAlphaError = std::numeric_limits<int>::max();
+
+		for(int entry = 0; entry < 4; entry++)
+		{
+			int colorError = 0;
+
+			for(int c = 0; c < 3; c++)
+			{
+				const int difference = block[i][c] - colors[entry][c];
+				colorError += difference * difference;
+			}
+
+			const int alphaError = (block[i][3] - alphas[entry]) * (block[i][3] - alphas[entry]);
+
+			if(colorError < bestColorError)
+			{
+				bestColorError = colorError;
+				colorIndices[i] = entry;
+			}
+
+			if(alphaError < bestAlphaError)
+			{
+				bestAlphaError = alphaError;
+				alphaIndices[i] = entry;
+			}
+		}
+
+		totalError += bestColorError + bestAlphaError;
+	}
+
+	return totalError;
+}
+
+
+void QuantizeMode5Color(const float start[4], const float end[4], Mode5Endpoints* endpoints)
+{
+	for(int c = 0; c < 3; c++)
+	{
+		endpoints->Color[0][c] = (uint8_t)std::lround(std::clamp(start[c], 0.0f, 255.0f) * 127.0f / 255.0f);
+		endpoints->Color[1][c] = (uint8_t)std::lround(std::clamp(end[c], 0.0f, 255.0f) * 127.0f / 255.0f);
+	}
+}
+
+
+/**
+ * @brief Fits a block with BC7 mode 5, which fits color and alpha separately and so suits blocks whose
+ * transparency doesn't follow their color, i.e. the edges of sprites
+ * @return The block's total squared error
+ */
+int FitMode5(const PixelBlock block, const float pixels[16][4], Mode5Endpoints* endpoints, uint8_t colorIndices[16], uint8_t alphaIndices[16])
+{
+	float mean[4], axis[4], start[4], end[4];
+
+	FitLine<3>(pixels, mean, axis);
+	GetLineExtents<3>(pixels, mean, axis, start, end);
+	QuantizeMode5Color(start, end, endpoints);
+
+	endpoints->Alpha[0] = 255;
+	endpoints->Alpha[1] = 0;
+
+	for(int i = 0; i < 16; i++)
+	{
+		endpoints->Alpha[0] = std::min(endpoints->Alpha[0], block[i][3]);
+		endpoints->Alpha[1] = std::max(endpoints->Alpha[1], block[i][3]);
+	}
+
+	int error = SelectMode5Indices(block, *endpoints, colorIndices, alphaIndices);
+
+	for(int iteration = 0; iteration < 2 && error > 0; iteration++)
+	{
+		float weights[16];
+
+		for(int i = 0; i < 16; i++)
+		{
+			weights[i] = BC7_WEIGHTS_2BIT[colorIndices[i]] / 64.0f;
+		}
+
+		if(!FitEndpoints<3>(pixels, weights, start, end))
+		{
+			break;
+		}
+
+		Mode5Endpoints refined = *endpoints;
+		QuantizeMode5Color(start, end, &refined);
+
+		uint8_t refinedColorIndices[16], refinedAlphaIndices[16];
+		const int refinedError = SelectMode5Indices(block, refined, refinedColorIndices, refinedAlphaIndices);
+
+		if(refinedError >= error)
+		{
+			break;
+		}
+
+		*endpoints = refined;
+		error = refinedError;
+		std::memcpy(colorIndices, refinedColorIndices, 16);
+		std::memcpy(alphaIndices, refinedAlphaIndices, 16);
+	}
+
+	return error;
+}
+
+
+void WriteMode5(Mode5Endpoints endpoints, uint8_t colorIndices[16], uint8_t alphaIndices[16], uint8_t* out)
+{
+	// As with mode 6, each set of indices stores its first index without its high bit
+	if(colorIndices[0] >= 2)
+	{
+		std::swap(endpoints.Color[0], endpoints.Color[1]);
+
+		for(int i = 0; i < 16; i++)
+		{
+			colorIndices[i] = 3 - colorIndices[i];
+		}
+	}
+
+	if(alphaIndices[0] >= 2)
+	{
+		std::swap(endpoints.Alpha[0], endpoints.Alpha[1]);
+
+		for(int i = 0; i < 16; i++)
+		{
+			alphaIndices[i] = 3 - alphaIndices[i];
+		}
+	}
+
+	std::memset(out, 0, 16);
+	BitWriter bits { out };
+
+	bits.Write(1 << 5, 6);
+
+	// No channel rotation
+	bits.Write(0, 2);
+
+	for(int c = 0; c < 3; c++)
+	{
+		bits.Write(endpoints.Color[0][c], 7);
+		bits.Write(endpoints.Color[1][c], 7);
+	}
+
+	bits.Write(endpoints.Alpha[0], 8);
+	bits.Write(endpoints.Alpha[1], 8);
+
+	for(int i = 0; i < 16; i++)
+	{
+		bits.Write(colorIndices[i], i == 0 ? 1 : 2);
+	}
+
+	for(int i = 0; i < 16; i++)
+	{
+		bits.Write(alphaIndices[i], i == 0 ? 1 : 2);
+	}
+}
+
+
+/**
+ * @brief Encodes a block as BC7 mode 6, or as mode 5 where its alpha varies and that fits it better.
+ * BC7's partitioned modes aren't searched, which costs some quality on blocks spanning several
+ * distinct colors but keeps encoding fast.
+ */
+void EncodeBC7Block(const PixelBlock block, uint8_t* out)
+{
+	float pixels[16][4];
+	ToFloatBlock(block, pixels);
+
+	Mode6Endpoints endpoints;
+	uint8_t indices[16];
+	const int error = FitMode6(block, pixels, &endpoints, indices);
+
+	bool alphaVaries = false;
+
+	for(int i = 1; i < 16; i++)
+	{
+		alphaVaries |= block[i][3] != block[0][3];
+	}
+
+	if(alphaVaries && error > 0)
+	{
+		Mode5Endpoints separateEndpoints;
+		uint8_t colorIndices[16], alphaIndices[16];
+
+		if(FitMode5(block, pixels, &separateEndpoints, colorIndices, alphaIndices) < error)
+		{
+			WriteMode5(separateEndpoints, colorIndices, alphaIndices, out);
+			return;
+		}
+	}
+
+	WriteMode6(endpoints, indices, out);
+}
+
+
+void EncodeBlock(const PixelBlock block, TextureEncoding encoding, uint8_t* out)
+{
+	switch(encoding)
+	{
+	case TextureEncoding::BC1:
+		EncodeColorBlock(block, out);
+		break;
+
+	case TextureEncoding::BC3:
+		EncodeChannelBlock(block, 3, out);
+		EncodeColorBlock(block, out + 8);
+		break;
+
+	case TextureEncoding::BC5:
+		EncodeChannelBlock(block, 0, out);
+		EncodeChannelBlock(block, 1, out + 8);
+		break;
+
+	case TextureEncoding::BC7:
+		EncodeBC7Block(block, out);
+		break;
+
+	default:
+		break;
+	}
+}
+
+}
+
+
+bool btools::ParseTextureEncoding(std::string_view name, TextureEncoding* out)
+{
+	if(name == "RGBA8") *out = TextureEncoding::RGBA8;
+	else if(name == "BC1") *out = TextureEncoding::BC1;
+	else if(name == "BC3") *out = TextureEncoding::BC3;
+	else if(name == "BC5") *out = TextureEncoding::BC5;
+	else if(name == "BC7") *out = TextureEncoding::BC7;
+	else return false;
+
+	return true;
+}
+
+
+const char* btools::GetTextureEncodingName(TextureEncoding encoding)
+{
+	switch(encoding)
+	{
+	case TextureEncoding::BC1: return "BC1";
+	case TextureEncoding::BC3: return "BC3";
+	case TextureEncoding::BC5: return "BC5";
+	case TextureEncoding::BC7: return "BC7";
+	default: return "RGBA8";
+	}
+}
+
+
+std::vector<btools::TextureImage> btools::GenerateMipChain(TextureImage image, bool srgb, ThreadPool* pool)
+{
+	ThreadPool& threads = pool ? *pool : ThreadPool::GetShared();
+
+	// Each level is filtered from the previous one at full precision, rather than from its 8 bit
+	// encoding, so rounding error doesn't accumulate down the chain
+	FilterImage level = ToFilterImage(image, srgb, threads);
+
+	std::vector<TextureImage> mips;
+	mips.push_back(std::move(image));
+
+	while(level.Width > 1 || level.Height > 1)
+	{
+		level = Downsample(level, threads);
+		mips.push_back(FromFilterImage(level, srgb, threads));
+	}
+
+	return mips;
+}
+
+
+namespace
+{
+
+/**
+ * @brief Encodes each level, with every level's rows of blocks encoded as one batch; encoded a level at a
+ * time, the small levels at the end of a mip chain would each leave most threads idle
+ */
+std::vector<std::vector<uint8_t>> EncodeLevels(std::span<const btools::TextureImage* const> levels, TextureEncoding encoding, ThreadPool& pool)
+{
+	const uint32_t blockSize = GetBlockSize(encoding);
+
+	std::vector<std::vector<uint8_t>> encoded (levels.size());
+
+	if(blockSize == 0)
+	{
+		for(size_t i = 0; i < levels.size(); i++)
+		{
+			encoded[i] = levels[i]->Pixels;
+		}
+
+		return encoded;
+	}
+
+	struct BlockRow
+	{
+		uint32_t Level;
+		uint32_t BlockY;
+	};
+
+	std::vector<BlockRow> rows;
+
+	for(size_t i = 0; i < levels.size(); i++)
+	{
+		encoded[i].resize(GetMipDataSize(encoding, levels[i]->Width, levels[i]->Height));
+
+		for(uint32_t blockY = 0; blockY < (levels[i]->Height + 3) / 4; blockY++)
+		{
+			rows.push_back({ (uint32_t)i, blockY });
+		}
+	}
+
+	pool.ParallelFor(rows.size(), [&](size_t i)
+	{
+		const btools::TextureImage& image = *levels[rows[i].Level];
+		const uint32_t blocksWide = (image.Width + 3) / 4;
+		const uint32_t blockY = rows[i].BlockY;
+
+		PixelBlock block;
+
+		for(uint32_t blockX = 0; blockX < blocksWide; blockX++)
+		{
+			FetchBlock(image, blockX, blockY, block);
+			EncodeBlock(block, encoding, &encoded[rows[i].Level][((size_t)blockY * blocksWide + blockX) * blockSize]);
+		}
+	});
+
+	return encoded;
+}
+
+}
+
+
+std::vector<uint8_t> btools::EncodeImage(const TextureImage& image, TextureEncoding encoding, ThreadPool* pool)
+{
+	const TextureImage* level = &image;
+
+	return std::move(EncodeLevels({ &level, 1 }, encoding, pool ? *pool : ThreadPool::GetShared()).front());
+}
+
+
+std::vector<std::vector<uint8_t>> btools::EncodeMipChain(const std::vector<TextureImage>& mips, TextureEncoding encoding, ThreadPool* pool)
+{
+	std::vector<const TextureImage*> levels;
+
+	for(const TextureImage& mip : mips)
+	{
+		levels.push_back(&mip);
+	}
+
+	return EncodeLevels(levels, encoding, pool ? *pool : ThreadPool::GetShared());
+}
+
+
+void btools::WriteCookedTexture(CgfbWriter& out, const std::vector<TextureImage>& mips, const TextureSettings& settings, ThreadPool* pool)
+{
+	WriteCookedTexture(out, mips, EncodeMipChain(mips, settings.Encoding, pool), settings);
+}
+
+
+void btools::WriteCookedTexture(CgfbWriter& out, 
+	const std::vector<TextureImage>& mips, 
+	const std::vector<std::vector<uint8_t>>& encodedMips, 
+	const TextureSettings& settings)
+{
+	TextureHeader header;
+	header.Encoding = settings.Encoding;
+	header.SRGB = settings.SRGB;
+	header.Width = mips.front().Width;
+	header.Height = mips.front().Height;
+	header.MipCount = mips.size();
+
+	std::vector<TextureMip> table (mips.size());
+
+	for(size_t i = 0; i < mips.size(); i++)
+	{
+		table[i].Width = mips[i].Width;
+		table[i].Height = mips[i].Height;
+		table[i].RowPitch = GetRowPitch(settings.Encoding, mips[i].Width);
+		table[i].DataSize = GetMipDataSize(settings.Encoding, mips[i].Width, mips[i].Height);
+	}
+
+	// The tables' serialized size depends on the stream's format version, so it's measured rather than assumed
+	CgfbMemoryWriter prefix;
+	prefix.SetFormatVersion(out.GetFormatVersion());
+	WriteTextureTables(prefix, header, table);
+
+	uint64_t position = prefix.GetBuffer().size();
+
+	for(TextureMip& mip : table)
+	{
+		mip.DataOffset = AlignUp(position, TEXTURE_DATA_ALIGNMENT);
+		position = mip.DataOffset + mip.DataSize;
+	}
+
+	WriteTextureTables(out, header, table);
+	position = prefix.GetBuffer().size();
+
+	for(size_t i = 0; i < mips.size(); i++)
+	{
+		const std::vector<uint8_t>& encoded = encodedMips[i];
+
+		assert(encoded.size() == table[i].DataSize);
+
+		WritePadding(out, table[i].DataOffset - position);
+		out.Write((const char*)encoded.data(), encoded.size());
+		position = table[i].DataOffset + table[i].DataSize;
+	}
+}
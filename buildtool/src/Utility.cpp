@@ -1,33 +1,62 @@
 #include "buildtool/Utility.h"
 
-#include <iostream>
+#include <filesystem>
 #include <fstream>
 
 
-void btools::ReadFileContents(const char* filePath, char** buff, int* buffSize)
+using namespace btools;
+
+
+FileContents::FileContents(const char* filePath, FileReadMode mode)
 {
-	static char* fileStreamBuffer = new char[FILE_READ_CHUNK_SIZE];
-	std::ifstream file (filePath, std::ios_base::binary);
+	Open(filePath, mode);
+}
+
+
+bool FileContents::Open(const char* filePath, FileReadMode mode)
+{
+	Close();
+
+	std::error_code error;
+	const uintmax_t size = std::filesystem::file_size(filePath, error);
+
+	if(error)
+	{
+		return false;
+	}
+
+	const bool map = mode == FileReadMode::Map || (mode == FileReadMode::Auto && size >= FILE_MAP_THRESHOLD);
 
-	char* readBuffer = nullptr;
-	int readBufferSize = 0;
+	// Mapping fails on empty files, which are read instead
+	if(map && size > 0 && m_Mapping.Open(filePath))
+	{
+		m_Open = true;
+		return true;
+	}
+
+	std::ifstream file (filePath, std::ios_base::binary);
 
-	do
+	if(!file)
 	{
-		file.read(fileStreamBuffer, FILE_READ_CHUNK_SIZE);
-		int bytesRead = file.gcount();
-	
-		int resizedReadBufferSize = readBufferSize + bytesRead;
-		char* resizedReadBuffer = new char[resizedReadBufferSize];
-
-		std::memcpy(resizedReadBuffer, readBuffer, readBufferSize); // copy bytes from old buffer to new
-		std::memcpy(resizedReadBuffer + readBufferSize, fileStreamBuffer, bytesRead); // append bytes read onto resized buffer
-
-		readBuffer = resizedReadBuffer;
-		readBufferSize = resizedReadBufferSize;
-	} 
-	while (file.is_open() && !file.eof());
-
-	*buff = readBuffer;
-	*buffSize = readBufferSize;
-}
\ No newline at end of file
+		return false;
+	}
+
+	m_Buffer.resize(size);
+	file.read(m_Buffer.data(), m_Buffer.size());
+
+	// The file may have shrunk since it was sized
+	m_Buffer.resize(file.gcount());
+	m_Open = true;
+
+	return true;
+}
+
+
+void FileContents::Close()
+{
+	m_Open = false;
+	m_Mapping.Close();
+
+	// Releases the buffer's memory as well as its contents
+	std::vector<char>().swap(m_Buffer);
+}
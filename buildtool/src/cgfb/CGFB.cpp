@@ -1,17 +1,28 @@
 #include "cgfb/CGFB.h"
 
 #include <cassert>
-#include <iostream>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 
 
 using namespace cgfb;
-#define LOG(x) std::cout << x << std::endl;
 
 
 CgfbFileWriter::CgfbFileWriter(const char *filePath)
-	: m_File(filePath, std::ios_base::binary)
 {
+	// Writes are already gathered into large chunks, so the stream's own buffer would only add a copy
+	m_File.rdbuf()->pubsetbuf(nullptr, 0);
+	m_File.open(filePath, std::ios_base::binary);
 
+	m_WriteBuffer.reserve(CGFB_WRITE_BUFFER_SIZE);
+
+	// Reserves the header, which is written by Flush() once the directory's location is known
+	static const char header[CgfbHeader::SerializedSize] = {};
+	WriteToFile(header, sizeof(header));
 }
 
 
@@ -21,69 +32,662 @@ cgfb::CgfbFileWriter::~CgfbFileWriter()
 }
 
 
-void CgfbFileWriter::WriteToStream(char* data, int count)
+void CgfbFileWriter::WriteToStream(const char* data, size_t count)
 {
 	assert(m_WithinBlock);
 
-	m_DataStream.Write(data, count);
+	m_BlockStream.Write(data, count);
+}
+
+
+void CgfbFileWriter::EndBlock()
+{
+	m_WithinBlock = false;
+
+	std::span<const char> payload (m_BlockStream.GetBuffer());
+
+	assert(!payload.empty());
+
+	BlockInfo info = m_CurrentBlock;
+	info.UncompressedSize = payload.size();
+
+	std::vector<char> compressed = EncodeBlock(payload, m_CurrentCompression, m_ThreadPool, &info.EncodeTime);
+
+	if(!compressed.empty())
+	{
+		info.Compression = m_CurrentCompression.Codec;
+		payload = compressed;
+	}
+
+	WriteEncodedBlock(info, payload);
+	m_BlockStream.Clear();
+}
+
+
+void CgfbFileWriter::WriteEncodedBlock(BlockInfo info, std::span<const char> stored)
+{
+	if(m_WithinBlock)
+	{
+		EndBlock();
+	}
+
+	assert(info.Alignment && (info.Alignment & (info.Alignment - 1)) == 0);
+
+	Pad(info.Alignment);
+
+	info.Offset = GetFileOffset();
+	info.Size = stored.size();
+	info.UncompressedSize = info.UncompressedSize ? info.UncompressedSize : stored.size();
+
+	WriteToFile(stored.data(), stored.size());
+	m_BlockData.push_back(std::move(info));
+}
+
+
+bool CgfbFileWriter::Flush()
+{
+	if(m_Flushed)
+	{
+		return m_File.good();
+	}
+
+	if(m_WithinBlock)
+	{
+		EndBlock();
+	}
+
+	m_Flushed = true;
+
+	// Directory entries hold 64-bit fields and are read in place
+	Pad(alignof(DirectoryEntry));
+
+	CgfbMemoryWriter directory;
+	WriteDirectory(directory, m_BlockData);
+
+	CgfbHeader header;
+	header.DirectoryOffset = GetFileOffset();
+	header.DirectorySize = directory.GetBuffer().size();
+	header.BlockCount = m_BlockData.size();
+
+	WriteToFile(directory.GetBuffer().data(), directory.GetBuffer().size());
+	FlushWriteBuffer();
+
+	CgfbMemoryWriter headerData;
+	headerData.Write(header);
+
+	assert(headerData.GetBuffer().size() == CgfbHeader::SerializedSize);
+
+	m_File.seekp(0);
+	m_File.write(headerData.GetBuffer().data(), headerData.GetBuffer().size());
+	m_File.flush();
+
+	return m_File.good();
+}
+
+
+void CgfbFileWriter::WriteToFile(const char* data, size_t count)
+{
+	m_FileOffset += count;
+
+	if(m_WriteBuffer.size() + count > CGFB_WRITE_BUFFER_SIZE)
+	{
+		FlushWriteBuffer();
+	}
+
+	// Payloads too large to buffer are written straight from where they are, rather than copied in pieces
+	if(count >= CGFB_WRITE_BUFFER_SIZE)
+	{
+		m_File.write(data, count);
+		return;
+	}
+
+	m_WriteBuffer.insert(m_WriteBuffer.end(), data, data + count);
+}
+
+
+void CgfbFileWriter::FlushWriteBuffer()
+{
+	m_File.write(m_WriteBuffer.data(), m_WriteBuffer.size());
+	m_WriteBuffer.clear();
+}
+
+
+std::vector<char> cgfb::EncodeBlock(std::span<const char> payload, const CompressionSettings& compression, ThreadPool* pool, double* encodeTime)
+{
+	if(compression.Codec == CompressionCodec::None)
+	{
+		return {};
+	}
+
+	auto encodeStart = std::chrono::steady_clock::now();
+	std::vector<char> compressed = CompressBlock(payload, compression, pool);
+
+	if(encodeTime)
+	{
+		*encodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count();
+	}
+
+	// Blocks that don't shrink are stored as they are, sparing readers a pointless decode
+	if(compressed.size() >= payload.size())
+	{
+		return {};
+	}
+
+	return compressed;
+}
+
+
+CgfbFileReader::CgfbFileReader(const char *filePath, CgfbReadMode mode)
+	: m_Mode(mode)
+{
+	if(m_Mode == CgfbReadMode::Mapped)
+	{
+		if(!m_Mapping.Open(filePath))
+		{
+			throw std::runtime_error(std::string("Failed to map CGFB file ") + filePath);
+		}
+
+		m_FileSize = m_Mapping.GetSize();
+	}
+	else
+	{
+		m_File.open(filePath, std::ios_base::binary);
+
+		if(!m_File.good())
+		{
+			throw std::runtime_error(std::string("Failed to open CGFB file ") + filePath);
+		}
+
+		m_File.seekg(0, std::ios_base::end);
+		m_FileSize = m_File.tellg();
+		m_File.seekg(0, std::ios_base::beg);
+	}
+
+	ReadDirectory();
+}
+
+
+void CgfbFileReader::ReadDirectory()
+{
+	uint32_t magic = 0;
+	ReadFromStream((char*)&magic, sizeof(magic));
+	SeekStreamPosition(0);
+
+	if(magic != CGFB_MAGIC)
+	{
+		ReadLegacyDirectory();
+		return;
+	}
+
+	CgfbHeader header;
+	Read(&header);
+
+	if(header.Version < 2 || header.Version > CGFB_VERSION)
+	{
+		throw std::runtime_error("CGFB file version " + std::to_string(header.Version) + " is unsupported");
+	}
+
+	if(header.DirectoryOffset % alignof(DirectoryEntry) != 0)
+	{
+		throw std::runtime_error("CGFB file's directory is misaligned");
+	}
+
+	// Checked before anything is allocated or read from it, as a truncated file's sizes can't be trusted
+	CheckRange(header.DirectoryOffset, header.DirectorySize, "directory");
+
+	if(header.BlockCount > header.DirectorySize / sizeof(DirectoryEntry))
+	{
+		throw std::runtime_error("CGFB file's directory is too small for its " + std::to_string(header.BlockCount) + " blocks");
+	}
+
+	SetFormatVersion(header.Version);
+
+	const char* directory;
+
+	if(m_Mode == CgfbReadMode::Mapped)
+	{
+		directory = m_Mapping.GetData() + header.DirectoryOffset;
+	}
+	else
+	{
+		m_DirectoryStorage.resize(header.DirectorySize);
+
+		SeekStreamPosition(header.DirectoryOffset);
+		Read(m_DirectoryStorage.data(), m_DirectoryStorage.size());
+
+		directory = m_DirectoryStorage.data();
+	}
+
+	m_EntryCount = header.BlockCount;
+	m_Entries = (const DirectoryEntry*)directory;
+	m_StringTable = directory + m_EntryCount * sizeof(DirectoryEntry);
+
+	const uint64_t stringTableSize = header.DirectorySize - m_EntryCount * sizeof(DirectoryEntry);
+
+	for(const DirectoryEntry& entry : GetBlocks())
+	{
+		if(entry.NameOffset > stringTableSize || entry.NameLength > stringTableSize - entry.NameOffset)
+		{
+			throw std::runtime_error("CGFB file's directory names a block outside its string table");
+		}
+
+		CheckRange(entry.Offset, entry.Size, "block");
+	}
+}
+
+
+void CgfbFileReader::CheckRange(uint64_t offset, uint64_t size, const char* what) const
+{
+	if(offset > m_FileSize || size > m_FileSize - offset)
+	{
+		throw std::runtime_error(std::string("CGFB file is truncated: its ") + what + " at " + std::to_string(offset)
+			+ " runs past the end of the file, " + std::to_string(m_FileSize) + " bytes long");
+	}
 }
 
 
-CgfbFileReader::CgfbFileReader(const char *filePath)
-	: m_File(filePath, std::ios_base::binary)
+void CgfbFileReader::ReadLegacyDirectory()
 {
-	assert(m_File.good());
+	// v1 files begin with a serialized map of names to blocks, and store block offsets relative to its end
+	SetFormatVersion(1);
+
+	std::unordered_map<std::string, BlockInfo> legacyDirectory;
+	CgfbReader::Read(&legacyDirectory);
+
+	uint64_t blockDataOffset = GetPosition();
+	std::vector<BlockInfo> blocks;
+	blocks.reserve(legacyDirectory.size());
+
+	for(auto& [name, info] : legacyDirectory)
+	{
+		info.Name = name;
+		info.Offset += blockDataOffset;
+		blocks.push_back(info);
+	}
+
+	CgfbMemoryWriter directory;
+	WriteDirectory(directory, blocks);
+
+	m_DirectoryStorage = directory.GetBuffer();
+	m_EntryCount = blocks.size();
+	m_Entries = (const DirectoryEntry*)m_DirectoryStorage.data();
+	m_StringTable = m_DirectoryStorage.data() + m_EntryCount * sizeof(DirectoryEntry);
+
+	for(const DirectoryEntry& entry : GetBlocks())
+	{
+		CheckRange(entry.Offset, entry.Size, "block");
+	}
+}
+
 
-	CgfbReader::Read(&m_BlockData);
-	m_BlockDataOffset = GetPosition();
+const DirectoryEntry* CgfbFileReader::FindBlock(std::string_view blockName) const
+{
+	const uint64_t hash = HashName(blockName);
+	const DirectoryEntry* end = m_Entries + m_EntryCount;
+
+	const DirectoryEntry* entry = std::lower_bound(m_Entries, end, hash, [](const DirectoryEntry& entry, uint64_t hash)
+	{
+		return entry.NameHash < hash;
+	});
+
+	for(; entry != end && entry->NameHash == hash; entry++)
+	{
+		if(GetBlockName(*entry) == blockName)
+		{
+			return entry;
+		}
+	}
+
+	return nullptr;
 }
 
 
-void CgfbFileReader::ReadFromStream(char *data, int count)
+void CgfbFileReader::ReadFromStream(char *data, size_t count)
 {
+	if(m_Mode == CgfbReadMode::Mapped)
+	{
+		CheckRange(m_MappedPosition, count, "read");
+
+		std::memcpy(data, m_Mapping.GetData() + m_MappedPosition, count);
+		m_MappedPosition += count;
+
+		return;
+	}
+
 	m_File.read(data, count);
+
+	if((size_t)m_File.gcount() != count)
+	{
+		throw std::runtime_error("CGFB file is truncated: a read of " + std::to_string(count) + " bytes ran past the end of the file");
+	}
 }
 
 
-void CgfbFileReader::SeekStreamPosition(int position, std::ios_base::seekdir way)
+void CgfbFileReader::SeekStreamPosition(int64_t position, std::ios_base::seekdir way)
 {
+	if(m_Mode == CgfbReadMode::Mapped)
+	{
+		switch(way)
+		{
+		case std::ios_base::cur: m_MappedPosition += position; break;
+		case std::ios_base::end: m_MappedPosition = m_Mapping.GetSize() + position; break;
+		default: m_MappedPosition = position; break;
+		}
+
+		return;
+	}
+
 	m_File.seekg(position, way);
 }
 
 
-void CgfbFileReader::ReadBlock(std::string blockName, CgfbBlock& out)
+bool CgfbFileReader::ReadBlock(std::string_view blockName, CgfbBlock& out)
+{
+	const DirectoryEntry* entry = FindBlock(blockName);
+
+	if(!entry)
+	{
+		return false;
+	}
+
+	ReadBlock(*entry, out);
+	return true;
+}
+
+
+void CgfbFileReader::ReadBlock(const DirectoryEntry& entry, CgfbBlock& out)
+{
+	CgfbBlock stored;
+	ReadStoredBlock(entry, stored);
+
+	DecodeBlock(entry, std::move(stored), out);
+}
+
+
+void CgfbFileReader::ReadStoredBlock(const DirectoryEntry& entry, CgfbBlock& stored)
+{
+	stored = CgfbBlock();
+	stored.Kind = entry.Kind;
+	stored.FormatVersion = GetFormatVersion();
+
+	CheckRange(entry.Offset, entry.Size, "block");
+
+	if(m_Mode == CgfbReadMode::Mapped)
+	{
+		stored.Data = m_Mapping.GetData() + entry.Offset;
+		stored.Count = entry.Size;
+		stored.OwnsData = false;
+	}
+	else
+	{
+		char* data = new char[entry.Size];
+
+		{
+			std::lock_guard lock (m_FileMutex);
+
+			SeekStreamPosition(entry.Offset, std::ios_base::beg);
+			Read(data, entry.Size);
+		}
+
+		stored.Data = data;
+		stored.Count = entry.Size;
+		stored.OwnsData = true;
+	}
+}
+
+
+void CgfbFileReader::DecodeBlock(const DirectoryEntry& entry, CgfbBlock&& stored, CgfbBlock& out)
+{
+	stored.Kind = entry.Kind;
+	stored.FormatVersion = GetFormatVersion();
+
+	if(entry.Compression == CompressionCodec::None)
+	{
+		out = std::move(stored);
+		return;
+	}
+
+	std::unique_ptr<char[]> data (new char[entry.UncompressedSize]);
+
+	bool decompressed = DecompressBlock(std::span<const char>(stored.Data, stored.Count),
+		entry.Compression,
+		std::span<char>(data.get(), entry.UncompressedSize),
+		m_ThreadPool);
+
+	if(!decompressed)
+	{
+		throw std::runtime_error("Failed to decompress CGFB block " + std::string(GetBlockName(entry)) + ", which is corrupt");
+	}
+
+	out = CgfbBlock(data.release(), entry.UncompressedSize, true);
+	out.Kind = stored.Kind;
+	out.FormatVersion = stored.FormatVersion;
+}
+
+
+bool CgfbFileReader::ReadBlocks(std::span<const std::string_view> blockNames, std::vector<CgfbBlock>& out)
+{
+	// Blocks are read in file order, so each coalesced range is a single sequential read
+	std::vector<std::pair<const DirectoryEntry*, size_t>> found;
+	found.reserve(blockNames.size());
+
+	for(size_t i = 0; i < blockNames.size(); i++)
+	{
+		if(const DirectoryEntry* entry = FindBlock(blockNames[i]))
+		{
+			found.emplace_back(entry, i);
+		}
+	}
+
+	std::sort(found.begin(), found.end(), [](const auto& a, const auto& b)
+	{
+		return a.first->Offset < b.first->Offset;
+	});
+
+	std::vector<const DirectoryEntry*> entries (found.size());
+
+	for(size_t i = 0; i < found.size(); i++)
+	{
+		entries[i] = found[i].first;
+	}
+
+	out.clear();
+	out.resize(blockNames.size());
+
+	std::vector<CgfbBlock> stored (entries.size());
+
+	if(m_Mode == CgfbReadMode::Mapped)
+	{
+		Prefetch(entries);
+
+		for(size_t i = 0; i < entries.size(); i++)
+		{
+			stored[i] = CgfbBlock(m_Mapping.GetData() + entries[i]->Offset, entries[i]->Size, false);
+		}
+	}
+	else
+	{
+		std::lock_guard lock (m_FileMutex);
+
+		for(const BlockRange& range : CoalesceBlocks(entries))
+		{
+			SeekStreamPosition(range.Offset, std::ios_base::beg);
+			uint64_t position = range.Offset;
+
+			for(size_t i = range.FirstBlock; i < range.FirstBlock + range.BlockCount; i++)
+			{
+				// The same block may be requested more than once
+				if(entries[i]->Offset < position)
+				{
+					SeekStreamPosition(entries[i]->Offset, std::ios_base::beg);
+				}
+				else
+				{
+					m_File.ignore(entries[i]->Offset - position);
+				}
+
+				char* data = new char[entries[i]->Size];
+				Read(data, entries[i]->Size);
+
+				stored[i] = CgfbBlock(data, entries[i]->Size, true);
+				position = entries[i]->Offset + entries[i]->Size;
+			}
+		}
+	}
+
+	// Exceptions can't leave a pool's tasks, so the first failure is rethrown once every block is done
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto decode = [&](size_t i)
+	{
+		try
+		{
+			DecodeBlock(*entries[i], std::move(stored[i]), out[found[i].second]);
+		}
+		catch(...)
+		{
+			std::lock_guard lock (errorMutex);
+
+			if(!error)
+			{
+				error = std::current_exception();
+			}
+		}
+	};
+
+	if(m_ThreadPool)
+	{
+		m_ThreadPool->ParallelFor(entries.size(), decode);
+	}
+	else
+	{
+		for(size_t i = 0; i < entries.size(); i++)
+		{
+			decode(i);
+		}
+	}
+
+	if(error)
+	{
+		out.clear();
+		std::rethrow_exception(error);
+	}
+
+	return found.size() == blockNames.size();
+}
+
+
+void CgfbFileReader::Prefetch(std::span<const DirectoryEntry* const> entries)
 {
-	BlockInfo& info = m_BlockData[blockName];
+	if(m_Mode != CgfbReadMode::Mapped)
+	{
+		return;
+	}
+
+	std::vector<const DirectoryEntry*> sorted (entries.begin(), entries.end());
+
+	std::sort(sorted.begin(), sorted.end(), [](const DirectoryEntry* a, const DirectoryEntry* b)
+	{
+		return a->Offset < b->Offset;
+	});
+
+	for(const BlockRange& range : CoalesceBlocks(sorted))
+	{
+		m_Mapping.Prefetch(range.Offset, range.Size);
+	}
+}
+
+
+std::vector<BlockRange> cgfb::CoalesceBlocks(std::span<const DirectoryEntry* const> entries, uint64_t maxGap)
+{
+	std::vector<BlockRange> ranges;
+
+	for(size_t i = 0; i < entries.size(); i++)
+	{
+		const uint64_t end = entries[i]->Offset + entries[i]->Size;
+
+		if(!ranges.empty() && entries[i]->Offset <= ranges.back().Offset + ranges.back().Size + maxGap)
+		{
+			BlockRange& range = ranges.back();
+			range.Size = std::max(range.Size, end - range.Offset);
+			range.BlockCount++;
+
+			continue;
+		}
 
-	SeekStreamPosition(m_BlockDataOffset + info.StartIndex, std::ios_base::beg);
+		BlockRange range;
+		range.Offset = entries[i]->Offset;
+		range.Size = entries[i]->Size;
+		range.FirstBlock = i;
+		range.BlockCount = 1;
 
-	LOG("Block data offset, Start index, Their sum, Block size");
-	LOG(m_BlockDataOffset);
-	LOG(info.StartIndex);
-	LOG(m_BlockDataOffset + info.StartIndex);
-	LOG(info.Size);
-	
-	out.Data = new char[info.Size];
-	out.Count = info.Size;
-	Read(out.Data, out.Count);
+		ranges.push_back(range);
+	}
+
+	return ranges;
 }
 
 
-void CgfbMemoryWriter::WriteToStream(char *data, int count)
+void cgfb::WriteDirectory(CgfbWriter& out, std::vector<BlockInfo> blocks)
+{
+	assert(out.GetFormatVersion() >= 2);
+
+	std::sort(blocks.begin(), blocks.end(), [](const BlockInfo& a, const BlockInfo& b)
+	{
+		uint64_t aHash = HashName(a.Name);
+		uint64_t bHash = HashName(b.Name);
+
+		return aHash != bHash ? aHash < bHash : a.Name < b.Name;
+	});
+
+	uint32_t nameOffset = 0;
+
+	for(size_t i = 0; i < blocks.size(); i++)
+	{
+		assert(i == 0 || blocks[i].Name != blocks[i - 1].Name);
+
+		DirectoryEntry entry;
+		entry.NameHash = HashName(blocks[i].Name);
+		entry.Offset = blocks[i].Offset;
+		entry.Size = blocks[i].Size;
+		entry.UncompressedSize = blocks[i].UncompressedSize ? blocks[i].UncompressedSize : blocks[i].Size;
+		entry.NameOffset = nameOffset;
+		entry.NameLength = blocks[i].Name.size();
+		entry.Alignment = blocks[i].Alignment;
+		entry.Kind = blocks[i].Kind;
+		entry.Compression = blocks[i].Compression;
+		entry.Reserved = 0;
+
+		out.Write(entry);
+		nameOffset += entry.NameLength;
+	}
+
+	for(const BlockInfo& block : blocks)
+	{
+		out.Write(block.Name.data(), block.Name.size());
+	}
+}
+
+
+void CgfbMemoryWriter::WriteToStream(const char *data, size_t count)
 {
 	m_Buffer.insert(m_Buffer.end(), data, data + count);
 }
 
 
-CgfbMemoryReader::CgfbMemoryReader(char* buffer, int bufferSize)
+CgfbMemoryReader::CgfbMemoryReader(const char* buffer, size_t bufferSize, uint32_t formatVersion)
+	: m_Buffer(buffer), m_OwnsBuffer(false)
 {
-	m_Buffer = new char[bufferSize];
+	SetFormatVersion(formatVersion);
 }
 
 
 CgfbMemoryReader::CgfbMemoryReader(CgfbBlock &&block)
-	: m_Buffer(block.Data)
+	: m_Buffer(block.Data), m_OwnsBuffer(block.OwnsData)
 {
+	SetFormatVersion(block.FormatVersion);
+
 	block.Data = nullptr;
 	block.Count = 0;
 }
@@ -91,11 +695,14 @@ CgfbMemoryReader::CgfbMemoryReader(CgfbBlock &&block)
 
 CgfbMemoryReader::~CgfbMemoryReader()
 {
-	delete m_Buffer;
+	if(m_OwnsBuffer)
+	{
+		delete[] m_Buffer;
+	}
 }
 
 
-void CgfbMemoryReader::ReadFromStream(char *data, int count)
+void CgfbMemoryReader::ReadFromStream(char *data, size_t count)
 {
 	std::memcpy(data, m_Buffer + m_Position, count);
 
@@ -103,14 +710,46 @@ void CgfbMemoryReader::ReadFromStream(char *data, int count)
 }
 
 
-cgfb::CgfbBlock::CgfbBlock(char *data, size_t count)
-	: Data(data), Count(count)
+cgfb::CgfbBlock::CgfbBlock(const char *data, size_t count, bool ownsData)
+	: Data(data), Count(count), OwnsData(ownsData)
 {
 
 }
 
 
+cgfb::CgfbBlock::CgfbBlock(CgfbBlock&& other)
+{
+	*this = std::move(other);
+}
+
+
 cgfb::CgfbBlock::~CgfbBlock()
 {
-	delete[] Data;
+	if(OwnsData)
+	{
+		delete[] Data;
+	}
+}
+
+
+CgfbBlock& cgfb::CgfbBlock::operator=(CgfbBlock&& other)
+{
+	if(this != &other)
+	{
+		if(OwnsData)
+		{
+			delete[] Data;
+		}
+
+		Data = other.Data;
+		Count = other.Count;
+		OwnsData = other.OwnsData;
+		Kind = other.Kind;
+		FormatVersion = other.FormatVersion;
+
+		other.Data = nullptr;
+		other.Count = 0;
+	}
+
+	return *this;
 }
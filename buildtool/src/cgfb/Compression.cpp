@@ -0,0 +1,273 @@
+#include "cgfb/Compression.h"
+#include "cgfb/ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <atomic>
+
+#include "lz4.h"
+#include "lz4hc.h"
+#include "zstd.h"
+
+
+using namespace cgfb;
+
+
+/**
+ * Compressed blocks begin with a table of their chunks:
+ *
+ *   uint32_t ChunkSize
+ *   uint32_t ChunkCount
+ *   uint64_t ChunkEnds[ChunkCount]    end of each chunk's compressed bytes, relative to the first chunk
+ *
+ * Chunks which don't shrink are stored uncompressed, which is detectable as their stored size then
+ * equals their uncompressed size.
+ */
+namespace
+{
+
+struct ChunkTable
+{
+	uint32_t ChunkSize;
+	uint32_t ChunkCount;
+	const char* ChunkEnds;
+	const char* Chunks;
+
+	/**
+	 * Blocks may be aligned to less than 8 bytes, so the table is read without assuming alignment
+	 */
+	uint64_t GetChunkEnd(size_t index) const
+	{
+		uint64_t end;
+		std::memcpy(&end, ChunkEnds + index * sizeof(uint64_t), sizeof(end));
+
+		return end;
+	}
+};
+
+
+size_t GetTableSize(uint32_t chunkCount)
+{
+	return sizeof(uint32_t) * 2 + sizeof(uint64_t) * chunkCount;
+}
+
+
+bool ReadChunkTable(std::span<const char> compressed, ChunkTable* out)
+{
+	if(compressed.size() < GetTableSize(0))
+	{
+		return false;
+	}
+
+	std::memcpy(&out->ChunkSize, compressed.data(), sizeof(uint32_t));
+	std::memcpy(&out->ChunkCount, compressed.data() + sizeof(uint32_t), sizeof(uint32_t));
+
+	if(compressed.size() < GetTableSize(out->ChunkCount))
+	{
+		return false;
+	}
+
+	out->ChunkEnds = compressed.data() + GetTableSize(0);
+	out->Chunks = compressed.data() + GetTableSize(out->ChunkCount);
+
+	return true;
+}
+
+
+size_t CompressChunk(const char* src, size_t srcSize, char* dst, size_t dstCapacity, const CompressionSettings& settings)
+{
+	switch(settings.Codec)
+	{
+	case CompressionCodec::LZ4:
+	{
+		int written = settings.Level > 0
+			? LZ4_compress_HC(src, dst, srcSize, dstCapacity, settings.Level)
+			: LZ4_compress_default(src, dst, srcSize, dstCapacity);
+
+		return written > 0 ? written : 0;
+	}
+
+	case CompressionCodec::Zstd:
+	{
+		size_t written = ZSTD_compress(dst, dstCapacity, src, srcSize, settings.Level > 0 ? settings.Level : ZSTD_CLEVEL_DEFAULT);
+
+		return ZSTD_isError(written) ? 0 : written;
+	}
+
+	default:
+		return 0;
+	}
+}
+
+
+size_t GetCompressBound(size_t srcSize, CompressionCodec codec)
+{
+	switch(codec)
+	{
+	case CompressionCodec::LZ4: return LZ4_compressBound(srcSize);
+	case CompressionCodec::Zstd: return ZSTD_compressBound(srcSize);
+	default: return srcSize;
+	}
+}
+
+
+bool DecompressChunk(const char* src, size_t srcSize, char* dst, size_t dstSize, CompressionCodec codec)
+{
+	if(srcSize == dstSize)
+	{
+		std::memcpy(dst, src, dstSize);
+		return true;
+	}
+
+	switch(codec)
+	{
+	case CompressionCodec::LZ4:
+		return LZ4_decompress_safe(src, dst, srcSize, dstSize) == (int)dstSize;
+
+	case CompressionCodec::Zstd:
+	{
+		// Decompression contexts are comparatively expensive to create, so each thread keeps one
+		thread_local std::unique_ptr<ZSTD_DCtx, size_t(*)(ZSTD_DCtx*)> context (ZSTD_createDCtx(), &ZSTD_freeDCtx);
+
+		return ZSTD_decompressDCtx(context.get(), dst, dstSize, src, srcSize) == dstSize;
+	}
+
+	default:
+		return false;
+	}
+}
+
+}
+
+
+bool cgfb::ParseCompressionCodec(std::string_view name, CompressionCodec* out)
+{
+	for(CompressionCodec codec : { CompressionCodec::None, CompressionCodec::LZ4, CompressionCodec::Zstd })
+	{
+		if(name == GetCompressionCodecName(codec))
+		{
+			*out = codec;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+const char* cgfb::GetCompressionCodecName(CompressionCodec codec)
+{
+	switch(codec)
+	{
+	case CompressionCodec::None: return "None";
+	case CompressionCodec::LZ4: return "LZ4";
+	case CompressionCodec::Zstd: return "Zstd";
+	default: return "?";
+	}
+}
+
+
+std::vector<char> cgfb::CompressBlock(std::span<const char> data, const CompressionSettings& settings, ThreadPool* pool)
+{
+	const uint32_t chunkCount = (data.size() + COMPRESSION_CHUNK_SIZE - 1) / COMPRESSION_CHUNK_SIZE;
+	const size_t chunkBound = GetCompressBound(COMPRESSION_CHUNK_SIZE, settings.Codec);
+
+	std::vector<std::vector<char>> chunks (chunkCount);
+
+	auto compressChunk = [&](size_t i)
+	{
+		const char* src = data.data() + i * COMPRESSION_CHUNK_SIZE;
+		const size_t srcSize = std::min<size_t>(COMPRESSION_CHUNK_SIZE, data.size() - i * COMPRESSION_CHUNK_SIZE);
+
+		chunks[i].resize(chunkBound);
+		size_t written = CompressChunk(src, srcSize, chunks[i].data(), chunks[i].size(), settings);
+
+		if(written == 0 || written >= srcSize)
+		{
+			chunks[i].assign(src, src + srcSize);
+			return;
+		}
+
+		chunks[i].resize(written);
+	};
+
+	if(pool)
+	{
+		pool->ParallelFor(chunkCount, compressChunk);
+	}
+	else
+	{
+		for(size_t i = 0; i < chunkCount; i++)
+		{
+			compressChunk(i);
+		}
+	}
+
+	std::vector<char> out (GetTableSize(chunkCount));
+	uint32_t chunkSize = COMPRESSION_CHUNK_SIZE;
+	std::memcpy(out.data(), &chunkSize, sizeof(chunkSize));
+	std::memcpy(out.data() + sizeof(uint32_t), &chunkCount, sizeof(chunkCount));
+
+	uint64_t chunkEnd = 0;
+
+	for(uint32_t i = 0; i < chunkCount; i++)
+	{
+		chunkEnd += chunks[i].size();
+		std::memcpy(out.data() + GetTableSize(i), &chunkEnd, sizeof(chunkEnd));
+	}
+
+	out.reserve(out.size() + chunkEnd);
+
+	for(const std::vector<char>& chunk : chunks)
+	{
+		out.insert(out.end(), chunk.begin(), chunk.end());
+	}
+
+	return out;
+}
+
+
+bool cgfb::DecompressBlock(std::span<const char> compressed, CompressionCodec codec, std::span<char> out, ThreadPool* pool)
+{
+	ChunkTable table;
+
+	if(!ReadChunkTable(compressed, &table) || table.ChunkSize == 0)
+	{
+		return false;
+	}
+
+	if((uint64_t)table.ChunkCount * table.ChunkSize < out.size()
+		|| (table.ChunkCount && GetTableSize(table.ChunkCount) + table.GetChunkEnd(table.ChunkCount - 1) > compressed.size()))
+	{
+		return false;
+	}
+
+	std::atomic<bool> succeeded = true;
+
+	auto decompressChunk = [&](size_t i)
+	{
+		const uint64_t start = i == 0 ? 0 : table.GetChunkEnd(i - 1);
+		const size_t dstOffset = i * table.ChunkSize;
+		const size_t dstSize = std::min<size_t>(table.ChunkSize, out.size() - dstOffset);
+
+		if(!DecompressChunk(table.Chunks + start, table.GetChunkEnd(i) - start, out.data() + dstOffset, dstSize, codec))
+		{
+			succeeded = false;
+		}
+	};
+
+	if(pool && table.ChunkCount > 1)
+	{
+		pool->ParallelFor(table.ChunkCount, decompressChunk);
+	}
+	else
+	{
+		for(size_t i = 0; i < table.ChunkCount; i++)
+		{
+			decompressChunk(i);
+		}
+	}
+
+	return succeeded;
+}
@@ -0,0 +1,177 @@
+#include "cgfb/MappedFile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+using namespace cgfb;
+
+
+MappedFile::MappedFile(const char* filePath)
+{
+	Open(filePath);
+}
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* filePath)
+{
+	Close();
+
+	HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+
+	if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if(!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if(!view)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_FileHandle = file;
+	m_MappingHandle = mapping;
+	m_Data = (const char*)view;
+	m_Size = size.QuadPart;
+
+	return true;
+}
+
+
+void MappedFile::Close()
+{
+	if(m_Data)
+	{
+		UnmapViewOfFile(m_Data);
+		CloseHandle(m_MappingHandle);
+		CloseHandle(m_FileHandle);
+	}
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_FileHandle = nullptr;
+	m_MappingHandle = nullptr;
+}
+
+
+void MappedFile::Prefetch(size_t offset, size_t size) const
+{
+	if(offset >= m_Size)
+	{
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (void*)(m_Data + offset);
+	range.NumberOfBytes = std::min(size, m_Size - offset);
+
+	// Only a hint, so failure is harmless
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+bool MappedFile::Open(const char* filePath)
+{
+	Close();
+
+	int file = open(filePath, O_RDONLY);
+
+	if(file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+
+	if(fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+
+	// The mapping keeps its own reference to the file
+	close(file);
+
+	if(view == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_Data = (const char*)view;
+	m_Size = info.st_size;
+
+	return true;
+}
+
+
+void MappedFile::Close()
+{
+	if(m_Data)
+	{
+		munmap((void*)m_Data, m_Size);
+	}
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+
+void MappedFile::Prefetch(size_t offset, size_t size) const
+{
+	if(offset >= m_Size)
+	{
+		return;
+	}
+
+	// madvise() only takes page aligned addresses
+	static const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+	const size_t start = offset / pageSize * pageSize;
+	const size_t end = std::min(offset + size, m_Size);
+
+	// Only a hint, so failure is harmless
+	madvise((void*)(m_Data + start), end - start, MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include "cgfb/ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+
+using namespace cgfb;
+
+
+namespace
+{
+
+// Identifies the worker running on this thread, if any, so its tasks can submit to its own queue
+thread_local const ThreadPool* t_CurrentPool = nullptr;
+thread_local size_t t_WorkerIndex = 0;
+
+}
+
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+	for(unsigned int i = 0; i <= workerCount; i++)
+	{
+		m_Queues.push_back(std::make_unique<TaskQueue>());
+	}
+
+	for(unsigned int i = 0; i < workerCount; i++)
+	{
+		m_Workers.emplace_back(&ThreadPool::RunWorker, this, i);
+	}
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock (m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_TaskAvailable.notify_all();
+
+	for(std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	const size_t index = t_CurrentPool == this ? t_WorkerIndex : m_Queues.size() - 1;
+
+	// Counted under the queue's lock, which the task has to be taken under, so it's never uncounted first
+	{
+		std::lock_guard lock (m_Queues[index]->Mutex);
+		m_Queues[index]->Tasks.push_back(std::move(task));
+		m_QueuedCount++;
+	}
+
+	// A worker counts itself as sleeping before it checks for tasks, so either it sees this task or it's
+	// counted here, in which case taking the lock waits until it's actually waiting to be notified
+	if(m_SleepingCount > 0)
+	{
+		{
+			std::lock_guard lock (m_Mutex);
+		}
+
+		m_TaskAvailable.notify_one();
+	}
+}
+
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	if(count == 0)
+	{
+		return;
+	}
+
+	struct Batch
+	{
+		std::atomic<size_t> NextIndex = 0;
+		std::atomic<size_t> Completed = 0;
+		std::mutex Mutex;
+		std::condition_variable Done;
+	};
+
+	// Helpers may only get to run after the batch is finished, so they share ownership of it
+	auto batch = std::make_shared<Batch>();
+	const size_t total = count;
+
+	auto work = [batch, total, &task]()
+	{
+		size_t index;
+
+		while((index = batch->NextIndex++) < total)
+		{
+			task(index);
+
+			if(++batch->Completed == total)
+			{
+				std::lock_guard lock (batch->Mutex);
+				batch->Done.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = std::min<size_t>(count - 1, m_Workers.size());
+
+	for(size_t i = 0; i < helpers; i++)
+	{
+		// task is only dereferenced while an index is claimed, which can't outlive this call
+		Submit(work);
+	}
+
+	// The caller always makes progress itself, so nested calls can't starve waiting on busy workers
+	work();
+
+	std::unique_lock lock (batch->Mutex);
+	batch->Done.wait(lock, [&]() { return batch->Completed == total; });
+}
+
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+
+void ThreadPool::RunWorker(size_t index)
+{
+	t_CurrentPool = this;
+	t_WorkerIndex = index;
+
+	std::function<void()> task;
+
+	while(true)
+	{
+		if(TryTakeTask(index, task))
+		{
+			task();
+			task = nullptr;
+
+			continue;
+		}
+
+		std::unique_lock lock (m_Mutex);
+
+		m_SleepingCount++;
+		m_TaskAvailable.wait(lock, [this]() { return m_Stopping || m_QueuedCount > 0; });
+		m_SleepingCount--;
+
+		if(m_Stopping && m_QueuedCount == 0)
+		{
+			return;
+		}
+	}
+}
+
+
+bool ThreadPool::TryTakeTask(size_t index, std::function<void()>& task)
+{
+	const size_t queueCount = m_Queues.size();
+
+	for(size_t i = 0; i < queueCount; i++)
+	{
+		TaskQueue& queue = *m_Queues[(index + i) % queueCount];
+		std::lock_guard lock (queue.Mutex);
+
+		if(queue.Tasks.empty())
+		{
+			continue;
+		}
+
+		if(i == 0)
+		{
+			task = std::move(queue.Tasks.back());
+			queue.Tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.Tasks.front());
+			queue.Tasks.pop_front();
+		}
+
+		m_QueuedCount--;
+		return true;
+	}
+
+	return false;
+}
@@ -7,6 +7,7 @@
 #include "core/Component.h"
 #include "core/AssetLibrary.h"
 #include "core/Common.h"
+#include "core/Jobs.h"
 
 #include "graphics/Texture.h"
 
@@ -70,15 +71,25 @@ public:
 		m_SpriteMaterial = Game->GetAssetLibrary()->Get<MaterialInstance>("Sprite");
 		SetMaterial(m_SpriteMaterial);
 
-		m_Atlas = Game->GetAssetLibrary()->Get<Texture2D>("Atlas");
+		// The atlas is streamed in, drawing with the placeholder texture until it's resident
+		m_Atlas = Game->GetAssetLibrary()->GetAsync<Texture2D>("Atlas");
+		BindAtlas(m_Atlas.Get());
+
+		m_AtlasReady = m_Atlas.OnReady([this](SharedPtr<Texture2D> atlas)
+		{
+			BindAtlas(atlas);
+		});
 	}
 
 	void TickComponent(double dT)
 	{
-		m_Vertices.clear();
-		m_Indices.clear();
+		const size_t spriteCount = m_SpriteStatePool.GetCount();
+
+		m_Vertices.resize(spriteCount * 4);
+		m_Indices.resize(spriteCount * 6);
 
-		for(int i = 0; i < m_SpriteStatePool.GetCount(); i++)
+		// Every sprite owns its own slice of the buffers, so sprites are written across every thread at once
+		Game->GetJobSystem()->ParallelFor(spriteCount, [this](size_t i)
 		{
 			SpriteState& spriteState = m_SpriteStatePool[i];
 
@@ -116,9 +127,9 @@ public:
 				},
 			};
 
-			m_Vertices.insert(m_Vertices.end(), std::begin(quadVertices), std::end(quadVertices));
-			m_Indices.insert(m_Indices.end(), std::begin(quadIndices), std::end(quadIndices));
-		}
+			std::copy(std::begin(quadVertices), std::end(quadVertices), m_Vertices.begin() + i * 4);
+			std::copy(std::begin(quadIndices), std::end(quadIndices), m_Indices.begin() + i * 6);
+		}, 256, "SpriteBatch");
 
 		Upload();
 	}
@@ -129,6 +140,11 @@ public:
 	}
 
 private:
+	void BindAtlas(SharedPtr<Texture2D> atlas)
+	{
+		m_SpriteMaterial->GetFragmentShaderVariable("g_Texture")->Set(atlas->GetHandle()->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+	}
+
 	void Upload()
 	{
 		SetVertexData(m_Vertices.data(), sizeof(Vertex), m_Vertices.size());
@@ -139,5 +155,6 @@ private:
 	std::vector<unsigned int> m_Indices;
 	Pool<SpriteState> m_SpriteStatePool;
 	SharedPtr<MaterialInstance> m_SpriteMaterial;
-	SharedPtr<Texture2D> m_Atlas;
+	AsyncAsset<Texture2D> m_Atlas;
+	Event<SharedPtr<Texture2D>>::Connection m_AtlasReady;
 };
\ No newline at end of file
@@ -4,15 +4,19 @@
 
 #include "core/Events.h"
 #include "core/Memory.h"
+#include "core/ECS.h"
 
 
 class Scene;
+class ActorComponent;
 
 
 class Actor
 {
 public:
 	Actor();
+
+	virtual ~Actor();
 	
 	virtual void Start();
 
@@ -27,18 +31,21 @@ public:
 		component->AttachTo(this);
 	}
 
+	/**
+	 * @brief Keeps a component alive for as long as the actor is, without attaching it
+	 */
 	template<typename ComponentT>
 	void RegisterComponent(SharedPtr<ComponentT> component)
 	{
-		GetComponentRegistry<ComponentT>().push_back(component);
+		m_Components.push_back(component);
 	}
-	
-	template<typename ComponentT>
-	std::vector<SharedPtr<ComponentT>>& GetComponentRegistry()
-	{
-		static std::vector<SharedPtr<ComponentT>> components;
 
-		return components;
+	/**
+	 * @return Every component added to this actor
+	 */
+	FORCEINLINE const std::vector<SharedPtr<ActorComponent>>& GetComponents() const
+	{
+		return m_Components;
 	}
 
 	FORCEINLINE Scene* GetScene() const
@@ -46,6 +53,15 @@ public:
 		return m_Scene;
 	}
 
+	/**
+	 * @brief The entity representing this actor in its scene's registry, which data components can be added
+	 * to; null while the actor isn't in a scene
+	 */
+	FORCEINLINE Entity GetEntity() const
+	{
+		return m_Entity;
+	}
+
 	OnStartEvent OnComponentStart;
 	OnTickEvent OnComponentTick;
 	Event<Scene*> OnSceneChanged;
@@ -53,7 +69,8 @@ public:
 private:
 	bool m_ShouldTick = true;
 	Scene* m_Scene = nullptr;
-	std::vector<bool> m_ComponentBitset;
+	Entity m_Entity;
+	std::vector<SharedPtr<ActorComponent>> m_Components;
 	OnTickEvent::Connection m_TickListener;
 	OnStartEvent::Connection m_StartListener;
 };
\ No newline at end of file
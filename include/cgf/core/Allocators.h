@@ -0,0 +1,418 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/Common.h"
+
+
+/**
+ * @brief Whether global heap allocations are attributed to the MemoryTag active on their thread, which
+ * costs a header in front of each allocation and a few atomic operations per new and delete. On in debug
+ * builds unless defined otherwise, which must be done for every translation unit alike. Compiled out,
+ * tag scopes are empty, and unless allocations are still counted, the global operator new is the
+ * standard library's own.
+ */
+#ifndef ENABLE_MEMORY_TRACKING
+#ifdef _DEBUG
+#define ENABLE_MEMORY_TRACKING true
+#else
+#define ENABLE_MEMORY_TRACKING false
+#endif
+#endif
+
+
+/**
+ * @brief Whether calls to the global operator new are counted, see GetHeapAllocationCount(). Counting
+ * replaces the global operator new, and every allocation then updates one shared counter, so it follows
+ * ENABLE_MEMORY_TRACKING unless defined otherwise.
+ */
+#ifndef ENABLE_HEAP_ALLOCATION_COUNTING
+#define ENABLE_HEAP_ALLOCATION_COUNTING ENABLE_MEMORY_TRACKING
+#endif
+
+
+/**
+ * @return The number of calls to the global operator new so far, on every thread; 0 unless either
+ * ENABLE_HEAP_ALLOCATION_COUNTING or ENABLE_MEMORY_TRACKING is truthy. Allocations of over-aligned
+ * types aren't counted.
+ */
+uint64_t GetHeapAllocationCount();
+
+
+/**
+ * @brief The subsystem heap allocations are charged to, see MemoryTagScope
+ */
+enum class MemoryTag : uint8_t
+{
+	Untagged,
+	Assets,
+	Render,
+	Scene,
+	Events,
+	Count
+};
+
+
+/**
+ * @brief The heap memory charged to a tag, as tracked while ENABLE_MEMORY_TRACKING is truthy
+ */
+struct MemoryTagStats
+{
+	uint64_t LiveBytes = 0;
+
+	/**
+	 * @brief The most bytes the tag has had live at once
+	 */
+	uint64_t PeakBytes = 0;
+
+	uint64_t LiveAllocations = 0;
+	uint64_t TotalAllocations = 0;
+};
+
+
+const char* GetMemoryTagName(MemoryTag tag);
+
+
+/**
+ * @return The memory charged to a tag so far; all zeroes unless ENABLE_MEMORY_TRACKING is truthy
+ */
+MemoryTagStats GetMemoryTagStats(MemoryTag tag);
+
+
+/**
+ * @return The tag the calling thread's allocations are charged to
+ */
+#if ENABLE_MEMORY_TRACKING
+MemoryTag GetMemoryTag();
+#else
+FORCEINLINE MemoryTag GetMemoryTag()
+{
+	return MemoryTag::Untagged;
+}
+#endif
+
+
+/**
+ * @brief Prints the memory each tag still holds, e.g. once a game has shut down, when every tagged
+ * allocation should have been freed
+ * @return Whether any tag other than Untagged still holds memory, which the static data and thread
+ * scratch arenas charged to Untagged are expected to
+ */
+bool ReportMemoryLeaks();
+
+
+/**
+ * @brief Charges the heap allocations the calling thread makes during its lifetime to a tag, e.g. at
+ * the entry points of a subsystem. Scopes nest, the innermost deciding the tag, and memory stays
+ * charged to the tag it was allocated under wherever it's freed.
+ */
+class MemoryTagScope
+{
+public:
+#if ENABLE_MEMORY_TRACKING
+	explicit MemoryTagScope(MemoryTag tag);
+
+	~MemoryTagScope();
+#else
+	explicit MemoryTagScope(MemoryTag tag)
+	{
+
+	}
+#endif
+
+	MemoryTagScope(const MemoryTagScope& other) = delete;
+
+	MemoryTagScope& operator=(const MemoryTagScope& other) = delete;
+
+#if ENABLE_MEMORY_TRACKING
+private:
+	MemoryTag m_Previous;
+#endif
+};
+
+
+/**
+ * @brief Hands out memory by bumping an offset through blocks it owns, and frees everything it handed out
+ * at once, by rewinding the offset. Nothing is freed individually, so allocating is a few instructions and
+ * freeing costs nothing, but destructors aren't run: only trivially destructible data, or containers using
+ * an ArenaAllocator, belong in one.
+ *
+ * Blocks are only made once the ones the allocator has are full, so a workload repeated every frame stops
+ * allocating once it has run once. An allocator may only be used by one thread at a time.
+ */
+class LinearAllocator
+{
+public:
+	/**
+	 * @brief Marks the point to rewind to in order to free everything allocated since
+	 */
+	struct Marker
+	{
+		size_t Block = 0;
+		size_t Offset = 0;
+	};
+
+	/**
+	 * @param blockSize The size of the first block, made once it's first needed; later blocks are made
+	 * at least double the size of the last
+	 */
+	explicit LinearAllocator(size_t blockSize = 64 * 1024);
+
+	LinearAllocator(const LinearAllocator& other) = delete;
+
+	LinearAllocator& operator=(const LinearAllocator& other) = delete;
+
+	FORCEINLINE void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		if(m_Current < m_Blocks.size())
+		{
+			Block& block = m_Blocks[m_Current];
+
+			const uintptr_t base = reinterpret_cast<uintptr_t>(block.Memory.get());
+			const uintptr_t address = (base + m_Offset + alignment - 1) & ~uintptr_t(alignment - 1);
+
+			if(address + size <= base + block.Size)
+			{
+				m_Offset = address + size - base;
+
+				return reinterpret_cast<void*>(address);
+			}
+		}
+
+		return AllocateFromNextBlock(size, alignment);
+	}
+
+	/**
+	 * @brief Allocates uninitialized memory for count objects of type T
+	 */
+	template<typename T>
+	FORCEINLINE T* Allocate(size_t count = 1)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	FORCEINLINE Marker GetMarker() const
+	{
+		return { m_Current, m_Offset };
+	}
+
+	/**
+	 * @brief Frees everything allocated since marker was taken
+	 */
+	FORCEINLINE void Rewind(Marker marker)
+	{
+		m_Current = marker.Block;
+		m_Offset = marker.Offset;
+	}
+
+	/**
+	 * @brief Frees everything allocated. If more than one block was needed, they're replaced by a single
+	 * block as large as all of them, so later allocations are contiguous.
+	 */
+	void Reset();
+
+	/**
+	 * @return The bytes handed out since the last reset, including padding and the unused ends of full blocks
+	 */
+	size_t GetUsed() const;
+
+	/**
+	 * @return The bytes of every block the allocator owns
+	 */
+	size_t GetCapacity() const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<std::byte[]> Memory;
+		size_t Size = 0;
+	};
+
+	void* AllocateFromNextBlock(size_t size, size_t alignment);
+
+	std::vector<Block> m_Blocks;
+	size_t m_Current = 0;
+	size_t m_Offset = 0;
+	size_t m_BlockSize;
+};
+
+
+/**
+ * @brief Memory for data which lives no longer than a frame, such as lists built while ticking or
+ * drawing. Two linear allocators take turns: BeginFrame() switches to the other and resets it, so
+ * anything allocated during a frame stays valid until the end of the next, e.g. for work the renderer
+ * only gets to a frame later.
+ *
+ * Owned by GameBase, which begins each frame as it ticks; only used on the game thread. Jobs wanting
+ * temporary memory of their own use a ScratchScope instead.
+ */
+class FrameAllocator
+{
+public:
+	explicit FrameAllocator(size_t blockSize = 1024 * 1024);
+
+	FrameAllocator(const FrameAllocator& other) = delete;
+
+	FrameAllocator& operator=(const FrameAllocator& other) = delete;
+
+	/**
+	 * @brief Starts a frame, freeing everything allocated during the one before last
+	 */
+	void BeginFrame();
+
+	FORCEINLINE void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		return GetCurrent().Allocate(size, alignment);
+	}
+
+	template<typename T>
+	FORCEINLINE T* Allocate(size_t count = 1)
+	{
+		return GetCurrent().Allocate<T>(count);
+	}
+
+	/**
+	 * @return The allocator for the current frame, e.g. to make an ArenaAllocator from
+	 */
+	FORCEINLINE LinearAllocator& GetCurrent()
+	{
+		return m_Allocators[m_FrameIndex % 2];
+	}
+
+	FORCEINLINE uint64_t GetFrameIndex() const
+	{
+		return m_FrameIndex;
+	}
+
+	/**
+	 * @return The number of heap allocations made during the last frame, on every thread, as counted by
+	 * GetHeapAllocationCount(); a game in a steady state should make none
+	 */
+	FORCEINLINE uint64_t GetHeapAllocationsLastFrame() const
+	{
+		return m_HeapAllocationsLastFrame;
+	}
+
+	/**
+	 * @return The number of heap allocations charged to a tag during the last frame; 0 unless
+	 * ENABLE_MEMORY_TRACKING is truthy
+	 */
+	FORCEINLINE uint64_t GetHeapAllocationsLastFrame(MemoryTag tag) const
+	{
+		return m_TagAllocationsLastFrame[(size_t)tag];
+	}
+
+private:
+	LinearAllocator m_Allocators[2];
+	uint64_t m_FrameIndex = 0;
+	uint64_t m_HeapAllocationsAtFrameStart = 0;
+	uint64_t m_HeapAllocationsLastFrame = 0;
+	uint64_t m_TagAllocationsAtFrameStart[(size_t)MemoryTag::Count] = {};
+	uint64_t m_TagAllocationsLastFrame[(size_t)MemoryTag::Count] = {};
+};
+
+
+/**
+ * @return The calling thread's scratch arena. Use it through a ScratchScope, which frees whatever is
+ * allocated within it.
+ */
+LinearAllocator& GetThreadScratch();
+
+
+/**
+ * @brief Frees everything allocated from the calling thread's scratch arena during its lifetime, by
+ * rewinding the arena as it's destroyed. Scopes nest as long as they end in the reverse order they
+ * began, which holds for jobs a thread runs while it waits on others.
+ *
+ * Memory from a scope may be shared with jobs the scope's thread waits on, but mustn't be used once
+ * the scope has ended.
+ */
+class ScratchScope
+{
+public:
+	ScratchScope()
+		: m_Arena(GetThreadScratch()), m_Marker(m_Arena.GetMarker())
+	{
+
+	}
+
+	ScratchScope(const ScratchScope& other) = delete;
+
+	~ScratchScope()
+	{
+		m_Arena.Rewind(m_Marker);
+	}
+
+	ScratchScope& operator=(const ScratchScope& other) = delete;
+
+	FORCEINLINE LinearAllocator& GetArena()
+	{
+		return m_Arena;
+	}
+
+private:
+	LinearAllocator& m_Arena;
+	LinearAllocator::Marker m_Marker;
+};
+
+
+/**
+ * @brief Lets standard containers allocate from a LinearAllocator. Memory is only reclaimed as the arena
+ * is reset or rewound, so containers which grow a lot leave their earlier storage behind until then.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	ArenaAllocator(LinearAllocator& arena)
+		: m_Arena(&arena)
+	{
+
+	}
+
+	ArenaAllocator(ScratchScope& scope)
+		: m_Arena(&scope.GetArena())
+	{
+
+	}
+
+	template<typename OtherT>
+	ArenaAllocator(const ArenaAllocator<OtherT>& other)
+		: m_Arena(other.GetArena())
+	{
+
+	}
+
+	FORCEINLINE T* allocate(size_t count)
+	{
+		return m_Arena->Allocate<T>(count);
+	}
+
+	FORCEINLINE void deallocate(T* memory, size_t count)
+	{
+
+	}
+
+	FORCEINLINE LinearAllocator* GetArena() const
+	{
+		return m_Arena;
+	}
+
+	template<typename OtherT>
+	FORCEINLINE bool operator==(const ArenaAllocator<OtherT>& other) const
+	{
+		return m_Arena == other.GetArena();
+	}
+
+private:
+	LinearAllocator* m_Arena;
+};
+
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
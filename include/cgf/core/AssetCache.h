@@ -0,0 +1,289 @@
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <typeinfo>
+#include <type_traits>
+
+#include "core/Common.h"
+#include "core/Memory.h"
+
+#include "cgfb/Hash.h"
+
+
+/**
+ * @brief Identifies an asset by a hash of its type and name
+ */
+typedef uint64_t AssetId;
+
+
+template<typename AssetT>
+AssetId MakeAssetId(std::string_view assetName)
+{
+	return cgfb::HashBytes(assetName.data(), assetName.size(), cgfb::HashName(typeid(AssetT).name()));
+}
+
+
+/**
+ * @brief The memory an asset occupies, in bytes
+ */
+struct AssetMemoryUsage
+{
+	uint64_t CpuBytes = 0;
+	uint64_t GpuBytes = 0;
+};
+
+
+template <typename T, typename = void>
+struct reports_cpu_memory_size
+{
+    enum { value = 0 };
+};
+
+
+template <typename T>
+struct reports_cpu_memory_size<T, std::void_t<decltype(std::declval<const T&>().GetCpuMemorySize())>>
+{
+    enum { value = 1 };
+};
+
+
+template <typename T, typename = void>
+struct reports_gpu_memory_size
+{
+    enum { value = 0 };
+};
+
+
+template <typename T>
+struct reports_gpu_memory_size<T, std::void_t<decltype(std::declval<const T&>().GetGpuMemorySize())>>
+{
+    enum { value = 1 };
+};
+
+
+/**
+ * @return The memory an asset reports occupying through GetCpuMemorySize() and GetGpuMemorySize(); assets
+ * which don't report their CPU memory are assumed to occupy only their own size
+ */
+template<typename AssetT>
+AssetMemoryUsage GetAssetMemoryUsage(const AssetT& asset)
+{
+	AssetMemoryUsage usage;
+
+	if constexpr(reports_cpu_memory_size<AssetT>::value)
+		usage.CpuBytes = asset.GetCpuMemorySize();
+	else
+		usage.CpuBytes = sizeof(AssetT);
+
+	if constexpr(reports_gpu_memory_size<AssetT>::value)
+		usage.GpuBytes = asset.GetGpuMemorySize();
+
+	return usage;
+}
+
+
+/**
+ * @brief Caches loaded assets of any type by AssetId, tracking the memory they occupy. Once the cache
+ * is over its CPU or GPU budget, it stops keeping the least recently used assets alive until it's back
+ * under budget, starting with those referenced only by the cache, which are destroyed.
+ *
+ * Assets still in use elsewhere when they're evicted stay weakly cached: lookups keep finding them, so
+ * they're never loaded twice, but they're freed as soon as their last user releases them.
+ *
+ * Lookups only take a shared lock and may be made from any thread. Inserting and trimming evict assets,
+ * releasing their GPU resources, so must be done on the render thread.
+ */
+class AssetCache
+{
+public:
+	AssetCache() = default;
+
+	AssetCache(const AssetCache& other) = delete;
+
+	AssetCache& operator=(const AssetCache& other) = delete;
+
+	/**
+	 * @brief Looks up an asset, marking it as recently used
+	 * @return The asset, or nullptr if it isn't cached or has since been destroyed
+	 */
+	template<typename AssetT>
+	SharedPtr<AssetT> Find(AssetId id)
+	{
+		std::shared_lock lock (m_Mutex);
+
+		auto entry = m_Entries.find(id);
+
+		if(entry == m_Entries.end())
+		{
+			return nullptr;
+		}
+
+		CGF_ASSERT(entry->second.Asset->Type == typeid(AssetT), "Asset IDs of different types collided");
+
+		SharedPtr<AssetT> asset = static_cast<CachedAsset<AssetT>*>(entry->second.Asset.get())->Asset.Lock();
+
+		if(asset)
+		{
+			entry->second.LastUsed.store(++m_Clock, std::memory_order_relaxed);
+		}
+
+		return asset;
+	}
+
+	/**
+	 * @brief Caches an asset, then trims the cache if it's over budget
+	 * @return The cached asset; if another was cached under the same ID first, that one
+	 */
+	template<typename AssetT>
+	SharedPtr<AssetT> Insert(AssetId id, SharedPtr<AssetT> asset)
+	{
+		if(!asset)
+		{
+			return asset;
+		}
+
+		{
+			std::unique_lock lock (m_Mutex);
+
+			auto [entry, inserted] = m_Entries.try_emplace(id);
+
+			if(!inserted)
+			{
+				// An entry whose asset has been destroyed is no longer retained, so its memory is already uncounted
+				if(SharedPtr<AssetT> cached = static_cast<CachedAsset<AssetT>*>(entry->second.Asset.get())->Asset.Lock())
+				{
+					return cached;
+				}
+			}
+
+			entry->second.Asset = std::make_unique<CachedAsset<AssetT>>(asset);
+			entry->second.Usage = GetAssetMemoryUsage(*asset);
+			entry->second.LastUsed.store(++m_Clock, std::memory_order_relaxed);
+
+			m_Usage.CpuBytes += entry->second.Usage.CpuBytes;
+			m_Usage.GpuBytes += entry->second.Usage.GpuBytes;
+		}
+
+		Trim();
+
+		return asset;
+	}
+
+	/**
+	 * @brief Evicts the least recently used assets until the cache is within its budget, unreferenced
+	 * ones first, and forgets weakly cached assets which have since been destroyed
+	 */
+	void Trim();
+
+	/**
+	 * @brief Sets the memory the cache may hold before evicting assets, then trims it
+	 */
+	void SetBudget(AssetMemoryUsage budget);
+
+	FORCEINLINE AssetMemoryUsage GetBudget() const
+	{
+		return m_Budget;
+	}
+
+	/**
+	 * @return The memory occupied by the assets the cache keeps alive, which excludes evicted assets
+	 * still in use elsewhere
+	 */
+	AssetMemoryUsage GetUsage() const;
+
+	/**
+	 * @return The number of assets cached, including weakly cached ones
+	 */
+	size_t GetCount() const;
+
+private:
+	struct CachedAssetBase
+	{
+		CachedAssetBase(const std::type_info& type)
+			: Type(type)
+		{
+
+		}
+
+		virtual ~CachedAssetBase() = default;
+
+		/**
+		 * @return The number of references to the asset, including the cache's own if it retains it
+		 */
+		virtual int GetRefCount() const = 0;
+
+		virtual bool IsRetained() const = 0;
+
+		/**
+		 * @return An entry referencing the asset weakly, to replace this one as it's evicted
+		 */
+		virtual std::unique_ptr<CachedAssetBase> MakeWeak() const = 0;
+
+		const std::type_info& Type;
+	};
+
+	template<typename AssetT>
+	struct CachedAsset : CachedAssetBase
+	{
+		CachedAsset(SharedPtr<AssetT> asset)
+			: CachedAssetBase(typeid(AssetT)), Asset(asset), Retained(std::move(asset))
+		{
+
+		}
+
+		CachedAsset(const WeakPtr<AssetT>& asset)
+			: CachedAssetBase(typeid(AssetT)), Asset(asset)
+		{
+
+		}
+
+		int GetRefCount() const override
+		{
+			return Asset.GetRefCount();
+		}
+
+		bool IsRetained() const override
+		{
+			return Retained.Valid();
+		}
+
+		std::unique_ptr<CachedAssetBase> MakeWeak() const override
+		{
+			return std::make_unique<CachedAsset>(Asset);
+		}
+
+		WeakPtr<AssetT> Asset;
+
+		/**
+		 * @brief Keeps the asset alive until it's evicted
+		 */
+		SharedPtr<AssetT> Retained;
+	};
+
+	struct Entry
+	{
+		std::unique_ptr<CachedAssetBase> Asset;
+		AssetMemoryUsage Usage;
+
+		/**
+		 * @brief The value of the cache's clock when the asset was last looked up
+		 */
+		std::atomic<uint64_t> LastUsed = 0;
+	};
+
+	FORCEINLINE bool IsOverBudget() const
+	{
+		return m_Usage.CpuBytes > m_Budget.CpuBytes || m_Usage.GpuBytes > m_Budget.GpuBytes;
+	}
+
+	mutable std::shared_mutex m_Mutex;
+	std::unordered_map<AssetId, Entry> m_Entries;
+	std::atomic<uint64_t> m_Clock = 0;
+	AssetMemoryUsage m_Usage;
+	AssetMemoryUsage m_Budget = { 256ull << 20, 512ull << 20 };
+};
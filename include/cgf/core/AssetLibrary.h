@@ -4,20 +4,101 @@
 #include <filesystem>
 #include <unordered_map>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <deque>
+#include <typeindex>
+#include <span>
 
 #include "core/Memory.h"
+#include "core/Events.h"
+#include "core/AssetCache.h"
+#include "core/Jobs.h"
+#include "core/Allocators.h"
 
 #include "graphics/Shader.h"
 #include "graphics/Material.h"
 #include "graphics/Mesh.h"
 
-#include "assimp/Importer.hpp" 
-#include "assimp/scene.h"
-#include "assimp/postprocess.h"
-
 #include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
 
 #include "cgfb/CGFB.h"
+#include "cgfb/MeshFormat.h"
+#include "cgfb/ManifestFormat.h"
+
+
+/**
+ * @brief The state shared by every handle to an asset requested with AssetLibrary::GetAsync()
+ */
+template<typename AssetT>
+struct AsyncAssetState
+{
+	bool Ready = false;
+	SharedPtr<AssetT> Asset;
+	Event<SharedPtr<AssetT>> OnReady;
+};
+
+
+/**
+ * @brief A handle to an asset which is streamed in asynchronously. Until the asset is resident, the
+ * handle provides its type's placeholder instead.
+ */
+template<typename AssetT>
+class AsyncAsset
+{
+public:
+	AsyncAsset() = default;
+
+	explicit AsyncAsset(std::shared_ptr<AsyncAssetState<AssetT>> state)
+		: m_State(std::move(state))
+	{
+
+	}
+
+	FORCEINLINE bool IsValid() const
+	{
+		return m_State != nullptr;
+	}
+
+	/**
+	 * @return Whether the asset has been loaded and its GPU resources created
+	 */
+	FORCEINLINE bool IsReady() const
+	{
+		return m_State && m_State->Ready;
+	}
+
+	/**
+	 * @return The asset if it's resident, otherwise the placeholder for its type
+	 */
+	SharedPtr<AssetT> Get() const;
+
+	/**
+	 * @brief Calls callback with the asset once it's resident, or immediately if it already is
+	 * @return The connection keeping callback bound; callback is unbound if it's released first
+	 */
+	template<typename LambdaT>
+	typename Event<SharedPtr<AssetT>>::Connection OnReady(LambdaT callback)
+	{
+		CGF_ENSURE_NOT_NULLPTR(m_State);
+
+		if(m_State->Ready)
+		{
+			callback(m_State->Asset);
+			return nullptr;
+		}
+
+		return m_State->OnReady.Connect(callback);
+	}
+
+private:
+	std::shared_ptr<AsyncAssetState<AssetT>> m_State;
+};
 
 
 /**
@@ -27,11 +108,27 @@
  * The AssetLibrary class streams the compiled CGFB and provides an interface to convert arbitrary
  * asset data into an instance of an asset. The asset data pertaining to a named asset is loaded
  * via AssetDataLoader upon a corresponding call to Get().
+ * 
+ * Assets are loaded in two steps: Decode() reads and decodes an asset's data, which is safe to do
+ * on any thread, and the step it returns creates the asset and its GPU resources, which must be done
+ * on the render thread. Get() does both immediately, whereas GetAsync() queues the first as a background
+ * job on the engine's JobSystem, which the game thread never picks up while waiting on its own jobs, and
+ * the second for ProcessUploads().
  **/
 class AssetLibrary
 {
 public:
-	AssetLibrary(const char* projectFilePath);
+	/**
+	 * @param jobs The job system assets requested with GetAsync() are read and decoded on
+	 * @param maxConcurrentDecodes The most assets decoded at once, so streaming never occupies every thread
+	 */
+	AssetLibrary(const char* projectFilePath, JobSystem& jobs, unsigned int maxConcurrentDecodes = 2);
+
+	AssetLibrary(const AssetLibrary& other) = delete;
+
+	~AssetLibrary();
+
+	AssetLibrary& operator=(const AssetLibrary& other) = delete;
 
 	/**
 	 * @tparam AssetType 
@@ -41,37 +138,290 @@ public:
 	template<typename AssetT>
 	SharedPtr<AssetT> Get(std::string assetName)
 	{
-		static std::unordered_map<std::string, SharedPtr<AssetT>> loadedAssets;
+		MemoryTagScope memoryTag (MemoryTag::Assets);
+
+		const AssetId id = MakeAssetId<AssetT>(assetName);
 
-		if(loadedAssets.find(assetName) != loadedAssets.end())
-			return loadedAssets[assetName];
+		if(SharedPtr<AssetT> cached = m_Cache.Find<AssetT>(id))
+			return cached;
 
-		return loadedAssets[assetName] = Load<AssetT>(assetName);
+		return m_Cache.Insert(id, Load<AssetT>(assetName));
+	}
+
+	/**
+	 * @brief Requests an asset without blocking; it's read and decoded by a job, and created during a
+	 * later call to ProcessUploads(). Must be called on the render thread.
+	 * 
+	 * @param assetName The name of the asset as registered in the project descriptor; not its file path
+	 * @param priority Requests with greater priorities are decoded first. Requesting an asset which is
+	 * already queued with a greater priority moves it up the queue.
+	 */
+	template<typename AssetT>
+	AsyncAsset<AssetT> GetAsync(std::string assetName, int priority = 0)
+	{
+		MemoryTagScope memoryTag (MemoryTag::Assets);
+
+		const AssetId id = MakeAssetId<AssetT>(assetName);
+
+		if(SharedPtr<AssetT> cached = m_Cache.Find<AssetT>(id))
+		{
+			auto state = std::make_shared<AsyncAssetState<AssetT>>();
+			state->Ready = true;
+			state->Asset = cached;
+
+			return AsyncAsset<AssetT>(state);
+		}
+
+		auto pending = m_PendingAssets.find(id);
+
+		if(pending != m_PendingAssets.end())
+		{
+			if(priority > pending->second.Request->Priority && !pending->second.Request->Claimed)
+			{
+				QueueDecode(pending->second.Request, priority);
+			}
+
+			return AsyncAsset<AssetT>(std::static_pointer_cast<AsyncAssetState<AssetT>>(pending->second.State));
+		}
+
+		auto state = std::make_shared<AsyncAssetState<AssetT>>();
+		auto request = std::make_shared<StreamingRequest>();
+
+		request->Decode = [this, id, assetName, state]() -> std::function<void()>
+		{
+			std::function<SharedPtr<AssetT>()> create = Decode<AssetT>(assetName);
+
+			return [this, id, state, create]()
+			{
+				SharedPtr<AssetT> asset = m_Cache.Find<AssetT>(id);
+
+				// The asset may have been loaded synchronously while it was being decoded
+				if(!asset)
+				{
+					asset = m_Cache.Insert(id, create());
+				}
+
+				m_PendingAssets.erase(id);
+
+				state->Asset = asset;
+				state->Ready = true;
+				state->OnReady.Invoke(state->Asset);
+			};
+		};
+
+		m_PendingAssets[id] = { state, request };
+		QueueDecode(request, priority);
+
+		return AsyncAsset<AssetT>(state);
+	}
+
+	/**
+	 * @brief Requests every asset listed by a manifest compiled into the asset file, along with everything
+	 * they depend on, as a single batch; see Preload(std::span<const std::string>, int)
+	 * @return The number of assets requested
+	 */
+	size_t Preload(std::string_view manifestName, int priority = 0);
+
+	/**
+	 * @brief Requests assets, along with everything they depend on, as a single batch. The OS is asked to
+	 * read their blocks in file order, with neighbouring blocks coalesced into single reads, and the assets
+	 * are queued for decoding in that same order, as with GetAsync(). Must be called on the render thread.
+	 * @return The number of assets requested
+	 */
+	size_t Preload(std::span<const std::string> assetNames, int priority = 0);
+
+	/**
+	 * @return The names of the assets an asset depends on, as recorded by the project descriptor
+	 */
+	std::span<const std::string> GetDependencies(const std::string& assetName) const;
+
+	/**
+	 * @return The number of assets requested with GetAsync() or Preload() which aren't yet resident
+	 */
+	FORCEINLINE size_t GetPendingCount() const
+	{
+		return m_PendingAssets.size();
+	}
+
+	/**
+	 * @brief Trims the asset cache, then creates assets whose data has been decoded until the upload
+	 * budget for this frame is spent. At least one asset is created per call,
+	 * so streaming always progresses. Must be called on the render thread.
+	 */
+	void ProcessUploads();
+
+	/**
+	 * @return The cache holding every loaded asset, whose budget bounds the memory they occupy
+	 */
+	FORCEINLINE AssetCache& GetCache()
+	{
+		return m_Cache;
+	}
+
+	/**
+	 * @brief Sets how long ProcessUploads() may spend creating assets each frame
+	 */
+	FORCEINLINE void SetUploadBudget(double seconds)
+	{
+		m_UploadBudget = seconds;
+	}
+
+	/**
+	 * @return The asset provided by AsyncAsset handles of a type until their asset is resident;
+	 * CreatePlaceholder() unless one was given to SetPlaceholder()
+	 */
+	template<typename AssetT>
+	SharedPtr<AssetT> GetPlaceholder()
+	{
+		SharedPtr<AssetT>& placeholder = GetPlaceholderSlot<AssetT>();
+
+		if(!placeholder)
+		{
+			placeholder = CreatePlaceholder<AssetT>();
+		}
+
+		return placeholder;
+	}
+
+	template<typename AssetT>
+	void SetPlaceholder(SharedPtr<AssetT> placeholder)
+	{
+		GetPlaceholderSlot<AssetT>() = placeholder;
 	}
 
 	template<typename AssetT>
 	SharedPtr<AssetT> Load(std::string assetName)
+	{
+		return Decode<AssetT>(assetName)();
+	}
+
+	/**
+	 * @brief Reads and decodes an asset's data; safe to call on any thread
+	 * @return The step creating the asset from its decoded data, which must be run on the render thread
+	 */
+	template<typename AssetT>
+	std::function<SharedPtr<AssetT>()> Decode(std::string assetName)
 	{
 		throw "Asset type not recognized";
 	}
 
+	/**
+	 * @return A placeholder for an asset type, or nullptr if it has none
+	 */
+	template<typename AssetT>
+	SharedPtr<AssetT> CreatePlaceholder()
+	{
+		return nullptr;
+	}
+
 private:
+	/**
+	 * @brief A request for an asset, queued for decoding
+	 */
+	struct StreamingRequest
+	{
+		/**
+		 * @brief Set once a job has begun decoding the request, so that duplicate queue entries left
+		 * by reprioritizing it are skipped
+		 */
+		std::atomic<bool> Claimed = false;
+
+		/**
+		 * @brief The greatest priority the request has been queued with
+		 */
+		int Priority = 0;
+
+		std::function<std::function<void()>()> Decode;
+	};
+
+	struct QueuedRequest
+	{
+		int Priority;
+		uint64_t Sequence;
+		std::shared_ptr<StreamingRequest> Request;
+
+		bool operator<(const QueuedRequest& other) const
+		{
+			return Priority != other.Priority ? Priority < other.Priority : Sequence > other.Sequence;
+		}
+	};
+
+	struct PendingAsset
+	{
+		/**
+		 * @brief The AsyncAssetState shared by the asset's handles
+		 */
+		std::shared_ptr<void> State;
+		std::shared_ptr<StreamingRequest> Request;
+	};
+
+	template<typename AssetT>
+	SharedPtr<AssetT>& GetPlaceholderSlot()
+	{
+		std::shared_ptr<void>& slot = m_Placeholders[typeid(AssetT)];
+
+		if(!slot)
+		{
+			slot = std::make_shared<SharedPtr<AssetT>>();
+		}
+
+		return *static_cast<SharedPtr<AssetT>*>(slot.get());
+	}
+
+	void QueueDecode(std::shared_ptr<StreamingRequest> request, int priority);
+
+	void ReadDependencies();
+
+	/**
+	 * @brief Decodes the request at the top of the queue, then queues another job for the next one, so
+	 * each job only holds its thread for a single asset
+	 */
+	void DecodeNext();
+
 	cgfb::CgfbFileReader m_AssetFile;
-	char* m_AssetData;
-	int m_AssetDataSize;
+	AssetCache m_Cache;
+	std::unordered_map<AssetId, PendingAsset> m_PendingAssets;
+	std::unordered_map<std::type_index, std::shared_ptr<void>> m_Placeholders;
+	std::unordered_map<std::string, std::vector<std::string>> m_Dependencies;
+
+	double m_UploadBudget = 0.002;
+	bool m_Stopping = false;
+	uint64_t m_NextSequence = 0;
+	std::mutex m_QueueMutex;
+	std::priority_queue<QueuedRequest> m_DecodeQueue;
+	std::mutex m_UploadMutex;
+	std::deque<std::function<void()>> m_UploadQueue;
+
+	JobSystem& m_Jobs;
+	JobCounter m_DecodeJobs;
+	unsigned int m_MaxConcurrentDecodes;
+
+	/**
+	 * @brief The number of decode jobs queued or running, guarded by m_QueueMutex
+	 */
+	unsigned int m_ConcurrentDecodes = 0;
 };
 
 
+template<typename AssetT>
+SharedPtr<AssetT> AsyncAsset<AssetT>::Get() const
+{
+	return IsReady() ? m_State->Asset : Game->GetAssetLibrary()->GetPlaceholder<AssetT>();
+}
+
+
 template<>
-inline SharedPtr<Material> AssetLibrary::Load(std::string materialName)
+inline std::function<SharedPtr<Material>()> AssetLibrary::Decode(std::string materialName)
 {
 	cgfb::CgfbBlock block;
-	m_AssetFile.ReadBlock(materialName.c_str(), block);
+	bool found = m_AssetFile.ReadBlock(materialName, block);
+	CGF_ASSERT(found, "No material named " + materialName + " was found in the asset file");
 
-	std::string domainName, source;
+	std::string_view domainName;
+	std::string source;
 
 	cgfb::CgfbMemoryReader reader ( std::move(block) );
-	reader.Read(&domainName);
+	reader.ReadView(&domainName);
 	reader.Read(&source);
 
 	MaterialDomain domain = MaterialDomain::Invalid;
@@ -86,17 +436,23 @@ inline SharedPtr<Material> AssetLibrary::Load(std::string materialName)
 		domain = MaterialDomain::Opaque;
 	}
 
-	auto fs = std::make_shared<Shader>(materialName, source, SHADER_TYPE_PIXEL);
-	auto vs = std::make_shared<Shader>(materialName, source, SHADER_TYPE_VERTEX);
+	return [materialName, source, domain]() mutable
+	{
+		auto fs = std::make_shared<Shader>(materialName, source, SHADER_TYPE_PIXEL);
+		auto vs = std::make_shared<Shader>(materialName, source, SHADER_TYPE_VERTEX);
 
-	return SharedPtr<Material>::CreateTraced(materialName + "_Material", vs, fs, domain);
+		return SharedPtr<Material>::CreateTraced(materialName + "_Material", vs, fs, domain);
+	};
 }
 
 
 template<>
-inline SharedPtr<MaterialInstance> AssetLibrary::Load(std::string materialName)
+inline std::function<SharedPtr<MaterialInstance>()> AssetLibrary::Decode(std::string materialName)
 {
-	return SharedPtr<MaterialInstance>::Create(Get<Material>(materialName));
+	return [this, materialName]()
+	{
+		return SharedPtr<MaterialInstance>::Create(Get<Material>(materialName));
+	};
 }
 
 
@@ -107,69 +463,96 @@ struct Vertex
 	glm::vec2 UV0;
 };
 
+static_assert(sizeof(Vertex) == sizeof(cgfb::MeshVertex), "Vertex must match the layout of full precision cooked mesh vertices");
 
+
+/**
+ * Meshes are cooked by cgfb_compiler into blocks holding upload-ready vertex and index data (see
+ * cgfb/MeshFormat.h), so loading one only involves creating its buffers.
+ */
 template<>
-inline SharedPtr<StaticMesh> AssetLibrary::Load(std::string meshName)
+inline std::function<SharedPtr<StaticMesh>()> AssetLibrary::Decode(std::string meshName)
 {
 	cgfb::CgfbBlock block;
-	m_AssetFile.ReadBlock(meshName.c_str(), block);
-
-	std::string rawSource;
-
-	cgfb::CgfbMemoryReader reader ( std::move(block) );
-	reader.Read(&rawSource);
-
-	Assimp::Importer importer;
-
-	const aiScene *scene = importer.ReadFileFromMemory(rawSource.c_str(), rawSource.size(), 
-		aiProcess_CalcTangentSpace | 
-		aiProcess_Triangulate | 
-		aiProcess_JoinIdenticalVertices, 
-		"fbx");
-
-	CGF_ASSERT(scene->mNumMeshes, "No mesh found");
-
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-	aiMesh *mesh = scene->mMeshes[0];
-
-	for (int i = 0; i < mesh->mNumFaces; i++)
+	bool found = m_AssetFile.ReadBlock(meshName, block);
+	CGF_ASSERT(found, "No mesh named " + meshName + " was found in the asset file");
+
+	// The block's data is uploaded in place, so the reader holding it outlives this step
+	auto blockReader = std::make_shared<cgfb::CgfbMemoryReader>(std::move(block));
+	cgfb::CgfbMemoryReader& reader = *blockReader;
+
+	cgfb::MeshHeader header;
+	cgfb::ReadMeshHeader(reader, &header);
+	CGF_ASSERT(header.Version == cgfb::MESH_FORMAT_VERSION, "Mesh " + meshName + " was cooked in an unsupported format");
+	CGF_ASSERT(header.VertexStride == cgfb::GetVertexStride(header.Format), "Mesh " + meshName + " was cooked with an unexpected vertex layout");
+
+	MeshLayout layout;
+	layout.IndexType = header.Indices == cgfb::IndexFormat::UInt16 ? VT_UINT16 : VT_UINT32;
+	layout.VertexFormat = header.Format;
+	layout.BoundsCenter = (glm::make_vec3(header.BoundsMin) + glm::make_vec3(header.BoundsMax)) * 0.5f;
+	layout.BoundsRadius = glm::length(glm::make_vec3(header.BoundsMax) - glm::make_vec3(header.BoundsMin)) * 0.5f;
+	layout.Lods.resize(header.LodCount);
+
+	// Quantized positions are stored relative to the mesh's bounds, which the renderer undoes as part of the MVP
+	if(header.Format.Position == cgfb::PositionFormat::Unorm16x4)
 	{
-		indices.insert(indices.end(), mesh->mFaces[i].mIndices, mesh->mFaces[i].mIndices + mesh->mFaces[i].mNumIndices);
+		glm::vec3 boundsMin = glm::make_vec3(header.BoundsMin);
+		glm::vec3 boundsMax = glm::make_vec3(header.BoundsMax);
+
+		layout.PositionTransform = glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), boundsMax - boundsMin);
 	}
 
-	for (int i = 0; i < mesh->mNumVertices; i++)
+	for(MeshLod& lod : layout.Lods)
 	{
-		Vertex newVertex;
-
-		auto pos = mesh->mVertices[i];
-		auto nrm = mesh->mNormals[i];
-		auto uv0 = mesh->mTextureCoords[0][i];
+		cgfb::MeshLod cooked;
+		cgfb::ReadMeshLod(reader, &cooked);
 
-		newVertex.Position = glm::vec3(pos.x, pos.y, pos.z);
-		newVertex.Normal = glm::vec3(nrm.x, nrm.y, nrm.z);
-		newVertex.UV0 = glm::vec3(uv0.x, uv0.y, uv0.z);
+		lod.ScreenSize = cooked.ScreenSize;
+		lod.Submeshes.resize(header.SubmeshCount);
+	}
 
-		vertices.push_back(newVertex);
+	for(MeshLod& lod : layout.Lods)
+	{
+		for(Submesh& submesh : lod.Submeshes)
+		{
+			cgfb::MeshSubmesh cooked;
+			cgfb::ReadMeshSubmesh(reader, &cooked);
+
+			submesh.FirstIndex = cooked.FirstIndex;
+			submesh.IndexCount = cooked.IndexCount;
+			submesh.BaseVertex = cooked.BaseVertex;
+			submesh.MaterialSlot = cooked.MaterialSlot;
+		}
 	}
 
-	RefCntAutoPtr<IBuffer> vbuffer;
-	BufferData vdata(vertices.data(), vertices.size() * sizeof(Vertex));
-	BufferDesc vbufferDesc;
-	vbufferDesc.Name = "test";
-	vbufferDesc.Size = vertices.size() * sizeof(Vertex);
-	vbufferDesc.Usage = USAGE_IMMUTABLE;
-	vbufferDesc.BindFlags = BIND_VERTEX_BUFFER;
-	Game->GetGraphicsContext()->GetRenderDevice()->CreateBuffer(vbufferDesc, &vdata, &vbuffer);
+	const uint64_t indexSize = cgfb::GetIndexSize(header.Indices);
+	std::span<const char> vertexData, indexData;
 
-	RefCntAutoPtr<IBuffer> ibuffer;
-	BufferData idata(indices.data(), indices.size() * sizeof(unsigned int));
-	BufferDesc ibufferDesc;
-	ibufferDesc.Name = "test2";
-	ibufferDesc.Size = indices.size() * sizeof(unsigned int);
-	ibufferDesc.Usage = USAGE_IMMUTABLE;
-	ibufferDesc.BindFlags = BIND_INDEX_BUFFER;
-	Game->GetGraphicsContext()->GetRenderDevice()->CreateBuffer(ibufferDesc, &idata, &ibuffer);
+	reader.SetPosition(header.VertexDataOffset);
+	reader.ReadView(&vertexData, (size_t)header.VertexCount * header.VertexStride);
+	reader.SetPosition(header.IndexDataOffset);
+	reader.ReadView(&indexData, (size_t)header.IndexCount * indexSize);
 
-	return SharedPtr<StaticMesh>::CreateTraced(meshName + "_Source", indices.size(), ibuffer, vbuffer);
+	return [blockReader, meshName, layout, vertexData, indexData, indexCount = header.IndexCount]()
+	{
+		RefCntAutoPtr<IBuffer> vbuffer;
+		BufferData vdata(vertexData.data(), vertexData.size());
+		BufferDesc vbufferDesc;
+		vbufferDesc.Name = "Static Mesh Vertex Buffer";
+		vbufferDesc.Size = vertexData.size();
+		vbufferDesc.Usage = USAGE_IMMUTABLE;
+		vbufferDesc.BindFlags = BIND_VERTEX_BUFFER;
+		Game->GetGraphicsContext()->GetRenderDevice()->CreateBuffer(vbufferDesc, &vdata, &vbuffer);
+
+		RefCntAutoPtr<IBuffer> ibuffer;
+		BufferData idata(indexData.data(), indexData.size());
+		BufferDesc ibufferDesc;
+		ibufferDesc.Name = "Static Mesh Index Buffer";
+		ibufferDesc.Size = indexData.size();
+		ibufferDesc.Usage = USAGE_IMMUTABLE;
+		ibufferDesc.BindFlags = BIND_INDEX_BUFFER;
+		Game->GetGraphicsContext()->GetRenderDevice()->CreateBuffer(ibufferDesc, &idata, &ibuffer);
+
+		return SharedPtr<StaticMesh>::CreateTraced(meshName + "_Source", indexCount, layout, ibuffer, vbuffer);
+	};
 }
\ No newline at end of file
@@ -18,6 +18,8 @@ class ActorComponent
 public:
 	ActorComponent();
 
+	virtual ~ActorComponent() = default;
+
 	virtual void Start();
 
 	virtual void TickComponent(double deltaTime);
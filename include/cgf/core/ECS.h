@@ -0,0 +1,520 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/Common.h"
+#include "core/Allocators.h"
+
+
+/**
+ * @brief The most component types a program can define, as signatures are bitsets of this width
+ */
+constexpr uint32_t CGF_MAX_COMPONENT_TYPES = 64;
+
+/**
+ * @brief The size of the chunks archetypes store their components in; small enough that a chunk being
+ * swept stays in L1 alongside whatever a system is computing from it
+ */
+constexpr size_t CGF_CHUNK_SIZE = 16 * 1024;
+
+
+/**
+ * @brief The set of component types an entity has, with a bit set for each type's index
+ */
+using ComponentSignature = std::bitset<CGF_MAX_COMPONENT_TYPES>;
+
+
+/**
+ * @brief Identifies an entity within its registry. Indices are reused once entities are destroyed, so each
+ * entity also carries the generation of its index; handles to destroyed entities never match a live one.
+ */
+struct Entity
+{
+	uint32_t Index = UINT32_MAX;
+	uint32_t Generation = 0;
+
+	FORCEINLINE bool IsNull() const
+	{
+		return Index == UINT32_MAX;
+	}
+
+	bool operator==(const Entity& other) const = default;
+};
+
+
+/**
+ * @brief How a component type is laid out, and how values of it are moved and destroyed by code which
+ * doesn't know the type
+ */
+struct ComponentTypeInfo
+{
+	uint32_t Index = 0;
+	size_t Size = 0;
+	size_t Alignment = 0;
+
+	/**
+	 * @brief Move-constructs dest from source, then destroys source
+	 */
+	void (*Relocate)(void* dest, void* source) = nullptr;
+
+	void (*Destroy)(void* value) = nullptr;
+};
+
+
+/**
+ * @brief Assigns every component type an index, the first time it's used, which is the type's bit in
+ * signatures. Indices are shared by every registry.
+ */
+class ComponentTypes
+{
+public:
+	template<typename T>
+	static const ComponentTypeInfo& Get()
+	{
+		static_assert(std::is_same_v<T, std::remove_cvref_t<T>>,
+			"Component types can't be references or cv-qualified");
+
+		static_assert(std::is_move_constructible_v<T>,
+			"Components must be move constructible, as they move between chunks as entities change archetype");
+
+		static const ComponentTypeInfo& info = Register(ComponentTypeInfo
+		{
+			.Size = sizeof(T),
+			.Alignment = alignof(T),
+			.Relocate = [](void* dest, void* source)
+			{
+				new (dest) T(std::move(*(T*)source));
+				((T*)source)->~T();
+			},
+			.Destroy = [](void* value)
+			{
+				((T*)value)->~T();
+			}
+		});
+
+		return info;
+	}
+
+	static const ComponentTypeInfo& Get(uint32_t index);
+
+	template<typename... T>
+	static ComponentSignature GetSignature()
+	{
+		ComponentSignature signature;
+		(signature.set(Get<std::remove_cvref_t<T>>().Index), ...);
+
+		return signature;
+	}
+
+private:
+	static const ComponentTypeInfo& Register(ComponentTypeInfo info);
+};
+
+
+/**
+ * @brief A fixed size block of memory holding a run of an archetype's entities, with each component type
+ * packed into its own column, i.e. every position, then every velocity
+ */
+struct ComponentChunk
+{
+	std::byte* Data = nullptr;
+	uint32_t Count = 0;
+};
+
+
+/**
+ * @brief Stores every entity with exactly the same set of component types. Entities are packed densely
+ * into chunks, with every chunk but the last full, so a query sweeps each column linearly.
+ */
+class Archetype
+{
+public:
+	Archetype(const ComponentSignature& signature);
+
+	Archetype(const Archetype& other) = delete;
+
+	~Archetype();
+
+	Archetype& operator=(const Archetype& other) = delete;
+
+	/**
+	 * @brief Appends a row for entity, whose components are left uninitialized for the caller to construct
+	 * @return The row, counted across every chunk
+	 */
+	uint32_t AllocateRow(Entity entity);
+
+	/**
+	 * @brief Removes a row whose components have already been destroyed or relocated, moving the last
+	 * row into its place to keep the archetype dense
+	 * @return The entity moved into the row, or a null entity if the removed row was the last
+	 */
+	Entity RemoveRow(uint32_t row);
+
+	FORCEINLINE void* GetComponent(uint32_t row, uint32_t typeIndex) const
+	{
+		const ComponentChunk& chunk = m_Chunks[row / m_ChunkCapacity];
+
+		return chunk.Data + m_ColumnOffsets[typeIndex] + (size_t)(row % m_ChunkCapacity) * m_ComponentSizes[typeIndex];
+	}
+
+	template<typename T>
+	FORCEINLINE T* GetColumn(const ComponentChunk& chunk) const
+	{
+		return (T*)(chunk.Data + m_ColumnOffsets[ComponentTypes::Get<std::remove_const_t<T>>().Index]);
+	}
+
+	FORCEINLINE Entity* GetEntities(const ComponentChunk& chunk) const
+	{
+		return (Entity*)chunk.Data;
+	}
+
+	FORCEINLINE const ComponentSignature& GetSignature() const
+	{
+		return m_Signature;
+	}
+
+	FORCEINLINE bool Has(uint32_t typeIndex) const
+	{
+		return m_Signature.test(typeIndex);
+	}
+
+	/**
+	 * @return The index of every component type in the archetype, in ascending order
+	 */
+	FORCEINLINE const std::vector<uint32_t>& GetTypes() const
+	{
+		return m_Types;
+	}
+
+	FORCEINLINE const std::vector<ComponentChunk>& GetChunks() const
+	{
+		return m_Chunks;
+	}
+
+	FORCEINLINE uint32_t GetChunkCapacity() const
+	{
+		return m_ChunkCapacity;
+	}
+
+	FORCEINLINE uint32_t GetEntityCount() const
+	{
+		return m_EntityCount;
+	}
+
+	/**
+	 * @brief The archetypes an entity of this archetype moves to when a component type is added or
+	 * removed, keyed by the type's index; filled in as transitions are first made
+	 */
+	std::unordered_map<uint32_t, Archetype*> AddEdges;
+	std::unordered_map<uint32_t, Archetype*> RemoveEdges;
+
+private:
+	ComponentSignature m_Signature;
+	std::vector<uint32_t> m_Types;
+	std::array<uint32_t, CGF_MAX_COMPONENT_TYPES> m_ColumnOffsets = {};
+	std::array<uint32_t, CGF_MAX_COMPONENT_TYPES> m_ComponentSizes = {};
+	uint32_t m_ChunkCapacity = 0;
+	size_t m_ChunkSize = 0;
+	size_t m_ChunkAlignment = 0;
+	uint32_t m_EntityCount = 0;
+	std::vector<ComponentChunk> m_Chunks;
+};
+
+
+/**
+ * @brief Owns a scene's entities and their components, grouped into archetypes by the set of component
+ * types each entity has. Components are plain values stored by type in packed columns, rather than
+ * objects allocated individually, so iterating a component type is a sweep over contiguous memory.
+ *
+ * Entities can't be created or destroyed, or have components added or removed, while they're being
+ * iterated, as that would move other entities' components. Iterating and accessing components is safe
+ * from several threads at once, as long as no two threads write the same component.
+ */
+class EntityRegistry
+{
+public:
+	EntityRegistry();
+
+	EntityRegistry(const EntityRegistry& other) = delete;
+
+	EntityRegistry& operator=(const EntityRegistry& other) = delete;
+
+	/**
+	 * @brief Creates an entity with no components
+	 */
+	Entity Create();
+
+	/**
+	 * @brief Creates an entity with each of the given components, all of which must be of different types
+	 */
+	template<typename... ComponentT>
+	Entity Create(ComponentT&&... components)
+	{
+		const ComponentSignature signature = ComponentTypes::GetSignature<ComponentT...>();
+
+		CGF_ASSERT(signature.count() == sizeof...(ComponentT),
+			"An entity can't have more than one component of the same type");
+
+		Archetype* archetype = GetArchetype(signature);
+		Entity entity = CreateIn(archetype);
+		const uint32_t row = m_Records[entity.Index].Row;
+
+		(new (archetype->GetComponent(row, ComponentTypes::Get<std::remove_cvref_t<ComponentT>>().Index))
+			std::remove_cvref_t<ComponentT>(std::forward<ComponentT>(components)), ...);
+
+		return entity;
+	}
+
+	/**
+	 * @brief Destroys an entity and all of its components
+	 */
+	void Destroy(Entity entity);
+
+	bool IsAlive(Entity entity) const;
+
+	/**
+	 * @brief Constructs a component on an entity, moving the entity to the archetype with the component's
+	 * type added; if the entity already has a component of that type, it's replaced instead
+	 */
+	template<typename ComponentT, typename... ConstructorArgT>
+	ComponentT& Emplace(Entity entity, ConstructorArgT&&... args)
+	{
+		const uint32_t typeIndex = ComponentTypes::Get<ComponentT>().Index;
+
+		CGF_ASSERT(IsAlive(entity), "Components can only be added to live entities");
+
+		if(ComponentT* existing = TryGet<ComponentT>(entity))
+		{
+			*existing = ComponentT(std::forward<ConstructorArgT>(args)...);
+			return *existing;
+		}
+
+		EntityRecord& record = m_Records[entity.Index];
+		MoveEntity(entity, GetArchetypeWith(record.Storage, typeIndex));
+
+		return *new (record.Storage->GetComponent(record.Row, typeIndex)) ComponentT(std::forward<ConstructorArgT>(args)...);
+	}
+
+	template<typename ComponentT>
+	std::remove_cvref_t<ComponentT>& Add(Entity entity, ComponentT&& component)
+	{
+		return Emplace<std::remove_cvref_t<ComponentT>>(entity, std::forward<ComponentT>(component));
+	}
+
+	/**
+	 * @brief Destroys an entity's component of type ComponentT, if it has one
+	 */
+	template<typename ComponentT>
+	void Remove(Entity entity)
+	{
+		if(!Has<ComponentT>(entity))
+		{
+			return;
+		}
+
+		MoveEntity(entity, GetArchetypeWithout(m_Records[entity.Index].Storage, ComponentTypes::Get<ComponentT>().Index));
+	}
+
+	template<typename ComponentT>
+	bool Has(Entity entity) const
+	{
+		return IsAlive(entity) && m_Records[entity.Index].Storage->Has(ComponentTypes::Get<ComponentT>().Index);
+	}
+
+	/**
+	 * @return The entity's component of type ComponentT, or nullptr if it hasn't got one. The pointer is
+	 * invalidated by any structural change to the registry, i.e. by adding a component to any entity.
+	 */
+	template<typename ComponentT>
+	ComponentT* TryGet(Entity entity) const
+	{
+		if(!Has<ComponentT>(entity))
+		{
+			return nullptr;
+		}
+
+		const EntityRecord& record = m_Records[entity.Index];
+
+		return (ComponentT*)record.Storage->GetComponent(record.Row, ComponentTypes::Get<ComponentT>().Index);
+	}
+
+	template<typename ComponentT>
+	ComponentT& Get(Entity entity) const
+	{
+		ComponentT* component = TryGet<ComponentT>(entity);
+
+		CGF_ASSERT(component, "The entity has no component of the requested type");
+
+		return *component;
+	}
+
+	/**
+	 * @brief Calls fn for every entity with components of each of the types ComponentT, passing a reference
+	 * to each component, preceded by the entity if fn accepts one, i.e. fn(Position& p, const Velocity& v)
+	 * or fn(Entity e, Position& p, const Velocity& v)
+	 */
+	template<typename... ComponentT, typename FuncT>
+	void ForEach(FuncT&& fn)
+	{
+		ForEachChunk<ComponentT...>([&fn](uint32_t count, const Entity* entities, ComponentT*... columns)
+		{
+			for(uint32_t i = 0; i < count; i++)
+			{
+				if constexpr(std::is_invocable_v<FuncT&, Entity, ComponentT&...>)
+					fn(entities[i], columns[i]...);
+				else
+					fn(columns[i]...);
+			}
+		});
+	}
+
+	/**
+	 * @brief Calls fn(count, entities, columns...) for every chunk of entities with components of each of
+	 * the types ComponentT, where each column points to the chunk's first component of the type; lets a
+	 * system work on whole arrays of components at a time
+	 */
+	template<typename... ComponentT, typename FuncT>
+	void ForEachChunk(FuncT&& fn)
+	{
+		const ComponentSignature signature = ComponentTypes::GetSignature<ComponentT...>();
+
+		m_IterationDepth++;
+
+		for(Archetype* archetype : m_ArchetypeList)
+		{
+			if((archetype->GetSignature() & signature) != signature)
+			{
+				continue;
+			}
+
+			for(const ComponentChunk& chunk : archetype->GetChunks())
+			{
+				fn(chunk.Count, (const Entity*)archetype->GetEntities(chunk), archetype->template GetColumn<ComponentT>(chunk)...);
+			}
+		}
+
+		m_IterationDepth--;
+	}
+
+	/**
+	 * @brief Like ForEachChunk(), but spreads the chunks across executor.ParallelFor(count, task), so fn
+	 * is called concurrently for different chunks
+	 */
+	template<typename... ComponentT, typename ExecutorT, typename FuncT>
+	void ParallelForEachChunk(ExecutorT& executor, FuncT&& fn)
+	{
+		struct ChunkRef
+		{
+			const Archetype* Owner;
+			const ComponentChunk* Chunk;
+		};
+
+		const ComponentSignature signature = ComponentTypes::GetSignature<ComponentT...>();
+
+		m_IterationDepth++;
+
+		ScratchScope scratch;
+		ArenaVector<ChunkRef> chunks (scratch);
+
+		for(Archetype* archetype : m_ArchetypeList)
+		{
+			if((archetype->GetSignature() & signature) != signature)
+			{
+				continue;
+			}
+
+			for(const ComponentChunk& chunk : archetype->GetChunks())
+			{
+				chunks.push_back({ archetype, &chunk });
+			}
+		}
+
+		executor.ParallelFor(chunks.size(), [&](size_t i)
+		{
+			const ComponentChunk& chunk = *chunks[i].Chunk;
+			fn(chunk.Count, (const Entity*)chunks[i].Owner->GetEntities(chunk), chunks[i].Owner->template GetColumn<ComponentT>(chunk)...);
+		});
+
+		m_IterationDepth--;
+	}
+
+	/**
+	 * @brief Like ForEach(), but spreads the matching chunks across executor.ParallelFor(count, task)
+	 */
+	template<typename... ComponentT, typename ExecutorT, typename FuncT>
+	void ParallelForEach(ExecutorT& executor, FuncT&& fn)
+	{
+		ParallelForEachChunk<ComponentT...>(executor, [&fn](uint32_t count, const Entity* entities, ComponentT*... columns)
+		{
+			for(uint32_t i = 0; i < count; i++)
+			{
+				if constexpr(std::is_invocable_v<FuncT&, Entity, ComponentT&...>)
+					fn(entities[i], columns[i]...);
+				else
+					fn(columns[i]...);
+			}
+		});
+	}
+
+	/**
+	 * @return The number of live entities
+	 */
+	FORCEINLINE size_t GetCount() const
+	{
+		return m_Count;
+	}
+
+	/**
+	 * @return Every archetype created so far, including empty ones, in the order they were created
+	 */
+	FORCEINLINE const std::vector<Archetype*>& GetArchetypes() const
+	{
+		return m_ArchetypeList;
+	}
+
+private:
+	struct EntityRecord
+	{
+		uint32_t Generation = 0;
+		Archetype* Storage = nullptr;
+		uint32_t Row = 0;
+	};
+
+	/**
+	 * @brief Allocates an entity and a row for it in archetype, leaving its components uninitialized
+	 */
+	Entity CreateIn(Archetype* archetype);
+
+	Archetype* GetArchetype(const ComponentSignature& signature);
+
+	Archetype* GetArchetypeWith(Archetype* archetype, uint32_t typeIndex);
+
+	Archetype* GetArchetypeWithout(Archetype* archetype, uint32_t typeIndex);
+
+	/**
+	 * @brief Moves an entity's row to another archetype, relocating the components both archetypes have and
+	 * destroying the rest. Components only the new archetype has are left uninitialized.
+	 */
+	void MoveEntity(Entity entity, Archetype* to);
+
+	size_t m_Count = 0;
+
+	/**
+	 * @brief Atomic, as systems running on different threads may iterate the registry at the same time
+	 */
+	std::atomic<int> m_IterationDepth = 0;
+	std::vector<EntityRecord> m_Records;
+	std::vector<uint32_t> m_FreeIndices;
+	std::unordered_map<ComponentSignature, std::unique_ptr<Archetype>> m_Archetypes;
+	std::vector<Archetype*> m_ArchetypeList;
+};
@@ -5,10 +5,8 @@
 #include <functional>
 
 #include "core/Common.h"
-
-
-template<typename T>
-class SharedPtr;
+#include "core/Memory.h"
+#include "core/Allocators.h"
 
 
 /**
@@ -22,13 +20,21 @@ public:
 
 	~Event()
 	{
-		for(Listener* listener : m_Connections)
+		// Listeners held by connections may outlive the event, so those are only detached from it
+		std::vector<Listener*> connections = std::move(m_Connections);
+
+		for(Listener* listener : connections)
 		{
-			delete listener;
+			listener->Owner = nullptr;
+
+			if(listener->OwnedByEvent)
+			{
+				delete listener;
+			}
 		}
 	}
 
-	struct Listener
+	struct Listener : RefCounted
 	{
 		Listener(Event* owner, std::function<void(EventArgT...)> callback)
 			: Owner(owner), Callback(callback)
@@ -44,6 +50,11 @@ public:
 		void Disconnect()
 		{
 			CGF_INFO("Listener lost");
+
+			if(!Owner)
+			{
+				return;
+			}
 			
 			for (int i = 0; i < Owner->m_Connections.size(); i++)
 			{
@@ -56,11 +67,23 @@ public:
 
 		Event* Owner;
 		std::function<void(EventArgT...)> Callback;
+
+		/**
+		 * @brief Whether the listener was made by Bind(), and so is deleted along with the event rather
+		 * than by a Connection
+		 */
+		bool OwnedByEvent = false;
 	};
 
+	/**
+	 * @brief Calls every listener. Their allocations are charged to the caller's MemoryTag, not Events.
+	 */
 	void Invoke(EventArgT... eventData)
 	{
-		std::vector<Listener*> connections = m_Connections;
+		// Listeners may connect or disconnect as they're called, so they're called from a snapshot, taken
+		// in scratch memory as events are invoked every frame
+		ScratchScope scratch;
+		ArenaVector<Listener*> connections (m_Connections.begin(), m_Connections.end(), scratch);
 
 		for (Listener* listener : connections)
 		{
@@ -78,7 +101,10 @@ public:
 	template<typename LambdaT>
 	Listener* Bind(LambdaT lambda)
 	{
+		MemoryTagScope memoryTag (MemoryTag::Events);
+
 		Listener* newListener = new Listener(this, lambda);
+		newListener->OwnedByEvent = true;
 		m_Connections.push_back(newListener);
 
 		return newListener;
@@ -87,6 +113,8 @@ public:
 	template<typename LambdaT>
 	Connection Connect(LambdaT lambda)
 	{
+		MemoryTagScope memoryTag (MemoryTag::Events);
+
 		SharedPtr<Listener> newListener = SharedPtr<Listener>::CreateTraced("EventListenerLambda", this, lambda);
 		m_Connections.push_back(newListener.GetRaw());
 
@@ -95,6 +123,8 @@ public:
 
 	[[nodiscard]] Connection Connect(void (*callback)(EventArgT...))
 	{
+		MemoryTagScope memoryTag (MemoryTag::Events);
+
 		Connection newListener = SharedPtr<Listener>::CreateTraced("EventListener", this, callback); 
 		m_Connections.push_back(newListener.GetRaw());
 
@@ -104,6 +134,8 @@ public:
 	template <typename ObjectT>
 	[[nodiscard]] Connection Connect(ObjectT *object, void (ObjectT::*callback)(EventArgT...))
 	{
+		MemoryTagScope memoryTag (MemoryTag::Events);
+
 		Connection newListener = SharedPtr<Listener>::CreateTraced("EventListenerMemFunc", this, [object, callback](EventArgT... data) 
 		{
 			(object->*callback)(data...);
@@ -114,6 +146,28 @@ public:
 		return newListener;
 	}
 
+	/**
+	 * @brief Binds a member function without keeping its object alive; once the object is destroyed,
+	 * the listener is skipped until its connection is released
+	 */
+	template <typename ObjectT>
+	[[nodiscard]] Connection Connect(WeakPtr<ObjectT> object, void (ObjectT::*callback)(EventArgT...))
+	{
+		MemoryTagScope memoryTag (MemoryTag::Events);
+
+		Connection newListener = SharedPtr<Listener>::CreateTraced("EventListenerWeakMemFunc", this, [object, callback](EventArgT... data)
+		{
+			if(SharedPtr<ObjectT> target = object.Lock())
+			{
+				(target.GetRaw()->*callback)(data...);
+			}
+		});
+
+		m_Connections.push_back(newListener.GetRaw());
+
+		return newListener;
+	}
+
 private:
 	std::vector<Listener*> m_Connections;
 };
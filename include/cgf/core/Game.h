@@ -11,6 +11,8 @@ class Renderer;
 class Window;
 class Scene;
 class Input;
+class JobSystem;
+class FrameAllocator;
 
 
 /**
@@ -21,13 +23,20 @@ class GameBase
 public:
 	GameBase();
 
+	/**
+	 * @brief Releases the current scene and shuts every subsystem down, then reports any memory still
+	 * charged to a MemoryTag if ENABLE_MEMORY_TRACKING is truthy
+	 */
+	virtual ~GameBase();
+
 	/**
 	 * @brief Called immediately after initialization and before the first call to Update()
 	 */
 	virtual void Start();
 
 	/**
-	 * @brief Called every frame, prior to rendering
+	 * @brief Called every frame, prior to rendering. Begins a frame of the frame allocator, so should be
+	 * called by overrides before they allocate from it.
 	 */
 	virtual void Tick(double dT);
 
@@ -71,7 +80,25 @@ public:
 		return m_Input;
 	}
 
+	/**
+	 * @return The scheduler every subsystem runs its parallel work on
+	 */
+	FORCEINLINE JobSystem* GetJobSystem() const
+	{
+		return m_JobSystem;
+	}
+
+	/**
+	 * @return The allocator for data which lives no longer than a frame
+	 */
+	FORCEINLINE FrameAllocator* GetFrameAllocator() const
+	{
+		return m_FrameAllocator;
+	}
+
 private:
+	JobSystem* m_JobSystem;
+	FrameAllocator* m_FrameAllocator;
 	Window* m_Window;
 	AssetLibrary* m_AssetLibrary;
 	Renderer* m_Renderer;
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/Common.h"
+#include "core/Allocators.h"
+
+
+/**
+ * @brief A unit of work run by the JobSystem
+ */
+struct Job
+{
+	std::function<void()> Task;
+
+	/**
+	 * @brief Reported to the profiler hooks; must outlive the job, so is usually a literal
+	 */
+	const char* Name = "Job";
+
+	class JobCounter* Counter = nullptr;
+
+	/**
+	 * @brief Whether the job was started with JobSystem::RunBackground(), so only runs on workers
+	 */
+	bool Background = false;
+
+	/**
+	 * @brief The tag of the thread that started the job, which its allocations are charged to wherever it runs
+	 */
+	MemoryTag Tag = MemoryTag::Untagged;
+};
+
+
+/**
+ * @brief Counts the jobs started with it that haven't finished yet, so that work fanned out across
+ * several jobs can be waited on, or continued from, as a whole. A counter may only be destroyed once
+ * JobSystem::Wait() has returned for it.
+ */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter& other) = delete;
+
+	JobCounter& operator=(const JobCounter& other) = delete;
+
+	FORCEINLINE bool IsDone() const
+	{
+		return m_Pending.load(std::memory_order_acquire) == 0;
+	}
+
+	FORCEINLINE uint32_t GetPending() const
+	{
+		return m_Pending.load(std::memory_order_acquire);
+	}
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_Pending = 0;
+
+	/**
+	 * @brief Guards the continuations, which are started when the count next reaches zero
+	 */
+	std::mutex m_Mutex;
+	std::vector<Job> m_Continuations;
+};
+
+
+/**
+ * @brief Called around every job a thread runs, e.g. to record it in a profiler's timeline
+ */
+struct JobProfilerHooks
+{
+	std::function<void(const char* name, unsigned int thread)> OnJobBegin;
+	std::function<void(const char* name, unsigned int thread)> OnJobEnd;
+
+	/**
+	 * @brief Called as a worker goes to sleep for lack of jobs, and as it wakes
+	 */
+	std::function<void(unsigned int thread, bool sleeping)> OnWorkerIdle;
+};
+
+
+/**
+ * @brief The engine's scheduler, on which every subsystem runs its parallel work rather than starting
+ * threads of its own
+ *
+ * The thread that creates the job system takes part as thread 0, running jobs whenever it waits on them,
+ * alongside a fixed set of workers. Each thread has its own deque: it runs the newest job it queued
+ * itself, and idle threads steal the oldest jobs from the others, so jobs tend to run where their data
+ * was just touched. Jobs queued from threads outside the system go to a deque shared by every thread.
+ *
+ * Waiting never blocks a thread the system owns: Wait() runs other jobs until the counter reaches zero,
+ * and RunAfter() queues a continuation that starts once it does, without holding up any thread at all.
+ *
+ * Long jobs which nothing waits on within a frame, such as streaming assets, are started with
+ * RunBackground() instead. They go to a queue of their own, which workers only take from once every
+ * deque is empty, and which Wait() never takes from, so a thread waiting mid-frame is never held up by one.
+ */
+class JobSystem
+{
+public:
+	/**
+	 * @param workerCount The number of workers; defaults to one less than the number of hardware threads,
+	 * as the thread creating the system does work too
+	 */
+	JobSystem(unsigned int workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
+	JobSystem(const JobSystem& other) = delete;
+
+	/**
+	 * @brief Stops the workers once they've run every job already queued
+	 */
+	~JobSystem();
+
+	JobSystem& operator=(const JobSystem& other) = delete;
+
+	/**
+	 * @brief Queues a job; counter, if given, counts it until it finishes
+	 */
+	void Run(std::function<void()> task, JobCounter* counter = nullptr, const char* name = "Job");
+
+	/**
+	 * @brief Queues a job on the background queue, run in the order queued by workers with nothing else
+	 * to do; counter, if given, counts it until it finishes
+	 */
+	void RunBackground(std::function<void()> task, JobCounter* counter = nullptr, const char* name = "Job");
+
+	/**
+	 * @brief Queues a job once dependency reaches zero, or immediately if it's already zero. counter
+	 * counts the job from now, so waiting on it also waits for the dependency.
+	 */
+	void RunAfter(JobCounter& dependency, std::function<void()> task, JobCounter* counter = nullptr, const char* name = "Job");
+
+	/**
+	 * @brief Runs other jobs until counter reaches zero, leaving background jobs to the workers unless
+	 * there are none. Safe to call from within a job.
+	 */
+	void Wait(JobCounter& counter);
+
+	/**
+	 * @brief Calls task(begin, end) over consecutive ranges covering [0, count), spread across every
+	 * thread, and returns once all calls have completed. Safe to call from within a job.
+	 *
+	 * Ranges are sized so that every thread gets a few, letting uneven ranges balance out.
+	 * @param minGrainSize The fewest indices per range, for tasks too cheap per index to be worth a job each
+	 */
+	void ParallelForRange(size_t count, const std::function<void(size_t begin, size_t end)>& task, size_t minGrainSize = 1, const char* name = "ParallelFor");
+
+	/**
+	 * @brief Calls task(i) for every i in [0, count), as ParallelForRange()
+	 */
+	void ParallelFor(size_t count, const std::function<void(size_t)>& task, size_t minGrainSize = 1, const char* name = "ParallelFor");
+
+	/**
+	 * @return The number of threads running jobs, including the one that created the system
+	 */
+	FORCEINLINE unsigned int GetThreadCount() const
+	{
+		return m_Workers.size() + 1;
+	}
+
+	/**
+	 * @return The calling thread's index, from 0 for the creating thread to GetThreadCount() - 1, or
+	 * GetThreadCount() for threads outside the system
+	 */
+	unsigned int GetCurrentThreadIndex() const;
+
+	/**
+	 * @brief Installs hooks, or removes them if nullptr. Jobs already running may still use the previous
+	 * hooks, so hooks must outlive the job system.
+	 */
+	FORCEINLINE void SetProfilerHooks(const JobProfilerHooks* hooks)
+	{
+		m_Hooks.store(hooks, std::memory_order_release);
+	}
+
+private:
+	/**
+	 * @brief A thread's jobs, in a ring buffer rather than a std::deque, which allocates and frees blocks
+	 * as jobs come and go; the ring only allocates as it grows
+	 */
+	struct JobQueue
+	{
+		void PushBack(Job&& job);
+
+		Job PopBack();
+
+		Job PopFront();
+
+		FORCEINLINE bool IsEmpty() const
+		{
+			return Count == 0;
+		}
+
+		std::mutex Mutex;
+
+		/**
+		 * @brief Sized to a power of two, holding Count jobs from Head onwards, wrapping around
+		 */
+		std::vector<Job> Jobs;
+		size_t Head = 0;
+		size_t Count = 0;
+	};
+
+	void Queue(Job job);
+
+	void RunWorker(unsigned int index);
+
+	/**
+	 * @brief Takes the newest job from the thread's own deque, or failing that the oldest job from any other,
+	 * or failing that the oldest background job if background is true
+	 */
+	bool TryTakeJob(unsigned int index, Job& job, bool background);
+
+	void Execute(Job& job, unsigned int thread);
+
+	void Finish(JobCounter& counter);
+
+	bool m_Stopping = false;
+	std::atomic<size_t> m_QueuedCount = 0;
+	std::atomic<size_t> m_SleepingCount = 0;
+	std::mutex m_Mutex;
+	std::condition_variable m_JobAvailable;
+
+	/**
+	 * @brief A deque per thread, the creating thread's first, followed by the deque shared by threads
+	 * outside the system
+	 */
+	std::vector<std::unique_ptr<JobQueue>> m_Queues;
+	JobQueue m_BackgroundQueue;
+	std::vector<std::thread> m_Workers;
+	std::atomic<const JobProfilerHooks*> m_Hooks = nullptr;
+};
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <type_traits>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
 #include <unordered_map>
 #include <algorithm>
+#include <cstring>
 
 #include "core/Common.h"
-#include "core/Events.h"
 
 #define ENABLE_SMART_PTR_TRACING false
 
@@ -20,75 +27,247 @@
 #endif	
 
 
+template<typename... EventArgT>
+class Event;
+
+typedef Event<> Notifier;
+
+
 /**
- * @brief A wrapper for an arbitrarily typed, heap-allocated pointer which
- * facilitates reference counting for use with smart pointers. Upon losing all
- * references (a condition checked for every time DecrementRefCnt() is called)
- * the handle deletes itself and the pointer it references.
+ * @brief The reference count shared by every SharedPtr to an object, along with the event invoked as
+ * the object is destroyed. Objects made by SharedPtr<T>::Create() share a single allocation with their
+ * block, while types deriving RefCounted carry their block inside themselves.
  * 
- * The handle may store trace information which can be useful for debugging if
- * the associated preprocessor value is truthy.
+ * The count is atomic, so pointers to the same object may be copied and released on different threads.
+ * Gaining a reference needs no ordering, as the pointer being copied already holds one; releasing the
+ * last reference must see every other thread's uses of the object before destroying it.
  * 
- * @tparam ManagedT 
+ * A second count is kept of the WeakPtrs to the object, plus one held by its SharedPtrs as a whole. The
+ * object is destroyed once the first count reaches zero, but the block is only freed once the second
+ * does, so weak pointers can still tell that the object is gone. Both counts share one atomic word, so
+ * a single load can tell whether a pointer is the object's only reference of either kind.
+ * 
+ * The block may store trace information which can be useful for debugging if the associated
+ * preprocessor value is truthy.
  */
-template<typename ManagedT>
-struct SharedObjectHandle
+struct SharedControlBlock
 {
-	SharedObjectHandle(ManagedT* object)
-		: Object(object)
-	{
+	using DestroyFunc = void (*)(SharedControlBlock* block);
 
-	}
+	static constexpr uint64_t STRONG_REF = 1;
+	static constexpr uint64_t WEAK_REF = 1ull << 32;
+	static constexpr uint64_t STRONG_MASK = WEAK_REF - 1;
 
-#if ENABLE_SMART_PTR_TRACING
-	SharedObjectHandle(ManagedT* object, std::string name)
-		: Object(object), Name(name)
+	/**
+	 * @param destroy Destroys the object
+	 * @param free Frees the block once no weak pointer references it; nullptr for blocks destroyed along
+	 * with their object, which can't be weakly referenced
+	 */
+	explicit SharedControlBlock(DestroyFunc destroy, DestroyFunc free = nullptr)
+		: Destroy(destroy), Free(free)
 	{
 
 	}
-#endif
 
-	~SharedObjectHandle()
-	{
-		CGF_LOG_TRACE(Name, "Destroyed ref");
+	SharedControlBlock(const SharedControlBlock& other) = delete;
 
-		OnDestruction.Invoke();
-
-		delete Object;
-	}
+	SharedControlBlock& operator=(const SharedControlBlock& other) = delete;
 
 	/**
-	 * @brief Adds one to the pointers's reference count
+	 * @brief Adds one to the object's reference count
 	 */
-	void IncrementRefCnt()
+	FORCEINLINE void IncrementRefCnt()
 	{
 		CGF_LOG_TRACE(Name, "Gained ref");
 
-		RefCount++;
+		Counts.fetch_add(STRONG_REF, std::memory_order_relaxed);
 	}
 
 	/**
-	 * @brief Subtracts one from the pointers's reference count
+	 * @brief Subtracts one from the object's reference count, destroying it if that was the last
 	 */
-	void DecrementRefCnt()
+	FORCEINLINE void DecrementRefCnt()
 	{
 		CGF_LOG_TRACE(Name, "Lost ref");
 
-		RefCount--;
+		// The only reference, with no weak pointer to gain another, can't be copied from, so the atomic
+		// decrement can be skipped
+		if(Counts.load(std::memory_order_acquire) == STRONG_REF + WEAK_REF)
+		{
+			Counts.store(WEAK_REF, std::memory_order_relaxed);
+			ReleaseLast();
+		}
+		else if((Counts.fetch_sub(STRONG_REF, std::memory_order_release) & STRONG_MASK) == 1)
+		{
+			ReleaseLast();
+		}
+	}
+
+	/**
+	 * @brief Adds one to the object's reference count unless it has already been destroyed
+	 * @return Whether a reference was gained
+	 */
+	FORCEINLINE bool TryIncrementRefCnt()
+	{
+		uint64_t counts = Counts.load(std::memory_order_relaxed);
+
+		while(counts & STRONG_MASK)
+		{
+			if(Counts.compare_exchange_weak(counts, counts + STRONG_REF, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	FORCEINLINE void IncrementWeakCnt()
+	{
+		Counts.fetch_add(WEAK_REF, std::memory_order_relaxed);
+	}
 
-		if(RefCount <= 0)
+	/**
+	 * @brief Subtracts one from the weak count, freeing the block if that was the last
+	 */
+	FORCEINLINE void DecrementWeakCnt()
+	{
+		// The counts only read as a lone weak reference once the object is gone and this holds the last one
+		if(Counts.load(std::memory_order_acquire) == WEAK_REF || Counts.fetch_sub(WEAK_REF, std::memory_order_acq_rel) == WEAK_REF)
 		{
-			delete this;
+			Free(this);
 		}
 	}
 
-	int RefCount = 0;
-	Notifier OnDestruction;
-	ManagedT* Object;
+	/**
+	 * @brief Sets the counts for a newly made object's first reference, which nothing else can see yet
+	 */
+	FORCEINLINE void Adopt()
+	{
+		Counts.store(STRONG_REF + WEAK_REF, std::memory_order_relaxed);
+	}
+
+	FORCEINLINE int GetRefCount() const
+	{
+		return Counts.load(std::memory_order_relaxed) & STRONG_MASK;
+	}
+
+	/**
+	 * @return The event invoked immediately prior to the object's destruction, which is only allocated
+	 * once it's first asked for
+	 */
+	Notifier* GetDestructionEvent();
+
+	/**
+	 * @brief The weak count in the upper half, and the reference count in the lower
+	 */
+	std::atomic<uint64_t> Counts = WEAK_REF;
+	std::atomic<Notifier*> OnDestruction = nullptr;
+	DestroyFunc Destroy;
+	DestroyFunc Free;
 
 #if ENABLE_SMART_PTR_TRACING
 	std::string Name = "?";
 #endif
+
+private:
+	void ReleaseLast();
+};
+
+
+/**
+ * @brief Holds an object made by SharedPtr<T>::Create() in the same allocation as its control block
+ */
+template<typename ManagedT>
+struct SharedObjectBlock : SharedControlBlock
+{
+	SharedObjectBlock()
+		: SharedControlBlock([](SharedControlBlock* block)
+		{
+			static_cast<SharedObjectBlock*>(block)->GetObject()->~ManagedT();
+		},
+		[](SharedControlBlock* block)
+		{
+			delete static_cast<SharedObjectBlock*>(block);
+		})
+	{
+
+	}
+
+	FORCEINLINE ManagedT* GetObject()
+	{
+		return std::launder(reinterpret_cast<ManagedT*>(Storage));
+	}
+
+	alignas(ManagedT) unsigned char Storage[sizeof(ManagedT)];
+};
+
+
+/**
+ * @brief Adopts an object allocated elsewhere, i.e. passed to SharedPtr's raw pointer constructor, which
+ * costs a second allocation for the block
+ */
+template<typename ManagedT>
+struct SharedPointerBlock : SharedControlBlock
+{
+	explicit SharedPointerBlock(ManagedT* object)
+		: SharedControlBlock([](SharedControlBlock* block)
+		{
+			delete static_cast<SharedPointerBlock*>(block)->Object;
+		},
+		[](SharedControlBlock* block)
+		{
+			delete static_cast<SharedPointerBlock*>(block);
+		}), Object(object)
+	{
+
+	}
+
+	ManagedT* Object;
+};
+
+
+/**
+ * @brief A base for engine types whose reference count lives inside the object itself. They're made
+ * with a single allocation even when constructed with new, and a SharedPtr can be made from any raw
+ * pointer to one, e.g. this, without a second block coming into being. As the count is freed along
+ * with the object, they can't be referenced by a WeakPtr.
+ */
+class RefCounted : private SharedControlBlock
+{
+public:
+	RefCounted()
+		: SharedControlBlock(&DestroySelf)
+	{
+
+	}
+
+	/**
+	 * @brief Copies start with their own count, as they're separate objects
+	 */
+	RefCounted(const RefCounted& other)
+		: SharedControlBlock(&DestroySelf)
+	{
+
+	}
+
+	RefCounted& operator=(const RefCounted& other)
+	{
+		return *this;
+	}
+
+	virtual ~RefCounted() = default;
+
+	FORCEINLINE SharedControlBlock* GetControlBlock() const
+	{
+		return const_cast<RefCounted*>(this);
+	}
+
+private:
+	static void DestroySelf(SharedControlBlock* block)
+	{
+		delete static_cast<RefCounted*>(block);
+	}
 };
 
 
@@ -107,7 +286,12 @@ struct overloads_arrow_operator<T, std::void_t<decltype(std::declval<T>().operat
 
 
 /**
- * @brief
+ * @brief A reference counted pointer to a heap-allocated object, which is destroyed along with the last
+ * pointer to it
+ * 
+ * Each pointer holds the object and its control block, so pointers to different bases of the same object
+ * share one count. Create() allocates the object and its block together; for types deriving RefCounted,
+ * the block is part of the object. Moving a pointer hands its reference over without touching the count.
  * 
  * @tparam ManagedT 
  */
@@ -120,31 +304,86 @@ public:
 		
 	}
 
+	/**
+	 * @brief Takes ownership of an object allocated with new. Prefer Create(), which saves the second
+	 * allocation this makes for the control block of types not deriving RefCounted.
+	 */
 	explicit SharedPtr(ManagedT* object)
 	{
-		Attach(new SharedObjectHandle<ManagedT>(object));
+		if(!object)
+		{
+			return;
+		}
+
+		if constexpr(std::is_base_of_v<RefCounted, ManagedT>)
+		{
+			Attach(object, object->GetControlBlock());
+		}
+		else
+		{
+			Attach(object, new SharedPointerBlock<ManagedT>(object));
+		}
 	}
 
-	SharedPtr(nullptr_t ptr)
+	SharedPtr(std::nullptr_t ptr)
 	{
 		
 	}
 
-#if ENABLE_SMART_PTR_TRACING
-	explicit SharedPtr(ManagedT* object, std::string name)
+	SharedPtr(const SharedPtr& other)
+		: m_Object(other.m_Object), m_Block(other.m_Block)
 	{
-		Attach(new SharedObjectHandle<ManagedT>(object, name));
+		if(m_Block)
+		{
+			m_Block->IncrementRefCnt();
+		}
 	}
-#endif
 
-	explicit SharedPtr(SharedObjectHandle<ManagedT>* handle)
+	SharedPtr(SharedPtr&& other) noexcept
+		: m_Object(std::exchange(other.m_Object, nullptr)), m_Block(std::exchange(other.m_Block, nullptr))
+	{
+
+	}
+
+	/**
+	 * @brief Converts a pointer to a derived type into a pointer to its base, sharing its count
+	 */
+	template<typename OtherT, typename = std::enable_if_t<std::is_convertible_v<OtherT*, ManagedT*> && !std::is_same_v<OtherT, ManagedT>>>
+	SharedPtr(const SharedPtr<OtherT>& other)
+		: m_Object(other.m_Object), m_Block(other.m_Block)
+	{
+		if(m_Block)
+		{
+			m_Block->IncrementRefCnt();
+		}
+	}
+
+	template<typename OtherT, typename = std::enable_if_t<std::is_convertible_v<OtherT*, ManagedT*> && !std::is_same_v<OtherT, ManagedT>>>
+	SharedPtr(SharedPtr<OtherT>&& other) noexcept
+		: m_Object(std::exchange(other.m_Object, nullptr)), m_Block(std::exchange(other.m_Block, nullptr))
+	{
+
+	}
+
+	/**
+	 * @brief Shares owner's count while pointing to object, which must live as long as owner's object,
+	 * e.g. a base or member of it. Used by StaticCast() and DynamicCast().
+	 */
+	template<typename OtherT>
+	SharedPtr(const SharedPtr<OtherT>& owner, ManagedT* object)
+		: m_Object(object), m_Block(owner.m_Block)
 	{
-		Attach(handle);
+		if(m_Block)
+		{
+			m_Block->IncrementRefCnt();
+		}
 	}
 
-	SharedPtr(const SharedPtr<ManagedT>& other)
+	template<typename OtherT>
+	SharedPtr(SharedPtr<OtherT>&& owner, ManagedT* object) noexcept
+		: m_Object(object), m_Block(std::exchange(owner.m_Block, nullptr))
 	{
-		Attach(other.m_Ref);
+		owner.m_Object = nullptr;
 	}
 
 	~SharedPtr()
@@ -152,40 +391,39 @@ public:
 		Detach();
 	}
 
-	SharedPtr<ManagedT>& operator=(const SharedPtr<ManagedT>& other)
+	SharedPtr& operator=(const SharedPtr& other)
 	{
-		Attach(other.m_Ref);
+		// The other pointer's reference is gained first, in case both point to the same object
+		SharedPtr(other).Swap(*this);
 
 		return *this;
 	}
 
-	SharedPtr<ManagedT>& operator=(const nullptr_t& other)
+	SharedPtr& operator=(SharedPtr&& other) noexcept
 	{
-		Detach();
+		SharedPtr(std::move(other)).Swap(*this);
 
 		return *this;
 	}
 
-	ManagedT& operator*()
+	SharedPtr& operator=(std::nullptr_t other)
 	{
-		CGF_ASSERT(Valid(), "Cannot dereference nullptr");
-		
-		return *(ManagedT*)m_Ref->Object;
+		Detach();
+
+		return *this;
 	}
 
-	template<typename TargetManagedT>
-	operator SharedPtr<TargetManagedT>() const
+	ManagedT& operator*() const
 	{
-		static_assert(std::is_base_of_v<TargetManagedT, ManagedT> || std::is_base_of_v<ManagedT, TargetManagedT>, 
-			"Cannot convert to or from an underived type");
-
-		return SharedPtr<TargetManagedT>( (SharedObjectHandle<TargetManagedT>*) m_Ref );
+		CGF_ASSERT(Valid(), "Cannot dereference nullptr");
+		
+		return *m_Object;
 	}
 
 	/**
 	 * @brief see Valid()
 	 */
-	operator bool() const
+	explicit operator bool() const
 	{
 		return Valid();
 	}
@@ -196,15 +434,24 @@ public:
 	 */
 	FORCEINLINE bool Valid() const
 	{
-		return m_Ref;
+		return m_Object;
+	}
+
+	/**
+	 * @return The number of shared pointers referencing the object, including this one; 0 if this
+	 * pointer is null
+	 */
+	FORCEINLINE int GetRefCount() const
+	{
+		return m_Block ? m_Block->GetRefCount() : 0;
 	}
 
 	/**
 	 *	
 	 */
-	FORCEINLINE ManagedT* GetRaw()
+	FORCEINLINE ManagedT* GetRaw() const
 	{
-		return m_Ref->Object;
+		return m_Object;
 	}
 
 	/**
@@ -213,18 +460,50 @@ public:
 	 */
  	Notifier* GetDestructionEvent()
 	{
-		return &m_Ref->OnDestruction;
+		CGF_ASSERT(Valid(), "Cannot dereference nullptr");
+
+		return m_Block->GetDestructionEvent();
+	}
+
+	void Swap(SharedPtr& other) noexcept
+	{
+		std::swap(m_Object, other.m_Object);
+		std::swap(m_Block, other.m_Block);
 	}
 
 	/**
 	 * @brief Constructs a shared pointer, passing the provided arguments
-	 * to the constructor of the value type.
+	 * to the constructor of the value type. The object and its control
+	 * block are made with a single allocation.
 	 */
 	template<typename... ConstructorArgT>
 	static SharedPtr<ManagedT> Create(ConstructorArgT&&... args)
 	{
-		ManagedT* ref = new ManagedT(args...);
-		return SharedPtr<ManagedT>(ref);
+		SharedPtr<ManagedT> result;
+
+		if constexpr(std::is_base_of_v<RefCounted, ManagedT>)
+		{
+			ManagedT* object = new ManagedT(std::forward<ConstructorArgT>(args)...);
+			result.Adopt(object, object->GetControlBlock());
+		}
+		else
+		{
+			auto* block = new SharedObjectBlock<ManagedT>();
+
+			try
+			{
+				new (block->Storage) ManagedT(std::forward<ConstructorArgT>(args)...);
+			}
+			catch(...)
+			{
+				delete block;
+				throw;
+			}
+
+			result.Adopt(block->GetObject(), block);
+		}
+
+		return result;
 	}
 
 #if ENABLE_SMART_PTR_TRACING
@@ -234,8 +513,8 @@ public:
 	template<typename... ConstructorArgT>
 	static SharedPtr<ManagedT> CreateTraced(std::string&& name, ConstructorArgT&&... args)
 	{
-		ManagedT* ref = new ManagedT(args...);
-		SharedPtr<ManagedT> managedRef = SharedPtr<ManagedT>(ref, name);
+		SharedPtr<ManagedT> managedRef = Create(std::forward<ConstructorArgT>(args)...);
+		managedRef.m_Block->Name = name;
 
 		return managedRef;
 	}
@@ -246,7 +525,7 @@ public:
 	template <typename... ConstructorArgT>
 	static SharedPtr<ManagedT> CreateTraced(std::string &&name, ConstructorArgT &&...args)
 	{
-		return Create(args...);
+		return Create(std::forward<ConstructorArgT>(args)...);
 	}
 #endif
 
@@ -254,8 +533,8 @@ public:
 	 * <!--
 	 * Although ugly, SFINAE is applied here to allow arrow operator chaining when ManagedT
 	 * implements the arrow operator, which makes cases where ManagedT is another nonprimitive 
-	 * reference type a lot less ugly. For example, members of Pool<T> objects would otherwise
-	 * have to be referenced like 'PooledPtr<T>()->Get().SomeMember'.
+	 * reference type a lot less ugly. For example, members of the element a SharedPtr<PooledPtr<T>>
+	 * owns would otherwise have to be referenced like 'pointer->Get().SomeMember'.
 	 * -->
 	 */
 	template<typename _ManagedT = ManagedT>
@@ -263,7 +542,7 @@ public:
 	{
 		CGF_ASSERT(Valid(), "Cannot dereference nullptr");
 		
-		return m_Ref->Object;
+		return m_Object;
 	}
 
 	template<typename _ManagedT = ManagedT>
@@ -271,7 +550,18 @@ public:
 	{
 		CGF_ASSERT(Valid(), "Cannot dereference nullptr");
 		
-		return *(m_Ref->Object);
+		return *m_Object;
+	}
+
+	template<typename OtherT>
+	FORCEINLINE bool operator==(const SharedPtr<OtherT>& other) const
+	{
+		return m_Object == other.m_Object;
+	}
+
+	FORCEINLINE bool operator==(std::nullptr_t other) const
+	{
+		return !m_Object;
 	}
 
 protected:
@@ -281,10 +571,11 @@ protected:
 	 */
 	void Detach()
 	{
-		if(m_Ref)
+		if(m_Block)
 		{
-			m_Ref->DecrementRefCnt();
-			m_Ref = nullptr;
+			m_Block->DecrementRefCnt();
+			m_Object = nullptr;
+			m_Block = nullptr;
 		}
 	}
 
@@ -292,150 +583,527 @@ protected:
 	 * Attach to a new shared object, detaching from the current one
 	 * if it exists, and increasing its reference count.
 	 */
-	void Attach(SharedObjectHandle<ManagedT>* handle)
+	void Attach(ManagedT* object, SharedControlBlock* block)
 	{
-		if(m_Ref) 
+		if(block)
 		{
-			Detach();
+			block->IncrementRefCnt();
 		}
 
-		m_Ref = handle;
+		Detach();
 
-		if(handle)
-		{
-			m_Ref->IncrementRefCnt();
-		}
+		m_Object = object;
+		m_Block = block;
+	}
+
+	/**
+	 * @brief Takes the first reference to a newly made object, which nothing else can see yet, so its
+	 * count is set rather than incremented
+	 */
+	void Adopt(ManagedT* object, SharedControlBlock* block)
+	{
+		block->Adopt();
+
+		m_Object = object;
+		m_Block = block;
 	}
 
 private:
-	SharedObjectHandle<ManagedT>* m_Ref = nullptr;
+	template<typename OtherT>
+	friend class SharedPtr;
+
+	template<typename OtherT>
+	friend class WeakPtr;
+
+	ManagedT* m_Object = nullptr;
+	SharedControlBlock* m_Block = nullptr;
 };
 
+
+/**
+ * @brief Converts a pointer to a base type into a pointer to a type derived from it, or vice versa,
+ * sharing its count. The object must actually be of the target type, which is asserted for
+ * polymorphic types.
+ */
+template<typename TargetT, typename SourceT>
+SharedPtr<TargetT> StaticCast(const SharedPtr<SourceT>& pointer)
+{
+	TargetT* object = static_cast<TargetT*>(pointer.GetRaw());
+
+	if constexpr(std::is_polymorphic_v<SourceT>)
+	{
+		CGF_ASSERT(!pointer || dynamic_cast<TargetT*>(pointer.GetRaw()) == object, "StaticCast to a type the object isn't");
+	}
+
+	return SharedPtr<TargetT>(pointer, object);
+}
+
+
+/**
+ * @brief see StaticCast(const SharedPtr<SourceT>&); hands over pointer's reference rather than gaining another
+ */
+template<typename TargetT, typename SourceT>
+SharedPtr<TargetT> StaticCast(SharedPtr<SourceT>&& pointer)
+{
+	TargetT* object = static_cast<TargetT*>(pointer.GetRaw());
+
+	if constexpr(std::is_polymorphic_v<SourceT>)
+	{
+		CGF_ASSERT(!pointer || dynamic_cast<TargetT*>(pointer.GetRaw()) == object, "StaticCast to a type the object isn't");
+	}
+
+	return SharedPtr<TargetT>(std::move(pointer), object);
+}
+
+
+/**
+ * @brief Converts a pointer to any type in the object's hierarchy, sharing its count
+ * @return The converted pointer, or nullptr if the object isn't of the target type
+ */
+template<typename TargetT, typename SourceT>
+SharedPtr<TargetT> DynamicCast(const SharedPtr<SourceT>& pointer)
+{
+	if(TargetT* object = dynamic_cast<TargetT*>(pointer.GetRaw()))
+	{
+		return SharedPtr<TargetT>(pointer, object);
+	}
+
+	return nullptr;
+}
+
+
 /**
- * @brief Constructs a dynamically sized, contiguous array of T. Objects within the array are
- * accessed through a PooledPtr<T>, and their existence with the array is tied to the lifespan
- * of their corresponding PooledPtr.
+ * @brief A non-owning reference to an object managed by SharedPtr, which doesn't keep it alive but can
+ * tell whether it still is. Lock() gains a SharedPtr to the object if it hasn't been destroyed yet.
+ * 
+ * The object's control block outlives it until its last weak pointer is released, so types deriving
+ * RefCounted, whose count is part of themselves, can't be weakly referenced.
  * 
- * The PooledPtr type is a shorthand alias for the type SharedPtr<typename Pool<T>::PoolObject>.
- * The PoolObject type references its object in its pool array by index instead of pointer, as pointers to
- * pool array members would be invalidated upon resizing / reallocation. As expected, it also removes its
- * referenced object upon destruction.
+ * @tparam ManagedT
  */
-template<typename T>
-class Pool
+template<typename ManagedT>
+class WeakPtr
 {
+	static_assert(!std::is_base_of_v<RefCounted, ManagedT>,
+		"Types deriving RefCounted can't be weakly referenced");
+
 public:
-	struct PoolObject
+	WeakPtr()
 	{
-		PoolObject()
-			: Valid(false), Owner(nullptr), Index(-1)
+
+	}
+
+	WeakPtr(std::nullptr_t ptr)
+	{
+
+	}
+
+	template<typename OtherT, typename = std::enable_if_t<std::is_convertible_v<OtherT*, ManagedT*>>>
+	WeakPtr(const SharedPtr<OtherT>& pointer)
+		: m_Object(pointer.m_Object), m_Block(pointer.m_Block)
+	{
+		if(m_Block)
 		{
+			CGF_ASSERT(m_Block->Free, "Objects whose count is part of themselves can't be weakly referenced");
 
+			m_Block->IncrementWeakCnt();
 		}
+	}
 
-		PoolObject(Pool* owner, int index)
-			: Owner(owner), Index(index)
+	WeakPtr(const WeakPtr& other)
+		: m_Object(other.m_Object), m_Block(other.m_Block)
+	{
+		if(m_Block)
 		{
-			
+			m_Block->IncrementWeakCnt();
 		}
-		
-		~PoolObject()
-		{
-			if(Valid)
-			{
-				Owner->Remove(Index);
+	}
 
-				Valid = false;
-			}
-		}
+	WeakPtr(WeakPtr&& other) noexcept
+		: m_Object(std::exchange(other.m_Object, nullptr)), m_Block(std::exchange(other.m_Block, nullptr))
+	{
+
+	}
 
-		T* operator->() const
+	~WeakPtr()
+	{
+		Reset();
+	}
+
+	WeakPtr& operator=(const WeakPtr& other)
+	{
+		WeakPtr(other).Swap(*this);
+
+		return *this;
+	}
+
+	WeakPtr& operator=(WeakPtr&& other) noexcept
+	{
+		WeakPtr(std::move(other)).Swap(*this);
+
+		return *this;
+	}
+
+	WeakPtr& operator=(std::nullptr_t other)
+	{
+		Reset();
+
+		return *this;
+	}
+
+	/**
+	 * @return A pointer keeping the object alive, or nullptr if it has already been destroyed
+	 */
+	SharedPtr<ManagedT> Lock() const
+	{
+		SharedPtr<ManagedT> result;
+
+		if(m_Block && m_Block->TryIncrementRefCnt())
 		{
-			return &(Owner->At(Index));
+			result.m_Object = m_Object;
+			result.m_Block = m_Block;
 		}
 
-		T& Get()
+		return result;
+	}
+
+	/**
+	 * @return Whether the object has been destroyed, or this was never given one. An object that hasn't
+	 * expired may still be destroyed before it's locked, so only Lock() can tell it's safe to use.
+	 */
+	FORCEINLINE bool Expired() const
+	{
+		return GetRefCount() == 0;
+	}
+
+	/**
+	 * @return The number of shared pointers referencing the object
+	 */
+	FORCEINLINE int GetRefCount() const
+	{
+		return m_Block ? m_Block->GetRefCount() : 0;
+	}
+
+	void Reset()
+	{
+		if(m_Block)
 		{
-			return Owner->At(Index);
+			m_Block->DecrementWeakCnt();
+			m_Object = nullptr;
+			m_Block = nullptr;
 		}
+	}
 
-		bool Valid = true;
-		Pool* Owner;
-		int Index;
-	};
+	void Swap(WeakPtr& other) noexcept
+	{
+		std::swap(m_Object, other.m_Object);
+		std::swap(m_Block, other.m_Block);
+	}
+
+private:
+	ManagedT* m_Object = nullptr;
+	SharedControlBlock* m_Block = nullptr;
+};
+
+
+/**
+ * @brief Identifies an element of a Pool. A handle keeps finding its element as others are added and
+ * removed, and once its element is removed, it's never mistaken for the element reusing its slot.
+ */
+struct PoolHandle
+{
+	uint32_t Index = UINT32_MAX;
+	uint32_t Generation = 0;
+
+	FORCEINLINE bool IsNull() const
+	{
+		return Index == UINT32_MAX;
+	}
+
+	bool operator==(const PoolHandle& other) const = default;
+};
+
+
+template<typename T>
+class Pool;
 
-	Pool() = default;
 
-	T& operator[](int index)
+/**
+ * @brief Owns an element of a Pool, removing it once the PooledPtr is destroyed or reassigned. As each
+ * element has a single owner, PooledPtrs can only be moved. The pool must outlive them.
+ */
+template<typename T>
+class PooledPtr
+{
+public:
+	PooledPtr()
 	{
-		return At(index);
+
 	}
 
-	T& At(int index)
+	PooledPtr(std::nullptr_t ptr)
 	{
-		return m_Data[index];
+
 	}
 
-	FORCEINLINE int GetCount() const
+	PooledPtr(Pool<T>& owner, PoolHandle handle)
+		: m_Owner(&owner), m_Handle(handle)
 	{
-		return m_Count;
+
 	}
 
-	void Remove(int index)
+	PooledPtr(const PooledPtr& other) = delete;
+
+	PooledPtr(PooledPtr&& other) noexcept
+		: m_Owner(std::exchange(other.m_Owner, nullptr)), m_Handle(std::exchange(other.m_Handle, PoolHandle()))
 	{
-		std::swap(m_Data[index], m_Data[m_Count - 1]);
-		std::swap(m_PoolObjects[index], m_PoolObjects[m_Count - 1]);
-		
-		m_PoolObjects[index]->Index = index;
 
-		m_Count--;
 	}
 
+	~PooledPtr()
+	{
+		Reset();
+	}
+
+	PooledPtr& operator=(const PooledPtr& other) = delete;
+
+	PooledPtr& operator=(PooledPtr&& other) noexcept
+	{
+		PooledPtr(std::move(other)).Swap(*this);
+
+		return *this;
+	}
+
+	PooledPtr& operator=(std::nullptr_t other)
+	{
+		Reset();
+
+		return *this;
+	}
+
+	T* operator->() const
+	{
+		return &Get();
+	}
+
+	T& operator*() const
+	{
+		return Get();
+	}
+
+	T& Get() const
+	{
+		CGF_ASSERT(Valid(), "Cannot dereference nullptr");
+
+		return m_Owner->Get(m_Handle);
+	}
+
+	/**
+	 * @brief see Valid()
+	 */
+	explicit operator bool() const
+	{
+		return Valid();
+	}
+
+	FORCEINLINE bool Valid() const
+	{
+		return m_Owner;
+	}
+
+	FORCEINLINE PoolHandle GetHandle() const
+	{
+		return m_Handle;
+	}
+
+	/**
+	 * @brief Removes the element from its pool, leaving this null
+	 */
+	void Reset()
+	{
+		if(m_Owner)
+		{
+			m_Owner->Remove(m_Handle);
+
+			m_Owner = nullptr;
+			m_Handle = PoolHandle();
+		}
+	}
+
+	void Swap(PooledPtr& other) noexcept
+	{
+		std::swap(m_Owner, other.m_Owner);
+		std::swap(m_Handle, other.m_Handle);
+	}
+
+private:
+	Pool<T>* m_Owner = nullptr;
+	PoolHandle m_Handle;
+};
+
+
+/**
+ * @brief A dense, generational slot map. Elements are kept contiguous, in no particular order, so they
+ * can be iterated as quickly as an array, and are reached from a PoolHandle through a table of slots.
+ * Each slot records where its element currently is, and a generation bumped as the element is removed,
+ * which tells stale handles apart from the slot's next element.
+ * 
+ * Inserting, removing and finding an element are constant time, and no element is allocated on its own.
+ * Removing an element moves the last into its place, and the pool grows by moving every element, so
+ * pointers and references to elements don't survive either; hold a handle or a PooledPtr instead.
+ */
+template<typename T>
+class Pool
+{
+public:
+	Pool() = default;
+
+	/**
+	 * @brief PooledPtrs refer to their pool by address, so pools are neither copied nor moved
+	 */
+	Pool(const Pool& other) = delete;
+
+	Pool& operator=(const Pool& other) = delete;
+
+	/**
+	 * @brief Constructs an element, passing the provided arguments to its constructor
+	 */
+	template<typename... ConstructorArgT>
+	PoolHandle Insert(ConstructorArgT&&... args)
+	{
+		m_Data.emplace_back(std::forward<ConstructorArgT>(args)...);
+
+		PoolHandle handle;
+
+		if(m_FreeSlots.empty())
+		{
+			handle.Index = m_Slots.size();
+			m_Slots.emplace_back();
+		}
+		else
+		{
+			handle.Index = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+
+		Slot& slot = m_Slots[handle.Index];
+		slot.Dense = m_Data.size() - 1;
+		handle.Generation = slot.Generation;
+
+		m_DenseSlots.push_back(handle.Index);
+
+		return handle;
+	}
+
+	/**
+	 * @brief Constructs an element owned by the returned PooledPtr
+	 */
 	template<typename... ConstructorArgT>
-	SharedPtr<PoolObject> Create(ConstructorArgT&&... args)
+	[[nodiscard]] PooledPtr<T> Create(ConstructorArgT&&... args)
+	{
+		return PooledPtr<T>(*this, Insert(std::forward<ConstructorArgT>(args)...));
+	}
+
+	/**
+	 * @brief Destroys an element, moving the last element into its place
+	 */
+	void Remove(PoolHandle handle)
 	{
-		if(m_Count >= m_Capacity)
+		CGF_ASSERT(Contains(handle), "Cannot remove an element which isn't in the pool");
+
+		Slot& slot = m_Slots[handle.Index];
+		const uint32_t last = m_Data.size() - 1;
+
+		if(slot.Dense != last)
 		{
-			Resize(m_Capacity * 2);
+			m_Data[slot.Dense] = std::move(m_Data[last]);
+			m_DenseSlots[slot.Dense] = m_DenseSlots[last];
+			m_Slots[m_DenseSlots[slot.Dense]].Dense = slot.Dense;
 		}
 
-		int itemIndex = m_Count;
-		PoolObject* handle = new PoolObject(this, itemIndex);
-		m_Data[itemIndex] = T(args...);
-		m_PoolObjects[itemIndex] = handle;
+		m_Data.pop_back();
+		m_DenseSlots.pop_back();
+
+		slot.Generation++;
+		m_FreeSlots.push_back(handle.Index);
+	}
+
+	FORCEINLINE bool Contains(PoolHandle handle) const
+	{
+		return handle.Index < m_Slots.size() && m_Slots[handle.Index].Generation == handle.Generation;
+	}
+
+	/**
+	 * @return The element, or nullptr if it has been removed
+	 */
+	FORCEINLINE T* Find(PoolHandle handle)
+	{
+		return Contains(handle) ? &m_Data[m_Slots[handle.Index].Dense] : nullptr;
+	}
 
-		m_Count++;
+	FORCEINLINE T& Get(PoolHandle handle)
+	{
+		CGF_ASSERT(Contains(handle), "Cannot get an element which isn't in the pool");
 
-		return SharedPtr<PoolObject>(handle);
+		return m_Data[m_Slots[handle.Index].Dense];
 	}
 
-	void Resize(int newCapacity)
+	/**
+	 * @return The element at a position in the pool's contiguous storage, from 0 to GetCount() - 1
+	 */
+	FORCEINLINE T& operator[](size_t index)
 	{
-		T* newData = new T[newCapacity];
+		return m_Data[index];
+	}
 
-		std::memcpy(newData, m_Data, sizeof(T) * m_Capacity);
+	/**
+	 * @return The handle to the element at a position in the pool's contiguous storage
+	 */
+	FORCEINLINE PoolHandle GetHandle(size_t index) const
+	{
+		const uint32_t slot = m_DenseSlots[index];
 
-		m_Data = newData;
-		m_Capacity = newCapacity;
+		return { slot, m_Slots[slot].Generation };
 	}
 
-	T* begin()
+	FORCEINLINE size_t GetCount() const
 	{
-		return m_Data;
+		return m_Data.size();
 	}
 
-	T* end()
+	void Reserve(size_t capacity)
 	{
-		return m_Data + m_Count;
+		m_Data.reserve(capacity);
+		m_DenseSlots.reserve(capacity);
+		m_Slots.reserve(capacity);
+	}
+
+	typename std::vector<T>::iterator begin()
+	{
+		return m_Data.begin();
+	}
+
+	typename std::vector<T>::iterator end()
+	{
+		return m_Data.end();
 	}
 
 private:
-	int m_Capacity = 1;
-	int m_Count = 0;
-	T* m_Data = new T;
-	PoolObject** m_PoolObjects = new PoolObject*;
-};
+	struct Slot
+	{
+		/**
+		 * @brief The element's position in m_Data, while the slot is in use
+		 */
+		uint32_t Dense = 0;
+		uint32_t Generation = 0;
+	};
 
+	std::vector<T> m_Data;
 
-template<typename T>
-using PooledPtr = SharedPtr<typename Pool<T>::PoolObject>;
\ No newline at end of file
+	/**
+	 * @brief The slot of each element in m_Data, so the slot of an element moved can be updated
+	 */
+	std::vector<uint32_t> m_DenseSlots;
+	std::vector<Slot> m_Slots;
+	std::vector<uint32_t> m_FreeSlots;
+};
@@ -1,42 +1,18 @@
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
 
 #include "core/Memory.h"
 #include "core/Events.h"
 #include "core/Actor.h"
 #include "core/Component.h"
 #include "core/Camera.h"
-
-
-struct SceneTypeInfo
-{
-	static int TypeCount;
-
-	static int NextTypeIndex()
-	{
-		static int value = 0;
-		return value++;
-	}
-
-	template<typename T>
-	static int GetTypeIndex()
-	{
-		static int i = (TypeCount++, NextTypeIndex());
-
-		return i;
-	}
-
-	template<typename... T>
-	static int GetTypeHash()
-	{
-		int out = 0;
-		
-		((out |= 1 << GetTypeIndex<T>()), ...);
-
-		return out;
-	}
-};
+#include "core/ECS.h"
+#include "core/Systems.h"
+#include "core/Allocators.h"
 
 
 class Scene
@@ -44,6 +20,11 @@ class Scene
 public:
 	Scene();
 
+	/**
+	 * @brief Detaches every actor, as actors referenced elsewhere may outlive the scene
+	 */
+	~Scene();
+
 	void Start();
 
 	void Tick(double dT);
@@ -54,6 +35,8 @@ public:
 		static_assert(std::is_base_of_v<Actor, ActorT>,
 			"ActorT must publicly derive Actor");
 
+		MemoryTagScope memoryTag (MemoryTag::Scene);
+
 		if(m_InPlay)
 		{
 			actor->Start();
@@ -62,6 +45,7 @@ public:
 		actor->AttachTo(this);
 		
 		GetActorsOfType<ActorT>().push_back(actor);
+		m_AttachedActors.push_back(actor.GetRaw());
 	}
 
 	template<typename ActorT>
@@ -72,21 +56,27 @@ public:
 
 		actor->AttachTo(nullptr);
 		
-		std::vector<SharedPtr<ActorT>> actors = GetActorsOfType<ActorT>();
+		std::vector<SharedPtr<ActorT>>& actors = GetActorsOfType<ActorT>();
 		auto iterator = std::find(actors.begin(), actors.end(), actor);
 
 		CGF_ASSERT(iterator != actors.end(),
 			"An actor may only be removed from a scene it has been added to.");
 
 		actors.erase(iterator);
+		m_AttachedActors.erase(std::find(m_AttachedActors.begin(), m_AttachedActors.end(), actor.GetRaw()));
 	}
 	
 	template<typename ActorT>
 	std::vector<SharedPtr<ActorT>>& GetActorsOfType()
 	{
-		static std::vector<SharedPtr<ActorT>> actors;
+		std::shared_ptr<void>& actors = m_Actors[typeid(ActorT)];
 
-		return actors;
+		if(!actors)
+		{
+			actors = std::make_shared<std::vector<SharedPtr<ActorT>>>();
+		}
+
+		return *static_cast<std::vector<SharedPtr<ActorT>>*>(actors.get());
 	}
 	
 	template<typename ActorT>
@@ -97,9 +87,18 @@ public:
 
 	Event<> OnStartActors;
 	Event<double> OnTickActors;
+	EntityRegistry Entities;
+	SystemScheduler Systems;
 	Pool<PrimitiveRenderState> PrimitiveRenderStates;
 	SharedPtr<Camera> CurrentCamera;
 
 private:
 	bool m_InPlay = false;
+	std::vector<Actor*> m_AttachedActors;
+
+	/**
+	 * @brief The actors of each type in the scene. Declared last, so actors are released while the
+	 * events and pools their components refer to still exist.
+	 */
+	std::unordered_map<std::type_index, std::shared_ptr<void>> m_Actors;
 };
\ No newline at end of file
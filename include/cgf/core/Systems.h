@@ -0,0 +1,200 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "core/Common.h"
+#include "core/ECS.h"
+#include "core/Jobs.h"
+
+
+/**
+ * @brief The component types a system reads and writes. Two systems conflict, and so never run at the
+ * same time, if either writes a type the other reads or writes.
+ */
+struct SystemAccess
+{
+	template<typename... ComponentT>
+	SystemAccess& Read()
+	{
+		Reads |= ComponentTypes::GetSignature<ComponentT...>();
+
+		return *this;
+	}
+
+	template<typename... ComponentT>
+	SystemAccess& Write()
+	{
+		Writes |= ComponentTypes::GetSignature<ComponentT...>();
+
+		return *this;
+	}
+
+	/**
+	 * @brief Marks the system as touching state outside the registry, e.g. actors or the renderer, so
+	 * that it runs alone
+	 */
+	SystemAccess& SetExclusive()
+	{
+		Exclusive = true;
+
+		return *this;
+	}
+
+	/**
+	 * @brief Whether a system may iterate ComponentT; const types need only be read
+	 */
+	template<typename... ComponentT>
+	bool Allows() const
+	{
+		return ((std::is_const_v<ComponentT> ? Reads | Writes : Writes)
+			.test(ComponentTypes::Get<std::remove_const_t<ComponentT>>().Index) && ...);
+	}
+
+	bool ConflictsWith(const SystemAccess& other) const
+	{
+		return Exclusive || other.Exclusive
+			|| (Writes & (other.Reads | other.Writes)).any()
+			|| (other.Writes & Reads).any();
+	}
+
+	ComponentSignature Reads;
+	ComponentSignature Writes;
+	bool Exclusive = false;
+};
+
+
+/**
+ * @brief What a system is given to update with. Structural changes, i.e. creating or destroying entities
+ * and adding or removing components, can't be made while systems run, so they're deferred until every
+ * system has finished.
+ */
+class SystemContext
+{
+public:
+	SystemContext(EntityRegistry& entities, JobSystem& jobs, const SystemAccess& access, double deltaTime)
+		: Entities(entities), Jobs(jobs), DeltaTime(deltaTime), m_Access(access)
+	{ }
+
+	/**
+	 * @brief Calls fn for every entity with ComponentT..., spreading the entities' chunks across the job system
+	 */
+	template<typename... ComponentT, typename FuncT>
+	void ForEach(FuncT&& fn)
+	{
+		CGF_ASSERT(m_Access.Allows<ComponentT...>(), "A system may only iterate the components it declared");
+
+		Entities.ParallelForEach<ComponentT...>(Jobs, std::forward<FuncT>(fn));
+	}
+
+	/**
+	 * @brief Calls fn(count, entities, columns...) for every chunk of entities with ComponentT..., spread
+	 * across the job system
+	 */
+	template<typename... ComponentT, typename FuncT>
+	void ForEachChunk(FuncT&& fn)
+	{
+		CGF_ASSERT(m_Access.Allows<ComponentT...>(), "A system may only iterate the components it declared");
+
+		Entities.ParallelForEachChunk<ComponentT...>(Jobs, std::forward<FuncT>(fn));
+	}
+
+	/**
+	 * @brief Queues a structural change to make once every system has run; safe to call from any thread
+	 */
+	void Defer(std::function<void(EntityRegistry&)> command);
+
+	EntityRegistry& Entities;
+	JobSystem& Jobs;
+	double DeltaTime;
+
+private:
+	friend class SystemScheduler;
+
+	const SystemAccess& m_Access;
+	std::mutex* m_CommandsMutex = nullptr;
+	std::vector<std::function<void(EntityRegistry&)>>* m_Commands = nullptr;
+};
+
+
+class System
+{
+public:
+	virtual ~System() = default;
+
+	/**
+	 * @brief Declares the component types the system reads and writes; called once, when it's added
+	 */
+	virtual void DeclareAccess(SystemAccess& access) = 0;
+
+	/**
+	 * @brief Called once a frame, possibly on a worker thread and alongside systems it doesn't conflict with
+	 */
+	virtual void Update(SystemContext& context) = 0;
+};
+
+
+/**
+ * @brief Runs a scene's systems each frame. Systems are ordered by when they were added: a system waits
+ * for every earlier system it conflicts with, and runs concurrently with the rest.
+ */
+class SystemScheduler
+{
+public:
+	SystemScheduler() = default;
+
+	SystemScheduler(const SystemScheduler& other) = delete;
+
+	SystemScheduler& operator=(const SystemScheduler& other) = delete;
+
+	template<typename SystemT, typename... ArgTypes>
+	SystemT& Add(ArgTypes&&... args)
+	{
+		static_assert(std::is_base_of_v<System, SystemT>,
+			"SystemT must publicly derive System");
+
+		auto system = std::make_unique<SystemT>(std::forward<ArgTypes>(args)...);
+		SystemT& result = *system;
+
+		AddSystem(std::move(system));
+
+		return result;
+	}
+
+	/**
+	 * @brief Runs every system once, then makes the structural changes they deferred
+	 */
+	void Run(EntityRegistry& entities, double deltaTime, JobSystem& jobs);
+
+	inline size_t GetCount() const
+	{
+		return m_Nodes.size();
+	}
+
+private:
+	struct SystemNode
+	{
+		std::unique_ptr<System> Instance;
+		SystemAccess Access;
+
+		/**
+		 * @brief The later systems that wait for this one
+		 */
+		std::vector<size_t> Dependents;
+		size_t DependencyCount = 0;
+
+		std::vector<std::function<void(EntityRegistry&)>> Commands;
+	};
+
+	void AddSystem(std::unique_ptr<System> system);
+
+	void BuildGraph();
+
+	std::vector<SystemNode> m_Nodes;
+	bool m_GraphDirty = false;
+
+	std::mutex m_CommandsMutex;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 
 #include "core/Common.h"
 #include "core/Memory.h"
@@ -12,6 +13,8 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include "cgfb/MeshFormat.h"
+
 
 enum class MaterialDomain : int
 {
@@ -40,7 +43,31 @@ public:
 	}
 
 	/**
-	 * @brief Modifies the vertex buffer layout associated with this Material
+	 * @return The material's current graphics pipeline for drawing meshes whose vertices are stored
+	 * in the given format
+	 */
+	FORCEINLINE const RefCntAutoPtr<IPipelineState>& GetPipelineState(const cgfb::VertexFormat& format)
+	{
+		if(format == cgfb::VertexFormat())
+		{
+			return GetPipelineState();
+		}
+
+		EnsurePipelineValidity();
+
+		RefCntAutoPtr<IPipelineState>& pipeline = m_FormatPipelineStates[GetVertexFormatKey(format)];
+
+		if(!pipeline)
+		{
+			pipeline = BuildPipeline(format);
+		}
+
+		return pipeline;
+	}
+
+	/**
+	 * @brief Modifies the vertex buffer layout associated with this Material, used for meshes whose
+	 * vertices are stored at full precision
 	 */
 	FORCEINLINE void SetVertexLayout(std::vector<LayoutElement>& layout)
 	{
@@ -70,12 +97,28 @@ public:
 	}
 
 protected:
-	RefCntAutoPtr<IPipelineState> BuildPipeline();
+	RefCntAutoPtr<IPipelineState> BuildPipeline(const cgfb::VertexFormat& format = {});
+
+	/**
+	 * @return The vertex buffer layout matching meshes whose vertices are stored in the given format
+	 */
+	std::vector<LayoutElement> GetVertexLayout(const cgfb::VertexFormat& format) const;
+
+	/**
+	 * @return The vertex shader compiled to decode vertices stored in the given format
+	 */
+	std::shared_ptr<Shader> GetVertexShader(const cgfb::VertexFormat& format);
+
+	FORCEINLINE static uint32_t GetVertexFormatKey(const cgfb::VertexFormat& format)
+	{
+		return (uint32_t)format.Position | (uint32_t)format.Normal << 8 | (uint32_t)format.UV0 << 16;
+	}
 
 	FORCEINLINE void EnsurePipelineValidity()
 	{
 		if(!m_PipelineValid)
 		{
+			m_FormatPipelineStates.clear();
 			m_PipelineState = BuildPipeline();
 			m_PipelineValid = true;
 		}
@@ -90,6 +133,7 @@ private:
 	MaterialDomain m_Domain;
 	std::vector<LayoutElement> m_VertexLayout;
 	RefCntAutoPtr<IPipelineState> m_PipelineState;
+	std::unordered_map<uint32_t, RefCntAutoPtr<IPipelineState>> m_FormatPipelineStates;
 	TEXTURE_FORMAT m_RenderTargetFormats[8];
 	int m_RenderTargetCount = 1;
 	TEXTURE_FORMAT m_DepthStencilFormat = TEX_FORMAT_D32_FLOAT;
@@ -99,6 +143,7 @@ private:
 	bool m_UseDepth = true;
 	std::shared_ptr<Shader> m_PixelShader = nullptr;	
 	std::shared_ptr<Shader> m_VertexShader = nullptr;	
+	std::shared_ptr<Shader> m_OctNormalVertexShader = nullptr;
 	bool m_PipelineValid = false;
 };
 
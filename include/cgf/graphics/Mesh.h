@@ -1,9 +1,71 @@
 #pragma once
 
+#include <vector>
+
+#include "glm/glm.hpp"
+
 #include "graphics/Diligent.h"
 
 #include "core/Common.h"
 
+#include "cgfb/MeshFormat.h"
+
+
+/**
+ * @brief A range of a mesh's index buffer, drawn with the material in its slot. Its indices are
+ * relative to BaseVertex.
+ */
+struct Submesh
+{
+	unsigned int FirstIndex = 0;
+	unsigned int IndexCount = 0;
+	unsigned int BaseVertex = 0;
+	unsigned int MaterialSlot = 0;
+};
+
+
+/**
+ * @brief A level of detail of a mesh, drawn once the mesh's bounding sphere is projected to less
+ * than ScreenSize of the screen's height
+ */
+struct MeshLod
+{
+	float ScreenSize = 1.0f;
+	std::vector<Submesh> Submeshes;
+};
+
+
+/**
+ * @brief Describes how a mesh's buffers are laid out and drawn
+ */
+struct MeshLayout
+{
+	/**
+	 * @brief The width of each index in the index buffer; either VT_UINT16 or VT_UINT32
+	 */
+	VALUE_TYPE IndexType = VT_UINT32;
+
+	cgfb::VertexFormat VertexFormat;
+
+	/**
+	 * @brief Maps positions as they're stored in the vertex buffer back into model space; only
+	 * anything other than identity for quantized positions
+	 */
+	glm::mat4 PositionTransform = glm::mat4(1.0f);
+
+	/**
+	 * @brief A bounding sphere around the mesh, in model space
+	 */
+	glm::vec3 BoundsCenter = glm::vec3(0.0f);
+	float BoundsRadius = 0.0f;
+
+	/**
+	 * @brief The mesh's levels of detail in decreasing detail, each with submeshes sharing the mesh's
+	 * buffers; empty if the whole index buffer is drawn at once
+	 */
+	std::vector<MeshLod> Lods;
+};
+
 
 class BaseMesh
 {
@@ -29,13 +91,81 @@ public:
 		return m_VertexBuffer;
 	}
 
+	FORCEINLINE VALUE_TYPE GetIndexType() const
+	{
+		return m_Layout.IndexType;
+	}
+
+	FORCEINLINE const cgfb::VertexFormat& GetVertexFormat() const
+	{
+		return m_Layout.VertexFormat;
+	}
+
+	FORCEINLINE const glm::mat4& GetPositionTransform() const
+	{
+		return m_Layout.PositionTransform;
+	}
+
+	FORCEINLINE const glm::vec3& GetBoundsCenter() const
+	{
+		return m_Layout.BoundsCenter;
+	}
+
+	FORCEINLINE float GetBoundsRadius() const
+	{
+		return m_Layout.BoundsRadius;
+	}
+
+	FORCEINLINE unsigned int GetLodCount() const
+	{
+		return m_Layout.Lods.size();
+	}
+
+	/**
+	 * @return The submeshes making up a level of detail; empty if the mesh has no submeshes, in which
+	 * case its whole index buffer is drawn at once
+	 */
+	FORCEINLINE const std::vector<Submesh>& GetSubmeshes(unsigned int lod = 0) const
+	{
+		static const std::vector<Submesh> wholeMesh;
+
+		return lod < m_Layout.Lods.size() ? m_Layout.Lods[lod].Submeshes : wholeMesh;
+	}
+
+	/**
+	 * @return The least detailed level of detail which may be drawn at the given projected size,
+	 * as a fraction of the screen's height
+	 */
+	FORCEINLINE unsigned int SelectLod(float screenSize) const
+	{
+		unsigned int lod = 0;
+
+		while(lod + 1 < m_Layout.Lods.size() && screenSize < m_Layout.Lods[lod + 1].ScreenSize)
+		{
+			lod++;
+		}
+
+		return lod;
+	}
+
 	FORCEINLINE bool IsValid() const
 	{
 		return m_IndexBuffer && m_VertexBuffer;
 	}
 
+	/**
+	 * @return The size of the mesh and its layout in system memory
+	 */
+	uint64_t GetCpuMemorySize() const;
+
+	/**
+	 * @return The size of the mesh's vertex and index buffers
+	 */
+	uint64_t GetGpuMemorySize() const;
+
 protected:
 	unsigned int m_IndexCount = 0;
+	MeshLayout m_Layout;
 	RefCntAutoPtr<IBuffer> m_IndexBuffer;
 	RefCntAutoPtr<IBuffer> m_VertexBuffer;
 };
@@ -45,6 +175,7 @@ class StaticMesh : public BaseMesh
 {
 public:
 	StaticMesh(unsigned int indexCount, 
+		MeshLayout layout,
 		RefCntAutoPtr<IBuffer> indexBuffer, 
 		RefCntAutoPtr<IBuffer> vertexBuffer);
 };
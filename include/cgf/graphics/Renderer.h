@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <queue>
@@ -27,6 +28,27 @@ struct PrimitiveRenderState
 	SharedPtr<BaseMesh> Mesh;
 	SharedPtr<MaterialInstance> DrawMaterial;
 	bool Translucent;
+
+	/**
+	 * @brief The mesh's level of detail drawn in the current frame
+	 */
+	unsigned int Lod = 0;
+
+	/**
+	 * @brief Whether the mesh is drawn in the current frame, i.e. its bounding sphere isn't outside the view
+	 */
+	bool Visible = true;
+
+	/**
+	 * @brief Picks the level of detail to draw from the size the mesh's bounding sphere is projected to
+	 */
+	void SelectLod(const glm::mat4& view, const glm::mat4& projection);
+
+	/**
+	 * @brief Tests the mesh's bounding sphere against the planes of the view frustum. Meshes without bounds,
+	 * such as dynamic meshes, are always visible.
+	 */
+	void UpdateVisibility(const std::array<glm::vec4, 6>& frustum);
 };
 
 
@@ -65,7 +87,7 @@ public:
 	
 	void Draw(Pool<PrimitiveRenderState>& meshDrawList);
 
-	void Draw(SharedPtr<Scene> scene);
+	void Draw(const SharedPtr<Scene>& scene);
 	
 	void Execute();
 };
\ No newline at end of file
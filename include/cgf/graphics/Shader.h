@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <vector>
 #include <unordered_map>
 #include "graphics/Diligent.h"
 
@@ -28,9 +30,17 @@ public:
 	{
 		return m_ShaderType;
 	}
+
+	/**
+	 * @brief Compiles this shader's source again with each of the given macros defined
+	 */
+	std::shared_ptr<Shader> CreateVariant(const std::vector<std::string>& defines) const;
 	
 private:
 	static std::unordered_map<SHADER_TYPE, const char*> m_ShaderEntryPoints;
+	std::string m_Name;
+	std::string m_Source;
+	SHADER_SOURCE_LANGUAGE m_SourceLanguage;
 	SHADER_TYPE m_ShaderType;
 	RefCntAutoPtr<IShader> m_Handle;
 };
\ No newline at end of file
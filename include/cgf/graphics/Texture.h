@@ -1,9 +1,14 @@
 #pragma once
 
+#include <span>
+#include <vector>
+
 #include "core/AssetLibrary.h"
 
 #include "graphics/Diligent.h"
 
+#include "cgfb/TextureFormat.h"
+
 #include "stb/stb_image.h"
 
 
@@ -17,6 +22,15 @@ public:
 		const void* data,
 		int dataStride);
 
+	/**
+	 * @brief Creates a texture from the data of each of its mip levels, largest first
+	 */
+	Texture2D(std::string name, 
+		unsigned int width, 
+		unsigned int height, 
+		TEXTURE_FORMAT format,
+		std::span<TextureSubResData> mips);
+
 	FORCEINLINE RefCntAutoPtr<ITexture> GetHandle()
 	{
 		return m_Handle;
@@ -32,40 +46,97 @@ public:
 		return m_Height;
 	}
 
+	/**
+	 * @return The size of the texture's data, across all of its mip levels
+	 */
+	FORCEINLINE uint64_t GetGpuMemorySize() const
+	{
+		return m_GpuMemorySize;
+	}
+
 private:
+	void CreateHandle(const std::string& name, 
+		unsigned int width, 
+		unsigned int height, 
+		TEXTURE_FORMAT format,
+		std::span<TextureSubResData> mips);
+
 	int m_Width;
 	int m_Height;
+	uint64_t m_GpuMemorySize = 0;
 	RefCntAutoPtr<ITexture> m_Handle;
 };
 
 
+/**
+ * @return The texture format which a cooked texture's data is uploaded as
+ */
+inline TEXTURE_FORMAT GetTextureFormat(cgfb::TextureEncoding encoding, bool srgb)
+{
+	switch(encoding)
+	{
+	case cgfb::TextureEncoding::BC1: return srgb ? TEX_FORMAT_BC1_UNORM_SRGB : TEX_FORMAT_BC1_UNORM;
+	case cgfb::TextureEncoding::BC3: return srgb ? TEX_FORMAT_BC3_UNORM_SRGB : TEX_FORMAT_BC3_UNORM;
+	case cgfb::TextureEncoding::BC5: return TEX_FORMAT_BC5_UNORM;
+	case cgfb::TextureEncoding::BC7: return srgb ? TEX_FORMAT_BC7_UNORM_SRGB : TEX_FORMAT_BC7_UNORM;
+	default: return srgb ? TEX_FORMAT_RGBA8_UNORM_SRGB : TEX_FORMAT_RGBA8_UNORM;
+	}
+}
+
+
 template<>
-inline SharedPtr<Texture2D> AssetLibrary::Load(std::string textureName)
+inline std::function<SharedPtr<Texture2D>()> AssetLibrary::Decode(std::string textureName)
 {
 	cgfb::CgfbBlock block;
-	m_AssetFile.ReadBlock(textureName.c_str(), block);
-
-	int x, y;
-	const int channels = 4;
-	std::string marker;
-	char* pixelData = nullptr;
-
-	cgfb::CgfbMemoryReader reader ( std::move(block) );
-	reader.Read(&marker);
-	reader.Read(&x);
-	reader.Read(&y);
-
-	constexpr int bytesPerChannel = sizeof(char);
-	const int pixelDataSize = x * y * channels * bytesPerChannel;
-	pixelData = new char[pixelDataSize];
-	reader.Read(pixelData, pixelDataSize);
-
-	Texture2D* newTexture = new Texture2D(textureName,
-		x,
-		y,
-		TEX_FORMAT_RGBA8_UNORM_SRGB,
-		pixelData,
-		channels * bytesPerChannel);
-
-	return SharedPtr<Texture2D>(newTexture);
-}
\ No newline at end of file
+	bool found = m_AssetFile.ReadBlock(textureName, block);
+	CGF_ASSERT(found, "No texture named " + textureName + " was found in the asset file");
+
+	// The block's data is uploaded in place, so the reader holding it outlives this step
+	auto blockReader = std::make_shared<cgfb::CgfbMemoryReader>(std::move(block));
+	cgfb::CgfbMemoryReader& reader = *blockReader;
+
+	cgfb::TextureHeader header;
+	cgfb::ReadTextureHeader(reader, &header);
+	CGF_ASSERT(header.Version == cgfb::TEXTURE_FORMAT_VERSION, "Texture " + textureName + " was cooked with an incompatible version of cgfb_compiler");
+
+	std::vector<cgfb::TextureMip> mips (header.MipCount);
+
+	for(cgfb::TextureMip& mip : mips)
+	{
+		cgfb::ReadTextureMip(reader, &mip);
+	}
+
+	// Every mip level is uploaded straight from the block, as it was cooked
+	std::vector<TextureSubResData> subresources (header.MipCount);
+
+	for(unsigned int i = 0; i < header.MipCount; i++)
+	{
+		std::span<const char> mipData;
+		reader.SetPosition(mips[i].DataOffset);
+		reader.ReadView(&mipData, mips[i].DataSize);
+
+		subresources[i].pData = mipData.data();
+		subresources[i].Stride = mips[i].RowPitch;
+	}
+
+	return [blockReader, textureName, header, subresources]() mutable
+	{
+		return SharedPtr<Texture2D>::Create(textureName,
+			header.Width,
+			header.Height,
+			GetTextureFormat(header.Encoding, header.SRGB),
+			subresources);
+	};
+}
+
+
+/**
+ * @brief Textures are stood in for by a single mid-grey texel until they're resident
+ */
+template<>
+inline SharedPtr<Texture2D> AssetLibrary::CreatePlaceholder()
+{
+	const uint8_t texel[4] = { 128, 128, 128, 255 };
+
+	return SharedPtr<Texture2D>::Create("Placeholder", 1, 1, TEX_FORMAT_RGBA8_UNORM_SRGB, texel, sizeof(texel));
+}
@@ -0,0 +1,269 @@
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/Memory.h"
+#include "core/Events.h"
+
+#include "utility/Timer.h"
+
+
+namespace
+{
+
+/**
+ * @brief The smart pointer SharedPtr replaced, kept as the benchmarks' baseline: a separately allocated
+ * handle per object, holding the count and an eagerly constructed destruction event, and no moves
+ */
+template<typename ManagedT>
+struct LegacyHandle
+{
+	LegacyHandle(ManagedT* object)
+		: Object(object)
+	{
+
+	}
+
+	~LegacyHandle()
+	{
+		OnDestruction.Invoke();
+
+		delete Object;
+	}
+
+	std::atomic<int> RefCount = 0;
+	Notifier OnDestruction;
+	ManagedT* Object;
+};
+
+
+template<typename ManagedT>
+class LegacySharedPtr
+{
+public:
+	LegacySharedPtr() = default;
+
+	LegacySharedPtr(const LegacySharedPtr& other)
+	{
+		Attach(other.m_Ref);
+	}
+
+	~LegacySharedPtr()
+	{
+		Detach();
+	}
+
+	LegacySharedPtr& operator=(const LegacySharedPtr& other)
+	{
+		Attach(other.m_Ref);
+
+		return *this;
+	}
+
+	ManagedT* operator->() const
+	{
+		return m_Ref->Object;
+	}
+
+	template<typename... ConstructorArgT>
+	static LegacySharedPtr Create(ConstructorArgT&&... args)
+	{
+		LegacySharedPtr result;
+		result.Attach(new LegacyHandle<ManagedT>(new ManagedT(args...)));
+
+		return result;
+	}
+
+private:
+	void Detach()
+	{
+		if(m_Ref && --m_Ref->RefCount <= 0)
+		{
+			delete m_Ref;
+		}
+
+		m_Ref = nullptr;
+	}
+
+	void Attach(LegacyHandle<ManagedT>* handle)
+	{
+		if(m_Ref)
+		{
+			Detach();
+		}
+
+		m_Ref = handle;
+
+		if(handle)
+		{
+			m_Ref->RefCount++;
+		}
+	}
+
+	LegacyHandle<ManagedT>* m_Ref = nullptr;
+};
+
+
+struct Payload
+{
+	int Value = 1;
+};
+
+
+struct IntrusivePayload : RefCounted
+{
+	int Value = 1;
+};
+
+
+/**
+ * @brief Adapts each pointer type to the handful of operations the benchmarks make
+ */
+template<typename PointerT>
+struct PointerTraits;
+
+template<typename T>
+struct PointerTraits<LegacySharedPtr<T>>
+{
+	static LegacySharedPtr<T> Make() { return LegacySharedPtr<T>::Create(); }
+};
+
+template<typename T>
+struct PointerTraits<SharedPtr<T>>
+{
+	static SharedPtr<T> Make() { return SharedPtr<T>::Create(); }
+};
+
+template<typename T>
+struct PointerTraits<std::shared_ptr<T>>
+{
+	static std::shared_ptr<T> Make() { return std::make_shared<T>(); }
+};
+
+
+// Kept out of line, so passing by value really copies, or moves, the pointer
+template<typename PointerT>
+[[gnu::noinline]] int ReadByValue(PointerT pointer)
+{
+	return pointer->Value;
+}
+
+
+constexpr size_t ITERATIONS = 2'000'000;
+constexpr unsigned int THREAD_COUNT = 4;
+
+std::atomic<int> s_Sink = 0;
+
+
+double ToNanoseconds(double seconds, size_t operations)
+{
+	return seconds * 1e9 / operations;
+}
+
+
+template<typename PointerT>
+void RunBenchmarks(const char* name)
+{
+	using Traits = PointerTraits<PointerT>;
+
+	int sink = 0;
+	Timer timer;
+
+	// Making and releasing objects, i.e. allocation and destruction
+	timer.Restart();
+
+	for(size_t i = 0; i < ITERATIONS; i++)
+	{
+		PointerT pointer = Traits::Make();
+		sink += pointer->Value;
+	}
+
+	const double create = ToNanoseconds(timer.GetElapsed(), ITERATIONS);
+
+	// Passing a pointer by value, which copies it and so touches the count twice
+	PointerT shared = Traits::Make();
+	timer.Restart();
+
+	for(size_t i = 0; i < ITERATIONS; i++)
+	{
+		sink += ReadByValue(shared);
+	}
+
+	const double copy = ToNanoseconds(timer.GetElapsed(), ITERATIONS);
+
+	// Handing a pointer over by value, which only moves it if the type can be moved
+	timer.Restart();
+
+	for(size_t i = 0; i < ITERATIONS; i++)
+	{
+		PointerT handedOver = shared;
+		sink += ReadByValue(std::move(handedOver));
+	}
+
+	const double move = ToNanoseconds(timer.GetElapsed(), ITERATIONS);
+
+	// Growing a vector of pointers, which relocates every element each time it reallocates
+	timer.Restart();
+
+	{
+		std::vector<PointerT> pointers;
+
+		for(size_t i = 0; i < ITERATIONS / 4; i++)
+		{
+			pointers.push_back(shared);
+		}
+	}
+
+	const double grow = ToNanoseconds(timer.GetElapsed(), ITERATIONS / 4);
+
+	// Copying and releasing the same pointer on several threads at once, contending for its count
+	timer.Restart();
+
+	{
+		std::vector<std::thread> threads;
+
+		for(unsigned int t = 0; t < THREAD_COUNT; t++)
+		{
+			threads.emplace_back([&shared]()
+			{
+				int threadSink = 0;
+
+				for(size_t i = 0; i < ITERATIONS / THREAD_COUNT; i++)
+				{
+					threadSink += ReadByValue(shared);
+				}
+
+				s_Sink += threadSink;
+			});
+		}
+
+		for(std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	const double contended = ToNanoseconds(timer.GetElapsed(), ITERATIONS);
+
+	s_Sink += sink;
+
+	std::printf("%-34s %10.1f %10.1f %10.1f %10.1f %12.1f\n", name, create, copy, move, grow, contended);
+}
+
+}
+
+
+int main()
+{
+	std::printf("Nanoseconds per operation, over %zu operations each\n\n", ITERATIONS);
+	std::printf("%-34s %10s %10s %10s %10s %12s\n", "", "create", "copy", "move", "grow", "contended");
+
+	RunBenchmarks<LegacySharedPtr<Payload>>("Previous SharedPtr");
+	RunBenchmarks<SharedPtr<Payload>>("SharedPtr");
+	RunBenchmarks<SharedPtr<IntrusivePayload>>("SharedPtr, intrusive");
+	RunBenchmarks<std::shared_ptr<Payload>>("std::shared_ptr (make_shared)");
+
+	return 0;
+}
@@ -18,9 +18,6 @@
 
 #include "utility/Timer.h"
 
-#include "assimp/Importer.hpp" 
-#include "assimp/scene.h"
-#include "assimp/postprocess.h"
 
 
 class MeshActor : public Actor
@@ -35,10 +32,6 @@ public:
 		prim->SetMaterial(material);
 
 		ball = prim->CreateSprite();
-		
-		texture = Game->GetAssetLibrary()->Get<Texture2D>("Atlas");
-		
-		material->GetFragmentShaderVariable("g_Texture")->Set(texture->GetHandle()->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 
 		ball->SetSize({ 640, 480 });
 	}
@@ -52,7 +45,6 @@ public:
 
 	float ballXVelocity = 1.0f;
 	float ballYVelocity = 0.0f;
-	SharedPtr<Texture2D> texture;
 	PooledPtr<SpriteState> ball;
 	SharedPtr<SpriteBatchComponent> prim;
 };
@@ -63,6 +55,8 @@ class DevScene : public Scene
 public:
 	DevScene()
 	{
+		Game->GetAssetLibrary()->Preload("DevScene");
+
 		SharedPtr<MeshActor> actor = SharedPtr<MeshActor>::Create();
 		AddActor(actor);
 
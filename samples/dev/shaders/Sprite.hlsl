@@ -24,12 +24,29 @@ Texture2D    g_Texture;
 SamplerState g_Texture_sampler;
 
 
+#ifdef CGF_NORMAL_OCT16
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+
+	return normalize(n);
+}
+#endif
+
+
 void ProcessVertex(
 	in float3 position : POSITION, 
 	in float3 normal : NORMAL,
 	in float2 uv : TEXCOORD,
 	out PSInput PSIn)
 {
+#ifdef CGF_NORMAL_OCT16
+	normal = DecodeOctahedral(normal.xy);
+#endif
+
 	float4 xpos = float4(position, 1.0);
 	PSIn.Pos = mul(ModelViewProjection, xpos);
 	PSIn.WorldPos = position;
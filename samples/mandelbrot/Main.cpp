@@ -18,9 +18,6 @@
 
 #include "utility/Timer.h"
 
-#include "assimp/Importer.hpp" 
-#include "assimp/scene.h"
-#include "assimp/postprocess.h"
 
 
 class MeshActor : public Actor
@@ -82,7 +79,7 @@ public:
 	float ballYVelocity = 0.0f;
 	SharedPtr<Texture2D> texture;
 	PooledPtr<SpriteState> ball;
-	SharedPtr<SpriteBatchComponent> prim;
+	SharedPtr<DynamicMeshComponent> prim;
 };
 
 
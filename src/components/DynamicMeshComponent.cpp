@@ -9,11 +9,11 @@ DynamicMeshComponent::DynamicMeshComponent()
 
 void DynamicMeshComponent::SetVertexData(void* vertexData, unsigned int vertexByteSize, unsigned int numVertices)
 {
-	((SharedPtr<DynamicMesh>)GetMesh())->SetVertexData(vertexData, vertexByteSize, numVertices);
+	StaticCast<DynamicMesh>(GetMesh())->SetVertexData(vertexData, vertexByteSize, numVertices);
 }
 
 
 void DynamicMeshComponent::SetIndexData(unsigned int* indices, unsigned int numIndices)
 {
-	((SharedPtr<DynamicMesh>)GetMesh())->SetIndexData(indices, numIndices);
+	StaticCast<DynamicMesh>(GetMesh())->SetIndexData(indices, numIndices);
 }
\ No newline at end of file
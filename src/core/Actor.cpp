@@ -1,10 +1,23 @@
 #include "core/Actor.h"
 #include "core/Scene.h"
+#include "core/Component.h"
 
 
 Actor::Actor()
 {
-	m_ComponentBitset = std::vector<bool>(SceneTypeInfo::TypeCount);
+
+}
+
+
+// Defined here, where ActorComponent is complete, as the actor's components are released with it
+Actor::~Actor()
+{
+	// Scenes detach their actors as they're destroyed, so the scene and its registry are still alive here
+	if(m_Scene)
+	{
+		m_Scene->Entities.Destroy(m_Entity);
+	}
+
 }
 
 
@@ -22,6 +35,12 @@ void Actor::Tick(double deltaTime)
 
 void Actor::AttachTo(Scene* scene)
 {
+	if(m_Scene)
+	{
+		m_Scene->Entities.Destroy(m_Entity);
+		m_Entity = Entity();
+	}
+
 	m_Scene = scene;
 	
 	if(scene == nullptr)
@@ -32,6 +51,8 @@ void Actor::AttachTo(Scene* scene)
 		return;
 	}
 
+	m_Entity = scene->Entities.Create();
+
 	OnSceneChanged.Invoke(scene);
 
 	m_StartListener = scene->OnStartActors.Connect(this, &Actor::Start);
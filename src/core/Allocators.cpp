@@ -0,0 +1,369 @@
+#include "core/Allocators.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+
+#if ENABLE_HEAP_ALLOCATION_COUNTING || ENABLE_MEMORY_TRACKING
+
+namespace
+{
+
+std::atomic<uint64_t> s_HeapAllocationCount = 0;
+
+#if ENABLE_MEMORY_TRACKING
+
+/**
+ * @brief Kept a cache line apart from other tags' counters, as every allocating thread updates them
+ */
+struct alignas(64) TagCounters
+{
+	std::atomic<uint64_t> LiveBytes = 0;
+	std::atomic<uint64_t> PeakBytes = 0;
+	std::atomic<uint64_t> LiveAllocations = 0;
+	std::atomic<uint64_t> TotalAllocations = 0;
+};
+
+TagCounters s_TagCounters[(size_t)MemoryTag::Count];
+
+thread_local MemoryTag t_MemoryTag = MemoryTag::Untagged;
+
+/**
+ * @brief Precedes each allocation, so it can be uncharged from its tag as it's freed. As large as
+ * malloc's alignment, so the memory after it stays as aligned as malloc's.
+ */
+struct alignas(std::max_align_t) AllocationHeader
+{
+	uint64_t Size;
+	MemoryTag Tag;
+};
+
+#endif
+
+void* AllocateCounted(std::size_t size)
+{
+	s_HeapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+#if ENABLE_MEMORY_TRACKING
+	if(size > SIZE_MAX - sizeof(AllocationHeader))
+	{
+		throw std::bad_alloc();
+	}
+
+	if(auto* header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + size)))
+	{
+		header->Size = size;
+		header->Tag = t_MemoryTag;
+
+		TagCounters& counters = s_TagCounters[(size_t)header->Tag];
+		const uint64_t live = counters.LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		uint64_t peak = counters.PeakBytes.load(std::memory_order_relaxed);
+
+		while(live > peak && !counters.PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+
+		}
+
+		counters.LiveAllocations.fetch_add(1, std::memory_order_relaxed);
+		counters.TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		return header + 1;
+	}
+#else
+	if(void* memory = std::malloc(size ? size : 1))
+	{
+		return memory;
+	}
+#endif
+
+	throw std::bad_alloc();
+}
+
+void FreeCounted(void* memory)
+{
+#if ENABLE_MEMORY_TRACKING
+	if(!memory)
+	{
+		return;
+	}
+
+	AllocationHeader* header = static_cast<AllocationHeader*>(memory) - 1;
+	TagCounters& counters = s_TagCounters[(size_t)header->Tag];
+
+	counters.LiveBytes.fetch_sub(header->Size, std::memory_order_relaxed);
+	counters.LiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+
+	std::free(header);
+#else
+	std::free(memory);
+#endif
+}
+
+}
+
+
+// The remaining forms of new and delete, besides over-aligned ones, are implemented in terms of these
+void* operator new(std::size_t size)
+{
+	return AllocateCounted(size);
+}
+
+
+void* operator new[](std::size_t size)
+{
+	return AllocateCounted(size);
+}
+
+
+void operator delete(void* memory) noexcept
+{
+	FreeCounted(memory);
+}
+
+
+void operator delete[](void* memory) noexcept
+{
+	FreeCounted(memory);
+}
+
+
+void operator delete(void* memory, std::size_t size) noexcept
+{
+	FreeCounted(memory);
+}
+
+
+void operator delete[](void* memory, std::size_t size) noexcept
+{
+	FreeCounted(memory);
+}
+
+
+uint64_t GetHeapAllocationCount()
+{
+	return s_HeapAllocationCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+uint64_t GetHeapAllocationCount()
+{
+	return 0;
+}
+
+#endif
+
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+	switch(tag)
+	{
+	case MemoryTag::Untagged:
+		return "Untagged";
+	case MemoryTag::Assets:
+		return "Assets";
+	case MemoryTag::Render:
+		return "Render";
+	case MemoryTag::Scene:
+		return "Scene";
+	case MemoryTag::Events:
+		return "Events";
+	default:
+		return "?";
+	}
+}
+
+
+#if ENABLE_MEMORY_TRACKING
+
+MemoryTagStats GetMemoryTagStats(MemoryTag tag)
+{
+	const TagCounters& counters = s_TagCounters[(size_t)tag];
+
+	MemoryTagStats stats;
+	stats.LiveBytes = counters.LiveBytes.load(std::memory_order_relaxed);
+	stats.PeakBytes = counters.PeakBytes.load(std::memory_order_relaxed);
+	stats.LiveAllocations = counters.LiveAllocations.load(std::memory_order_relaxed);
+	stats.TotalAllocations = counters.TotalAllocations.load(std::memory_order_relaxed);
+
+	return stats;
+}
+
+
+MemoryTag GetMemoryTag()
+{
+	return t_MemoryTag;
+}
+
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag)
+	: m_Previous(t_MemoryTag)
+{
+	t_MemoryTag = tag;
+}
+
+
+MemoryTagScope::~MemoryTagScope()
+{
+	t_MemoryTag = m_Previous;
+}
+
+
+bool ReportMemoryLeaks()
+{
+	bool leaked = false;
+
+	std::printf("Memory still allocated:\n");
+
+	for(size_t i = 0; i < (size_t)MemoryTag::Count; i++)
+	{
+		const MemoryTag tag = (MemoryTag)i;
+		const MemoryTagStats stats = GetMemoryTagStats(tag);
+
+		std::printf("  %-10s %12llu bytes in %8llu allocations (peak %llu bytes, %llu allocations in total)%s\n",
+			GetMemoryTagName(tag),
+			(unsigned long long)stats.LiveBytes,
+			(unsigned long long)stats.LiveAllocations,
+			(unsigned long long)stats.PeakBytes,
+			(unsigned long long)stats.TotalAllocations,
+			tag != MemoryTag::Untagged && stats.LiveAllocations ? "  <- leaked" : "");
+
+		leaked |= tag != MemoryTag::Untagged && stats.LiveAllocations;
+	}
+
+	return leaked;
+}
+
+#else
+
+MemoryTagStats GetMemoryTagStats(MemoryTag tag)
+{
+	return {};
+}
+
+
+bool ReportMemoryLeaks()
+{
+	return false;
+}
+
+#endif
+
+
+LinearAllocator::LinearAllocator(size_t blockSize)
+	: m_BlockSize(blockSize)
+{
+
+}
+
+
+void LinearAllocator::Reset()
+{
+	if(m_Blocks.size() > 1)
+	{
+		// Blocks belong to the allocator rather than whichever subsystem first filled it
+		MemoryTagScope untagged (MemoryTag::Untagged);
+		const size_t capacity = GetCapacity();
+
+		m_Blocks.clear();
+		m_Blocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[capacity]), capacity });
+	}
+
+	m_Current = 0;
+	m_Offset = 0;
+}
+
+
+size_t LinearAllocator::GetUsed() const
+{
+	size_t used = m_Offset;
+
+	for(size_t i = 0; i < m_Current && i < m_Blocks.size(); i++)
+	{
+		used += m_Blocks[i].Size;
+	}
+
+	return used;
+}
+
+
+size_t LinearAllocator::GetCapacity() const
+{
+	size_t capacity = 0;
+
+	for(const Block& block : m_Blocks)
+	{
+		capacity += block.Size;
+	}
+
+	return capacity;
+}
+
+
+void* LinearAllocator::AllocateFromNextBlock(size_t size, size_t alignment)
+{
+	// Blocks after the current one are left over from before the last rewind, and are reused first
+	while(m_Current + 1 < m_Blocks.size())
+	{
+		m_Current++;
+		m_Offset = 0;
+
+		const uintptr_t base = reinterpret_cast<uintptr_t>(m_Blocks[m_Current].Memory.get());
+		const uintptr_t address = (base + alignment - 1) & ~uintptr_t(alignment - 1);
+
+		if(address + size <= base + m_Blocks[m_Current].Size)
+		{
+			m_Offset = address + size - base;
+
+			return reinterpret_cast<void*>(address);
+		}
+	}
+
+	MemoryTagScope untagged (MemoryTag::Untagged);
+	const size_t blockSize = std::max(m_Blocks.empty() ? m_BlockSize : m_Blocks.back().Size * 2, size + alignment);
+
+	m_Blocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[blockSize]), blockSize });
+	m_Current = m_Blocks.size() - 1;
+	m_Offset = 0;
+
+	return Allocate(size, alignment);
+}
+
+
+FrameAllocator::FrameAllocator(size_t blockSize)
+	: m_Allocators{ LinearAllocator(blockSize), LinearAllocator(blockSize) }
+{
+
+}
+
+
+void FrameAllocator::BeginFrame()
+{
+	const uint64_t heapAllocations = GetHeapAllocationCount();
+
+	m_HeapAllocationsLastFrame = heapAllocations - m_HeapAllocationsAtFrameStart;
+	m_HeapAllocationsAtFrameStart = heapAllocations;
+
+	for(size_t i = 0; i < (size_t)MemoryTag::Count; i++)
+	{
+		const uint64_t tagAllocations = GetMemoryTagStats((MemoryTag)i).TotalAllocations;
+
+		m_TagAllocationsLastFrame[i] = tagAllocations - m_TagAllocationsAtFrameStart[i];
+		m_TagAllocationsAtFrameStart[i] = tagAllocations;
+	}
+
+	m_FrameIndex++;
+	GetCurrent().Reset();
+}
+
+
+LinearAllocator& GetThreadScratch()
+{
+	thread_local LinearAllocator scratch;
+
+	return scratch;
+}
@@ -0,0 +1,92 @@
+#include "core/AssetCache.h"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+
+void AssetCache::Trim()
+{
+	std::vector<std::unique_ptr<CachedAssetBase>> evicted;
+
+	{
+		std::unique_lock lock (m_Mutex);
+
+		if(!IsOverBudget())
+		{
+			return;
+		}
+
+		// Assets referenced only by the cache can't be referenced again without a lookup, which the lock
+		// excludes. Those referenced elsewhere sort after them, as evicting them frees nothing yet.
+		std::vector<std::tuple<bool, uint64_t, AssetId>> candidates;
+
+		for(auto entry = m_Entries.begin(); entry != m_Entries.end();)
+		{
+			if(!entry->second.Asset->IsRetained())
+			{
+				entry = entry->second.Asset->GetRefCount() == 0 ? m_Entries.erase(entry) : std::next(entry);
+				continue;
+			}
+
+			candidates.emplace_back(entry->second.Asset->GetRefCount() > 1, entry->second.LastUsed.load(std::memory_order_relaxed), entry->first);
+			entry++;
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		for(auto& [referenced, lastUsed, id] : candidates)
+		{
+			if(!IsOverBudget())
+			{
+				break;
+			}
+
+			auto entry = m_Entries.find(id);
+
+			m_Usage.CpuBytes -= entry->second.Usage.CpuBytes;
+			m_Usage.GpuBytes -= entry->second.Usage.GpuBytes;
+
+			evicted.push_back(std::move(entry->second.Asset));
+
+			if(referenced)
+			{
+				entry->second.Asset = evicted.back()->MakeWeak();
+			}
+			else
+			{
+				m_Entries.erase(entry);
+			}
+		}
+	}
+
+	// Evicted assets are destroyed once the lock is released, as their destructors may look up other assets
+	evicted.clear();
+}
+
+
+void AssetCache::SetBudget(AssetMemoryUsage budget)
+{
+	{
+		std::unique_lock lock (m_Mutex);
+		m_Budget = budget;
+	}
+
+	Trim();
+}
+
+
+AssetMemoryUsage AssetCache::GetUsage() const
+{
+	std::shared_lock lock (m_Mutex);
+
+	return m_Usage;
+}
+
+
+size_t AssetCache::GetCount() const
+{
+	std::shared_lock lock (m_Mutex);
+
+	return m_Entries.size();
+}
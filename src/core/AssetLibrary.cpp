@@ -1,8 +1,226 @@
 #include "core/AssetLibrary.h"
 
+#include <algorithm>
+#include <unordered_set>
 
-AssetLibrary::AssetLibrary(const char* projectFilePath)
-	: m_AssetFile(projectFilePath)
+#include "core/Allocators.h"
+
+#include "graphics/Texture.h"
+
+#include "utility/Timer.h"
+
+
+AssetLibrary::AssetLibrary(const char* projectFilePath, JobSystem& jobs, unsigned int maxConcurrentDecodes)
+	: m_AssetFile(projectFilePath, cgfb::CgfbReadMode::Mapped), m_Jobs(jobs), m_MaxConcurrentDecodes(std::max(maxConcurrentDecodes, 1u))
+{
+	MemoryTagScope memoryTag (MemoryTag::Assets);
+
+	ReadDependencies();
+}
+
+
+AssetLibrary::~AssetLibrary()
+{
+	{
+		std::lock_guard lock (m_QueueMutex);
+		m_Stopping = true;
+	}
+
+	// Jobs already queued find the library stopping and return without decoding anything
+	m_Jobs.Wait(m_DecodeJobs);
+}
+
+
+size_t AssetLibrary::Preload(std::string_view manifestName, int priority)
+{
+	cgfb::CgfbBlock block;
+	bool found = m_AssetFile.ReadBlock(manifestName, block) && block.Kind == cgfb::BlockKind::Manifest;
+	CGF_ASSERT(found, "No manifest named " + std::string(manifestName) + " was found in the asset file");
+
+	std::vector<std::string> assetNames;
+	cgfb::CgfbMemoryReader reader ( std::move(block) );
+
+	if(!found || !cgfb::ReadManifest(reader, &assetNames))
+	{
+		return 0;
+	}
+
+	return Preload(assetNames, priority);
+}
+
+
+size_t AssetLibrary::Preload(std::span<const std::string> assetNames, int priority)
 {
-	
-}
\ No newline at end of file
+	MemoryTagScope memoryTag (MemoryTag::Assets);
+
+	std::vector<const cgfb::DirectoryEntry*> entries;
+	std::unordered_set<std::string> visited;
+	std::vector<std::string> unvisited (assetNames.begin(), assetNames.end());
+
+	while(!unvisited.empty())
+	{
+		std::string name = std::move(unvisited.back());
+		unvisited.pop_back();
+
+		if(!visited.insert(name).second)
+		{
+			continue;
+		}
+
+		if(const cgfb::DirectoryEntry* entry = m_AssetFile.FindBlock(name))
+		{
+			entries.push_back(entry);
+		}
+
+		for(const std::string& dependency : GetDependencies(name))
+		{
+			unvisited.push_back(dependency);
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const cgfb::DirectoryEntry* a, const cgfb::DirectoryEntry* b)
+	{
+		return a->Offset < b->Offset;
+	});
+
+	m_AssetFile.Prefetch(entries);
+
+	size_t requested = 0;
+
+	// Requests of the same priority are decoded in the order they're made, i.e. file order
+	for(const cgfb::DirectoryEntry* entry : entries)
+	{
+		std::string name (m_AssetFile.GetBlockName(*entry));
+
+		switch(entry->Kind)
+		{
+		case cgfb::BlockKind::Material: GetAsync<Material>(name, priority); break;
+		case cgfb::BlockKind::Mesh: GetAsync<StaticMesh>(name, priority); break;
+		case cgfb::BlockKind::Texture: GetAsync<Texture2D>(name, priority); break;
+		default: continue;
+		}
+
+		requested++;
+	}
+
+	return requested;
+}
+
+
+std::span<const std::string> AssetLibrary::GetDependencies(const std::string& assetName) const
+{
+	auto dependencies = m_Dependencies.find(assetName);
+
+	if(dependencies == m_Dependencies.end())
+	{
+		return {};
+	}
+
+	return dependencies->second;
+}
+
+
+void AssetLibrary::ReadDependencies()
+{
+	cgfb::CgfbBlock block;
+
+	// Projects which don't declare any dependencies have no dependency table
+	if(!m_AssetFile.ReadBlock(cgfb::CGFB_DEPENDENCY_BLOCK, block))
+	{
+		return;
+	}
+
+	std::vector<cgfb::AssetDependencies> table;
+	cgfb::CgfbMemoryReader reader ( std::move(block) );
+
+	bool supported = cgfb::ReadDependencyTable(reader, &table);
+	CGF_ASSERT(supported, "The asset file's dependency table is in an unsupported format");
+
+	for(cgfb::AssetDependencies& entry : table)
+	{
+		m_Dependencies[std::move(entry.Name)] = std::move(entry.Dependencies);
+	}
+}
+
+
+void AssetLibrary::ProcessUploads()
+{
+	MemoryTagScope memoryTag (MemoryTag::Assets);
+
+	m_Cache.Trim();
+
+	Timer budgetTimer;
+
+	do
+	{
+		std::function<void()> upload;
+
+		{
+			std::lock_guard lock (m_UploadMutex);
+
+			if(m_UploadQueue.empty())
+			{
+				return;
+			}
+
+			upload = std::move(m_UploadQueue.front());
+			m_UploadQueue.pop_front();
+		}
+
+		upload();
+	}
+	while(budgetTimer.GetElapsed() < m_UploadBudget);
+}
+
+
+void AssetLibrary::QueueDecode(std::shared_ptr<StreamingRequest> request, int priority)
+{
+	request->Priority = priority;
+
+	{
+		std::lock_guard lock (m_QueueMutex);
+		m_DecodeQueue.push({ priority, m_NextSequence++, std::move(request) });
+
+		// Running decode jobs move on to the next request themselves
+		if(m_ConcurrentDecodes == m_MaxConcurrentDecodes)
+		{
+			return;
+		}
+
+		m_ConcurrentDecodes++;
+	}
+
+	m_Jobs.RunBackground([this]() { DecodeNext(); }, &m_DecodeJobs, "AssetDecode");
+}
+
+
+void AssetLibrary::DecodeNext()
+{
+	MemoryTagScope memoryTag (MemoryTag::Assets);
+
+	std::shared_ptr<StreamingRequest> request;
+
+	{
+		std::lock_guard lock (m_QueueMutex);
+
+		if(m_Stopping || m_DecodeQueue.empty())
+		{
+			m_ConcurrentDecodes--;
+			return;
+		}
+
+		request = m_DecodeQueue.top().Request;
+		m_DecodeQueue.pop();
+	}
+
+	// A request queued again with a greater priority leaves its earlier entry behind
+	if(!request->Claimed.exchange(true))
+	{
+		std::function<void()> upload = request->Decode();
+
+		std::lock_guard lock (m_UploadMutex);
+		m_UploadQueue.push_back(std::move(upload));
+	}
+
+	m_Jobs.RunBackground([this]() { DecodeNext(); }, &m_DecodeJobs, "AssetDecode");
+}
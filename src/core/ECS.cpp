@@ -0,0 +1,303 @@
+#include "core/ECS.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+
+namespace
+{
+
+std::mutex s_TypesMutex;
+std::atomic<uint32_t> s_TypeCount = 0;
+ComponentTypeInfo s_Types[CGF_MAX_COMPONENT_TYPES];
+
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+
+const ComponentTypeInfo& ComponentTypes::Get(uint32_t index)
+{
+	CGF_ASSERT(index < s_TypeCount, "No component type has been registered with this index");
+
+	return s_Types[index];
+}
+
+
+const ComponentTypeInfo& ComponentTypes::Register(ComponentTypeInfo info)
+{
+	std::lock_guard lock (s_TypesMutex);
+
+	CGF_ASSERT(s_TypeCount < CGF_MAX_COMPONENT_TYPES, "Too many component types; raise CGF_MAX_COMPONENT_TYPES");
+
+	info.Index = s_TypeCount;
+	s_Types[info.Index] = info;
+	s_TypeCount++;
+
+	return s_Types[info.Index];
+}
+
+
+Archetype::Archetype(const ComponentSignature& signature)
+	: m_Signature(signature)
+{
+	size_t rowSize = sizeof(Entity);
+	size_t alignmentSlack = 0;
+
+	// Chunks are at least cache line aligned, so no column straddles a line it doesn't need to
+	m_ChunkAlignment = 64;
+
+	for(uint32_t i = 0; i < CGF_MAX_COMPONENT_TYPES; i++)
+	{
+		if(!signature.test(i))
+		{
+			continue;
+		}
+
+		const ComponentTypeInfo& type = ComponentTypes::Get(i);
+
+		m_Types.push_back(i);
+		m_ComponentSizes[i] = type.Size;
+		m_ChunkAlignment = std::max(m_ChunkAlignment, type.Alignment);
+
+		rowSize += type.Size;
+		alignmentSlack += type.Alignment - 1;
+	}
+
+	// Types too large to fit a chunk get a chunk of their own per entity
+	m_ChunkCapacity = std::max<size_t>((CGF_CHUNK_SIZE - std::min(alignmentSlack, CGF_CHUNK_SIZE)) / rowSize, 1);
+
+	size_t offset = sizeof(Entity) * m_ChunkCapacity;
+
+	for(uint32_t type : m_Types)
+	{
+		offset = AlignUp(offset, ComponentTypes::Get(type).Alignment);
+		m_ColumnOffsets[type] = offset;
+		offset += (size_t)m_ComponentSizes[type] * m_ChunkCapacity;
+	}
+
+	m_ChunkSize = AlignUp(std::max(offset, CGF_CHUNK_SIZE), m_ChunkAlignment);
+}
+
+
+Archetype::~Archetype()
+{
+	for(uint32_t row = 0; row < m_EntityCount; row++)
+	{
+		for(uint32_t type : m_Types)
+		{
+			ComponentTypes::Get(type).Destroy(GetComponent(row, type));
+		}
+	}
+
+	for(ComponentChunk& chunk : m_Chunks)
+	{
+		::operator delete(chunk.Data, std::align_val_t(m_ChunkAlignment));
+	}
+}
+
+
+uint32_t Archetype::AllocateRow(Entity entity)
+{
+	if(m_Chunks.empty() || m_Chunks.back().Count == m_ChunkCapacity)
+	{
+		ComponentChunk& chunk = m_Chunks.emplace_back();
+		chunk.Data = (std::byte*)::operator new(m_ChunkSize, std::align_val_t(m_ChunkAlignment));
+	}
+
+	ComponentChunk& chunk = m_Chunks.back();
+	GetEntities(chunk)[chunk.Count] = entity;
+	chunk.Count++;
+
+	return m_EntityCount++;
+}
+
+
+Entity Archetype::RemoveRow(uint32_t row)
+{
+	const uint32_t last = m_EntityCount - 1;
+	Entity moved;
+
+	if(row != last)
+	{
+		for(uint32_t type : m_Types)
+		{
+			ComponentTypes::Get(type).Relocate(GetComponent(row, type), GetComponent(last, type));
+		}
+
+		moved = GetEntities(m_Chunks[last / m_ChunkCapacity])[last % m_ChunkCapacity];
+		GetEntities(m_Chunks[row / m_ChunkCapacity])[row % m_ChunkCapacity] = moved;
+	}
+
+	m_EntityCount--;
+
+	if(--m_Chunks.back().Count == 0)
+	{
+		::operator delete(m_Chunks.back().Data, std::align_val_t(m_ChunkAlignment));
+		m_Chunks.pop_back();
+	}
+
+	return moved;
+}
+
+
+EntityRegistry::EntityRegistry()
+{
+	// Entities without components live in the empty archetype
+	GetArchetype(ComponentSignature());
+}
+
+
+Entity EntityRegistry::Create()
+{
+	return CreateIn(m_ArchetypeList.front());
+}
+
+
+void EntityRegistry::Destroy(Entity entity)
+{
+	CGF_ASSERT(m_IterationDepth == 0, "Entities can't be destroyed while they're being iterated");
+
+	if(!IsAlive(entity))
+	{
+		return;
+	}
+
+	EntityRecord& record = m_Records[entity.Index];
+
+	for(uint32_t type : record.Storage->GetTypes())
+	{
+		ComponentTypes::Get(type).Destroy(record.Storage->GetComponent(record.Row, type));
+	}
+
+	Entity moved = record.Storage->RemoveRow(record.Row);
+
+	if(!moved.IsNull())
+	{
+		m_Records[moved.Index].Row = record.Row;
+	}
+
+	record.Storage = nullptr;
+	record.Generation++;
+
+	m_FreeIndices.push_back(entity.Index);
+	m_Count--;
+}
+
+
+bool EntityRegistry::IsAlive(Entity entity) const
+{
+	return entity.Index < m_Records.size()
+		&& m_Records[entity.Index].Storage
+		&& m_Records[entity.Index].Generation == entity.Generation;
+}
+
+
+Entity EntityRegistry::CreateIn(Archetype* archetype)
+{
+	CGF_ASSERT(m_IterationDepth == 0, "Entities can't be created while others are being iterated");
+
+	Entity entity;
+
+	if(m_FreeIndices.empty())
+	{
+		entity.Index = m_Records.size();
+		m_Records.emplace_back();
+	}
+	else
+	{
+		entity.Index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+
+	EntityRecord& record = m_Records[entity.Index];
+	entity.Generation = record.Generation;
+
+	record.Storage = archetype;
+	record.Row = archetype->AllocateRow(entity);
+
+	m_Count++;
+
+	return entity;
+}
+
+
+Archetype* EntityRegistry::GetArchetype(const ComponentSignature& signature)
+{
+	std::unique_ptr<Archetype>& archetype = m_Archetypes[signature];
+
+	if(!archetype)
+	{
+		archetype = std::make_unique<Archetype>(signature);
+		m_ArchetypeList.push_back(archetype.get());
+	}
+
+	return archetype.get();
+}
+
+
+Archetype* EntityRegistry::GetArchetypeWith(Archetype* archetype, uint32_t typeIndex)
+{
+	Archetype*& edge = archetype->AddEdges[typeIndex];
+
+	if(!edge)
+	{
+		edge = GetArchetype(ComponentSignature(archetype->GetSignature()).set(typeIndex));
+	}
+
+	return edge;
+}
+
+
+Archetype* EntityRegistry::GetArchetypeWithout(Archetype* archetype, uint32_t typeIndex)
+{
+	Archetype*& edge = archetype->RemoveEdges[typeIndex];
+
+	if(!edge)
+	{
+		edge = GetArchetype(ComponentSignature(archetype->GetSignature()).reset(typeIndex));
+	}
+
+	return edge;
+}
+
+
+void EntityRegistry::MoveEntity(Entity entity, Archetype* to)
+{
+	CGF_ASSERT(m_IterationDepth == 0, "Components can't be added or removed while entities are being iterated");
+
+	EntityRecord& record = m_Records[entity.Index];
+	Archetype* from = record.Storage;
+
+	const uint32_t fromRow = record.Row;
+	const uint32_t toRow = to->AllocateRow(entity);
+
+	for(uint32_t type : from->GetTypes())
+	{
+		const ComponentTypeInfo& info = ComponentTypes::Get(type);
+
+		if(to->Has(type))
+		{
+			info.Relocate(to->GetComponent(toRow, type), from->GetComponent(fromRow, type));
+		}
+		else
+		{
+			info.Destroy(from->GetComponent(fromRow, type));
+		}
+	}
+
+	Entity moved = from->RemoveRow(fromRow);
+
+	if(!moved.IsNull())
+	{
+		m_Records[moved.Index].Row = fromRow;
+	}
+
+	record.Storage = to;
+	record.Row = toRow;
+}
@@ -3,6 +3,8 @@
 #include "core/Window.h"
 #include "core/Scene.h"
 #include "core/Input.h"
+#include "core/Jobs.h"
+#include "core/Allocators.h"
 
 #include "graphics/Renderer.h"
 #include "graphics/Context.h"
@@ -12,7 +14,10 @@ GameBase::GameBase()
 {
 	Game = this;
 
-	m_AssetLibrary = new AssetLibrary("Content.cgfb");
+	// Created first, on the game thread, as every other subsystem may run jobs on it
+	m_JobSystem = new JobSystem;
+	m_FrameAllocator = new FrameAllocator;
+	m_AssetLibrary = new AssetLibrary("Content.cgfb", *m_JobSystem);
 	m_Window = new Window("cgf", 1920, 1080);
 	m_GraphicsContext = new GraphicsContext(m_Window);
 	m_Input = new Input(m_Window);
@@ -22,6 +27,26 @@ GameBase::GameBase()
 }
 
 
+GameBase::~GameBase()
+{
+	m_CurrentScene = nullptr;
+
+	// Assets hold GPU resources, so are released before the graphics context, and the library waits on
+	// its decode jobs, so before the job system
+	delete m_Renderer;
+	delete m_AssetLibrary;
+	delete m_Input;
+	delete m_GraphicsContext;
+	delete m_Window;
+	delete m_FrameAllocator;
+	delete m_JobSystem;
+
+	Game = nullptr;
+
+	ReportMemoryLeaks();
+}
+
+
 void GameBase::Start()
 {
 	m_CurrentScene->Start();
@@ -30,6 +55,8 @@ void GameBase::Start()
 
 void GameBase::Tick(double dT)
 {
+	m_FrameAllocator->BeginFrame();
+
 	static int frames = 0;
 	static double accum = 0.0;
 	frames++;
@@ -40,6 +67,17 @@ void GameBase::Tick(double dT)
 		int fps = frames / accum;
 
 		CGF_INFO(fps);
+		CGF_INFO("Heap allocations last frame: " + std::to_string(m_FrameAllocator->GetHeapAllocationsLastFrame()));
+
+#if ENABLE_MEMORY_TRACKING
+		for(size_t i = 0; i < (size_t)MemoryTag::Count; i++)
+		{
+			const MemoryTagStats stats = GetMemoryTagStats((MemoryTag)i);
+
+			CGF_INFO(std::string(GetMemoryTagName((MemoryTag)i)) + ": " + std::to_string(stats.LiveBytes) + " bytes live, "
+				+ std::to_string(stats.PeakBytes) + " at peak, " + std::to_string(m_FrameAllocator->GetHeapAllocationsLastFrame((MemoryTag)i)) + " allocations last frame");
+		}
+#endif
 		accum = 0.0;
 		frames = 0;
 	}
@@ -51,6 +89,7 @@ void GameBase::Tick(double dT)
 
 void GameBase::Render()
 {
+	m_AssetLibrary->ProcessUploads();
 	m_Renderer->Render();
 }
 
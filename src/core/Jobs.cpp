@@ -0,0 +1,387 @@
+#include "core/Jobs.h"
+
+
+namespace
+{
+
+// Identifies the thread within the job system running on it, if any, so its jobs go to its own deque
+thread_local const JobSystem* t_CurrentSystem = nullptr;
+thread_local unsigned int t_ThreadIndex = 0;
+
+}
+
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+	// One deque per worker, one for the creating thread and one for everyone else
+	for(unsigned int i = 0; i < workerCount + 2; i++)
+	{
+		m_Queues.push_back(std::make_unique<JobQueue>());
+	}
+
+	t_CurrentSystem = this;
+	t_ThreadIndex = 0;
+
+	for(unsigned int i = 1; i <= workerCount; i++)
+	{
+		m_Workers.emplace_back(&JobSystem::RunWorker, this, i);
+	}
+}
+
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard lock (m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_JobAvailable.notify_all();
+
+	for(std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+
+	if(t_CurrentSystem == this)
+	{
+		t_CurrentSystem = nullptr;
+	}
+}
+
+
+void JobSystem::Run(std::function<void()> task, JobCounter* counter, const char* name)
+{
+	if(counter)
+	{
+		counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Queue({ std::move(task), name, counter, false, GetMemoryTag() });
+}
+
+
+void JobSystem::RunBackground(std::function<void()> task, JobCounter* counter, const char* name)
+{
+	if(counter)
+	{
+		counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Queue({ std::move(task), name, counter, true, GetMemoryTag() });
+}
+
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> task, JobCounter* counter, const char* name)
+{
+	if(counter)
+	{
+		counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job job { std::move(task), name, counter, false, GetMemoryTag() };
+
+	{
+		// Finish() takes the lock after the count reaches zero, so either it sees this continuation or this sees zero
+		std::lock_guard lock (dependency.m_Mutex);
+
+		if(!dependency.IsDone())
+		{
+			dependency.m_Continuations.push_back(std::move(job));
+			return;
+		}
+	}
+
+	Queue(std::move(job));
+}
+
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	const unsigned int index = GetCurrentThreadIndex();
+	const bool background = m_Workers.empty();
+	Job job;
+
+	while(!counter.IsDone())
+	{
+		if(TryTakeJob(index, job, background))
+		{
+			Execute(job, index);
+			job = Job();
+		}
+		else
+		{
+			// The jobs left are running on other threads
+			std::this_thread::yield();
+		}
+	}
+
+	// The job that finished last may still be releasing the counter
+	std::lock_guard lock (counter.m_Mutex);
+}
+
+
+void JobSystem::ParallelForRange(size_t count, const std::function<void(size_t begin, size_t end)>& task, size_t minGrainSize, const char* name)
+{
+	if(count == 0)
+	{
+		return;
+	}
+
+	const size_t grainSize = std::max<size_t>(count / (GetThreadCount() * 4), std::max<size_t>(minGrainSize, 1));
+
+	if(count <= grainSize)
+	{
+		task(0, count);
+		return;
+	}
+
+	JobCounter counter;
+
+	// Jobs only capture the ranges and where theirs begins, which std::function stores without allocating.
+	// Both are only used by jobs counted by counter, which this waits on before returning.
+	struct Ranges
+	{
+		const std::function<void(size_t begin, size_t end)>& Task;
+		size_t GrainSize;
+		size_t Count;
+	};
+
+	const Ranges ranges { task, grainSize, count };
+
+	// The first range runs on this thread, which would otherwise only start on it once it waits
+	for(size_t begin = grainSize; begin < count; begin += grainSize)
+	{
+		Run([&ranges, begin]() { ranges.Task(begin, std::min(begin + ranges.GrainSize, ranges.Count)); }, &counter, name);
+	}
+
+	task(0, grainSize);
+
+	Wait(counter);
+}
+
+
+void JobSystem::ParallelFor(size_t count, const std::function<void(size_t)>& task, size_t minGrainSize, const char* name)
+{
+	ParallelForRange(count, [&task](size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			task(i);
+		}
+	}, minGrainSize, name);
+}
+
+
+unsigned int JobSystem::GetCurrentThreadIndex() const
+{
+	return t_CurrentSystem == this ? t_ThreadIndex : GetThreadCount();
+}
+
+
+void JobSystem::Queue(Job job)
+{
+	JobQueue& queue = job.Background ? m_BackgroundQueue : *m_Queues[GetCurrentThreadIndex()];
+
+	// Counted under the queue's lock, which the job has to be taken under, so it's never uncounted first
+	{
+		std::lock_guard lock (queue.Mutex);
+		queue.PushBack(std::move(job));
+		m_QueuedCount++;
+	}
+
+	// A worker counts itself as sleeping before it checks for jobs, so either it sees this job or it's
+	// counted here, in which case taking the lock waits until it's actually waiting to be notified
+	if(m_SleepingCount > 0)
+	{
+		{
+			std::lock_guard lock (m_Mutex);
+		}
+
+		m_JobAvailable.notify_one();
+	}
+}
+
+
+void JobSystem::RunWorker(unsigned int index)
+{
+	t_CurrentSystem = this;
+	t_ThreadIndex = index;
+
+	Job job;
+
+	while(true)
+	{
+		if(TryTakeJob(index, job, true))
+		{
+			Execute(job, index);
+			job = Job();
+
+			continue;
+		}
+
+		const JobProfilerHooks* hooks = m_Hooks.load(std::memory_order_acquire);
+
+		if(hooks && hooks->OnWorkerIdle)
+		{
+			hooks->OnWorkerIdle(index, true);
+		}
+
+		bool stopped;
+
+		{
+			std::unique_lock lock (m_Mutex);
+
+			m_SleepingCount++;
+			m_JobAvailable.wait(lock, [this]() { return m_Stopping || m_QueuedCount > 0; });
+			m_SleepingCount--;
+
+			stopped = m_Stopping && m_QueuedCount == 0;
+		}
+
+		if(hooks && hooks->OnWorkerIdle)
+		{
+			hooks->OnWorkerIdle(index, false);
+		}
+
+		if(stopped)
+		{
+			return;
+		}
+	}
+}
+
+
+bool JobSystem::TryTakeJob(unsigned int index, Job& job, bool background)
+{
+	const size_t queueCount = m_Queues.size();
+
+	for(size_t i = 0; i < queueCount; i++)
+	{
+		JobQueue& queue = *m_Queues[(index + i) % queueCount];
+		std::lock_guard lock (queue.Mutex);
+
+		if(queue.IsEmpty())
+		{
+			continue;
+		}
+
+		job = i == 0 ? queue.PopBack() : queue.PopFront();
+
+		m_QueuedCount--;
+		return true;
+	}
+
+	if(background)
+	{
+		std::lock_guard lock (m_BackgroundQueue.Mutex);
+
+		if(!m_BackgroundQueue.IsEmpty())
+		{
+			job = m_BackgroundQueue.PopFront();
+
+			m_QueuedCount--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void JobSystem::Execute(Job& job, unsigned int thread)
+{
+	const JobProfilerHooks* hooks = m_Hooks.load(std::memory_order_acquire);
+
+	if(hooks && hooks->OnJobBegin)
+	{
+		hooks->OnJobBegin(job.Name, thread);
+	}
+
+	{
+		MemoryTagScope memoryTag (job.Tag);
+
+		job.Task();
+	}
+
+	if(hooks && hooks->OnJobEnd)
+	{
+		hooks->OnJobEnd(job.Name, thread);
+	}
+
+	if(job.Counter)
+	{
+		Finish(*job.Counter);
+	}
+}
+
+
+void JobSystem::Finish(JobCounter& counter)
+{
+	uint32_t pending = counter.m_Pending.load(std::memory_order_relaxed);
+
+	// Only the job taking the count to zero touches the counter after decrementing it, and does so under
+	// its lock, which Wait() takes before returning, so a counter can't be freed while it's in use
+	while(pending > 1)
+	{
+		if(counter.m_Pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return;
+		}
+	}
+
+	std::vector<Job> continuations;
+
+	{
+		std::lock_guard lock (counter.m_Mutex);
+
+		if(counter.m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			continuations.swap(counter.m_Continuations);
+		}
+	}
+
+	for(Job& continuation : continuations)
+	{
+		Queue(std::move(continuation));
+	}
+}
+
+
+void JobSystem::JobQueue::PushBack(Job&& job)
+{
+	if(Count == Jobs.size())
+	{
+		std::vector<Job> grown (std::max<size_t>(Jobs.size() * 2, 64));
+
+		for(size_t i = 0; i < Count; i++)
+		{
+			grown[i] = std::move(Jobs[(Head + i) & (Jobs.size() - 1)]);
+		}
+
+		Jobs.swap(grown);
+		Head = 0;
+	}
+
+	Jobs[(Head + Count) & (Jobs.size() - 1)] = std::move(job);
+	Count++;
+}
+
+
+Job JobSystem::JobQueue::PopBack()
+{
+	Count--;
+
+	return std::move(Jobs[(Head + Count) & (Jobs.size() - 1)]);
+}
+
+
+Job JobSystem::JobQueue::PopFront()
+{
+	Job job = std::move(Jobs[Head]);
+
+	Head = (Head + 1) & (Jobs.size() - 1);
+	Count--;
+
+	return job;
+}
@@ -1,2 +1,51 @@
 #include "core/Memory.h"
-#include "core/Events.h"
\ No newline at end of file
+#include "core/Events.h"
+#include "core/Allocators.h"
+
+
+Notifier* SharedControlBlock::GetDestructionEvent()
+{
+	Notifier* event = OnDestruction.load(std::memory_order_acquire);
+
+	if(event)
+	{
+		return event;
+	}
+
+	// Threads asking at once may each allocate an event, but only one of them is kept
+	MemoryTagScope memoryTag (MemoryTag::Events);
+	Notifier* created = new Notifier;
+
+	if(OnDestruction.compare_exchange_strong(event, created, std::memory_order_acq_rel))
+	{
+		return created;
+	}
+
+	delete created;
+	return event;
+}
+
+
+void SharedControlBlock::ReleaseLast()
+{
+	// Pairs with the release of every other reference, so their uses of the object happen before this
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	CGF_LOG_TRACE(Name, "Destroyed ref");
+
+	if(Notifier* event = OnDestruction.load(std::memory_order_relaxed))
+	{
+		event->Invoke();
+		delete event;
+	}
+
+	// Blocks without a Free are part of their object, so are gone once it's destroyed
+	const bool weaklyReferenceable = Free;
+
+	Destroy(this);
+
+	if(weaklyReferenceable)
+	{
+		DecrementWeakCnt();
+	}
+}
@@ -1,17 +1,33 @@
 #include "core/Scene.h"
+#include "core/Game.h"
+#include "core/Jobs.h"
+#include "core/Allocators.h"
 
 
 Scene::Scene()
 {
+	MemoryTagScope memoryTag (MemoryTag::Scene);
+
 	CurrentCamera = SharedPtr<Camera>::Create(true, 70.f, 1920.f, 1080.f);
 	AddActor(CurrentCamera);
 }
 
 
+Scene::~Scene()
+{
+	for(Actor* actor : m_AttachedActors)
+	{
+		actor->AttachTo(nullptr);
+	}
+}
+
+
 void Scene::Start()
 {
 	CGF_ASSERT(!m_InPlay, "Scene cannot be started twice");
 
+	MemoryTagScope memoryTag (MemoryTag::Scene);
+
 	m_InPlay = true;
 
 	OnStartActors.Invoke();
@@ -20,8 +36,10 @@ void Scene::Start()
 
 void Scene::Tick(double dT)
 {
-	OnTickActors.Invoke(dT);
-}
+	MemoryTagScope memoryTag (MemoryTag::Scene);
 
+	OnTickActors.Invoke(dT);
 
-int SceneTypeInfo::TypeCount;
\ No newline at end of file
+	// Actors tick on the game thread, so systems see the state they left behind this frame
+	Systems.Run(Entities, dT, *Game->GetJobSystem());
+}
\ No newline at end of file
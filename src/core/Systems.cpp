@@ -0,0 +1,129 @@
+#include "core/Systems.h"
+#include "core/Allocators.h"
+
+#include <atomic>
+
+
+void SystemContext::Defer(std::function<void(EntityRegistry&)> command)
+{
+	std::lock_guard lock (*m_CommandsMutex);
+
+	m_Commands->push_back(std::move(command));
+}
+
+
+void SystemScheduler::AddSystem(std::unique_ptr<System> system)
+{
+	SystemNode& node = m_Nodes.emplace_back();
+	node.Instance = std::move(system);
+	node.Instance->DeclareAccess(node.Access);
+
+	m_GraphDirty = true;
+}
+
+
+void SystemScheduler::BuildGraph()
+{
+	for(SystemNode& node : m_Nodes)
+	{
+		node.Dependents.clear();
+		node.DependencyCount = 0;
+	}
+
+	// Edges only run from earlier systems to later ones, so the graph can't have cycles
+	for(size_t later = 0; later < m_Nodes.size(); later++)
+	{
+		for(size_t earlier = 0; earlier < later; earlier++)
+		{
+			if(m_Nodes[earlier].Access.ConflictsWith(m_Nodes[later].Access))
+			{
+				m_Nodes[earlier].Dependents.push_back(later);
+				m_Nodes[later].DependencyCount++;
+			}
+		}
+	}
+
+	m_GraphDirty = false;
+}
+
+
+void SystemScheduler::Run(EntityRegistry& entities, double deltaTime, JobSystem& jobs)
+{
+	if(m_Nodes.empty())
+	{
+		return;
+	}
+
+	if(m_GraphDirty)
+	{
+		BuildGraph();
+	}
+
+	ScratchScope scratch;
+
+	// Holds everything a system's job needs, so jobs only capture it and an index, which std::function
+	// stores without allocating
+	struct Frame
+	{
+		void Schedule(size_t index)
+		{
+			Jobs.Run([this, index]()
+			{
+				SystemNode& node = Nodes[index];
+
+				SystemContext context (Entities, Jobs, node.Access, DeltaTime);
+				context.m_CommandsMutex = CommandsMutex;
+				context.m_Commands = &node.Commands;
+
+				node.Instance->Update(context);
+
+				// Dependents join the frame's counter before this system leaves it, so Wait() can't return early
+				for(size_t dependent : node.Dependents)
+				{
+					if(--Remaining[dependent] == 0)
+					{
+						Schedule(dependent);
+					}
+				}
+			}, &Counter, "System");
+		}
+
+		std::vector<SystemNode>& Nodes;
+		EntityRegistry& Entities;
+		JobSystem& Jobs;
+		double DeltaTime;
+		std::mutex* CommandsMutex;
+		ArenaVector<std::atomic<size_t>> Remaining;
+		JobCounter Counter;
+	};
+
+	Frame frame { m_Nodes, entities, jobs, deltaTime, &m_CommandsMutex, ArenaVector<std::atomic<size_t>>(m_Nodes.size(), scratch) };
+
+	for(size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		frame.Remaining[i] = m_Nodes[i].DependencyCount;
+	}
+
+	for(size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		if(m_Nodes[i].DependencyCount == 0)
+		{
+			frame.Schedule(i);
+		}
+	}
+
+	// The game thread runs systems too while it waits
+	jobs.Wait(frame.Counter);
+
+	// Systems' commands are applied in the order the systems were added, so the result doesn't depend on
+	// which of them happened to finish first
+	for(SystemNode& node : m_Nodes)
+	{
+		for(auto& command : node.Commands)
+		{
+			command(entities);
+		}
+
+		node.Commands.clear();
+	}
+}
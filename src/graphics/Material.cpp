@@ -19,7 +19,56 @@ Material::Material(std::shared_ptr<Shader> vs, std::shared_ptr<Shader> ps, Mater
 }
 
 
-RefCntAutoPtr<IPipelineState> Material::BuildPipeline()
+std::vector<LayoutElement> Material::GetVertexLayout(const cgfb::VertexFormat& format) const
+{
+	if(format == cgfb::VertexFormat())
+	{
+		return m_VertexLayout;
+	}
+
+	std::vector<LayoutElement> layout;
+
+	switch(format.Position)
+	{
+	case cgfb::PositionFormat::Unorm16x4: layout.push_back(LayoutElement("POSITION", 0, 0, 4, VT_UINT16, True)); break;
+	default: layout.push_back(LayoutElement("POSITION", 0, 0, 3, VT_FLOAT32)); break;
+	}
+
+	switch(format.Normal)
+	{
+	case cgfb::NormalFormat::Snorm8x4: layout.push_back(LayoutElement("NORMAL", 0, 0, 4, VT_INT8, True)); break;
+	case cgfb::NormalFormat::Oct16: layout.push_back(LayoutElement("NORMAL", 0, 0, 2, VT_INT16, True)); break;
+	default: layout.push_back(LayoutElement("NORMAL", 0, 0, 3, VT_FLOAT32)); break;
+	}
+
+	switch(format.UV0)
+	{
+	case cgfb::UVFormat::Half2: layout.push_back(LayoutElement("TEXCOORD", 0, 0, 2, VT_FLOAT16)); break;
+	default: layout.push_back(LayoutElement("TEXCOORD", 0, 0, 2, VT_FLOAT32)); break;
+	}
+
+	return layout;
+}
+
+
+std::shared_ptr<Shader> Material::GetVertexShader(const cgfb::VertexFormat& format)
+{
+	// Octahedral normals can't be unpacked by the input assembler, so shaders decode them when CGF_NORMAL_OCT16 is defined
+	if(format.Normal != cgfb::NormalFormat::Oct16)
+	{
+		return m_VertexShader;
+	}
+
+	if(!m_OctNormalVertexShader)
+	{
+		m_OctNormalVertexShader = m_VertexShader->CreateVariant({ "CGF_NORMAL_OCT16" });
+	}
+
+	return m_OctNormalVertexShader;
+}
+
+
+RefCntAutoPtr<IPipelineState> Material::BuildPipeline(const cgfb::VertexFormat& format)
 {
 	GraphicsPipelineStateCreateInfo PSOCreateInfo;
 	PSOCreateInfo.PSODesc.Name = "Material Pipeline";
@@ -78,9 +127,12 @@ RefCntAutoPtr<IPipelineState> Material::BuildPipeline()
 		PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthWriteEnable = false;
 	}
 
-	PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = m_VertexLayout.data();
-	PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements = m_VertexLayout.size();
-	PSOCreateInfo.pVS = m_VertexShader->GetHandle();
+	std::vector<LayoutElement> vertexLayout = GetVertexLayout(format);
+	std::shared_ptr<Shader> vertexShader = GetVertexShader(format);
+
+	PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = vertexLayout.data();
+	PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements = vertexLayout.size();
+	PSOCreateInfo.pVS = vertexShader->GetHandle();
 	PSOCreateInfo.pPS = m_PixelShader->GetHandle();
 
 	RefCntAutoPtr<IPipelineState> pipelineState;
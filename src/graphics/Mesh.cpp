@@ -17,10 +17,41 @@ BaseMesh::BaseMesh(unsigned int indexCount, RefCntAutoPtr<IBuffer> indexBuffer,
 }
 
 
-StaticMesh::StaticMesh(unsigned int indexCount, RefCntAutoPtr<IBuffer> indexBuffer, RefCntAutoPtr<IBuffer> vertexBuffer)
-	: BaseMesh(indexCount, indexBuffer, vertexBuffer)
+uint64_t BaseMesh::GetCpuMemorySize() const
+{
+	uint64_t size = sizeof(*this);
+
+	for(const MeshLod& lod : m_Layout.Lods)
+	{
+		size += sizeof(MeshLod) + lod.Submeshes.size() * sizeof(Submesh);
+	}
+
+	return size;
+}
+
+
+uint64_t BaseMesh::GetGpuMemorySize() const
 {
+	uint64_t size = 0;
+
+	if(m_IndexBuffer)
+	{
+		size += m_IndexBuffer->GetDesc().Size;
+	}
+
+	if(m_VertexBuffer)
+	{
+		size += m_VertexBuffer->GetDesc().Size;
+	}
 
+	return size;
+}
+
+
+StaticMesh::StaticMesh(unsigned int indexCount, MeshLayout layout, RefCntAutoPtr<IBuffer> indexBuffer, RefCntAutoPtr<IBuffer> vertexBuffer)
+	: BaseMesh(indexCount, indexBuffer, vertexBuffer)
+{
+	m_Layout = std::move(layout);
 }
 
 
@@ -1,4 +1,5 @@
 #include <chrono>
+#include <algorithm>
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
@@ -6,6 +7,8 @@
 #include "core/Window.h"
 #include "core/Scene.h"
 #include "core/Camera.h"
+#include "core/Jobs.h"
+#include "core/Allocators.h"
 
 #include "graphics/Renderer.h"
 #include "graphics/Context.h"
@@ -13,14 +16,90 @@
 #include "graphics/Diligent.h"
 
 
+namespace
+{
+
+/**
+ * @brief Extracts the planes bounding the clip space of a projection-view matrix, in world space, with
+ * their normals facing inwards and normalized so that distances to them are in world units
+ */
+std::array<glm::vec4, 6> GetFrustumPlanes(const glm::mat4& pv)
+{
+	const glm::vec4 row0 (pv[0][0], pv[1][0], pv[2][0], pv[3][0]);
+	const glm::vec4 row1 (pv[0][1], pv[1][1], pv[2][1], pv[3][1]);
+	const glm::vec4 row2 (pv[0][2], pv[1][2], pv[2][2], pv[3][2]);
+	const glm::vec4 row3 (pv[0][3], pv[1][3], pv[2][3], pv[3][3]);
+
+	// The near plane is taken at -w, which is conservative for projections whose depth starts at 0
+	std::array<glm::vec4, 6> planes
+	{
+		row3 + row0, row3 - row0,
+		row3 + row1, row3 - row1,
+		row3 + row2, row3 - row2,
+	};
+
+	for(glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
+
+}
+
+
 void RenderGraphBuilder::QueuePass(SharedPtr<RenderPass> pass)
 {
 	
 }
 
 
+void PrimitiveRenderState::SelectLod(const glm::mat4& view, const glm::mat4& projection)
+{
+	if(Mesh->GetLodCount() < 2)
+	{
+		Lod = 0;
+		return;
+	}
+
+	glm::vec3 center = view * Transform * glm::vec4(Mesh->GetBoundsCenter(), 1.0f);
+
+	const float scale = std::max({ glm::length(glm::vec3(Transform[0])), glm::length(glm::vec3(Transform[1])), glm::length(glm::vec3(Transform[2])) });
+	const float radius = Mesh->GetBoundsRadius() * scale;
+
+	// Perspective projections shrink the sphere with distance, while orthographic ones (whose last column is (0, 0, 0, 1)) don't
+	const float distance = projection[3][3] == 0.0f ? std::max(glm::length(center), radius) : 1.0f;
+	const float screenSize = radius * projection[1][1] / distance;
+
+	Lod = Mesh->SelectLod(screenSize);
+}
+
+
+void PrimitiveRenderState::UpdateVisibility(const std::array<glm::vec4, 6>& frustum)
+{
+	if(Mesh->GetBoundsRadius() <= 0.0f)
+	{
+		Visible = true;
+		return;
+	}
+
+	const glm::vec3 center = Transform * glm::vec4(Mesh->GetBoundsCenter(), 1.0f);
+
+	const float scale = std::max({ glm::length(glm::vec3(Transform[0])), glm::length(glm::vec3(Transform[1])), glm::length(glm::vec3(Transform[2])) });
+	const float radius = Mesh->GetBoundsRadius() * scale;
+
+	Visible = std::all_of(frustum.begin(), frustum.end(), [&](const glm::vec4& plane)
+	{
+		return glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+	});
+}
+
+
 void Renderer::Render()
 {
+	MemoryTagScope memoryTag (MemoryTag::Render);
+
 	const float ClearColor[] = { 0.f, 0.f, 0.f, 1.0f };
 
 	GraphicsContext* ctx = Game->GetGraphicsContext();
@@ -40,11 +119,32 @@ void Renderer::Render()
 
 void Renderer::Draw(Pool<PrimitiveRenderState>& meshDrawList)
 {
-	SharedPtr<Camera> camera = Game->GetCurrentScene()->CurrentCamera;
-	glm::mat4 pv = camera->Projection * camera->Transform.GetViewMatrix();
-	
+	const SharedPtr<Camera>& camera = Game->GetCurrentScene()->CurrentCamera;
+	glm::mat4 view = camera->Transform.GetViewMatrix();
+	glm::mat4 pv = camera->Projection * view;
+
+	const std::array<glm::vec4, 6> frustum = GetFrustumPlanes(pv);
+
+	// Each primitive's visibility and level of detail only depend on itself and the camera, so they're
+	// worked out across every thread before drawing, which has to happen on this one
+	Game->GetJobSystem()->ParallelFor(meshDrawList.GetCount(), [&](size_t i)
+	{
+		PrimitiveRenderState& info = meshDrawList[i];
+		info.UpdateVisibility(frustum);
+
+		if(info.Visible)
+		{
+			info.SelectLod(view, camera->Projection);
+		}
+	}, 256, "Cull");
+
 	for(PrimitiveRenderState& info : meshDrawList)
 	{
+		if(!info.Visible)
+		{
+			continue;
+		}
+
 		IBuffer* vbuffers[] = { info.Mesh->GetVertexBuffer() };
 
 		GraphicsContext* ctx = Game->GetGraphicsContext();
@@ -52,9 +152,9 @@ void Renderer::Draw(Pool<PrimitiveRenderState>& meshDrawList)
 		ctx->GetDeviceContext()->SetVertexBuffers(0, 1, vbuffers, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
 		ctx->GetDeviceContext()->SetIndexBuffer(info.Mesh->GetIndexBuffer(), 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 		
-		ctx->UsePipeline(info.DrawMaterial->GetBaseMaterial()->GetPipelineState());
+		ctx->UsePipeline(info.DrawMaterial->GetBaseMaterial()->GetPipelineState(info.Mesh->GetVertexFormat()));
 
-		glm::mat4 pvm = pv * info.Transform;
+		glm::mat4 pvm = pv * info.Transform * info.Mesh->GetPositionTransform();
 		ShaderCommonData data;
 		std::memcpy(data.Model, glm::value_ptr(info.Transform), sizeof(data.Model));
 		std::memcpy(data.MVP, glm::value_ptr(pvm), sizeof(data.MVP));
@@ -64,14 +164,31 @@ void Renderer::Draw(Pool<PrimitiveRenderState>& meshDrawList)
 		ctx->GetDeviceContext()->CommitShaderResources(info.DrawMaterial->GetResourceBinding(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
 		DrawIndexedAttribs drawAttrs;
-		drawAttrs.NumIndices = info.Mesh->GetIndexCount();
-		drawAttrs.IndexType = VT_UINT32;
-		ctx->GetDeviceContext()->DrawIndexed(drawAttrs);
+		drawAttrs.IndexType = info.Mesh->GetIndexType();
+
+		const std::vector<Submesh>& submeshes = info.Mesh->GetSubmeshes(info.Lod);
+
+		if(submeshes.empty())
+		{
+			drawAttrs.NumIndices = info.Mesh->GetIndexCount();
+			ctx->GetDeviceContext()->DrawIndexed(drawAttrs);
+
+			continue;
+		}
+
+		// Submeshes share the buffers and resources bound above, so each only costs a draw call
+		for(const Submesh& submesh : submeshes)
+		{
+			drawAttrs.NumIndices = submesh.IndexCount;
+			drawAttrs.FirstIndexLocation = submesh.FirstIndex;
+			drawAttrs.BaseVertex = submesh.BaseVertex;
+			ctx->GetDeviceContext()->DrawIndexed(drawAttrs);
+		}
 	}
 }
 
 
-void Renderer::Draw(SharedPtr<Scene> scene)
+void Renderer::Draw(const SharedPtr<Scene>& scene)
 {
 	Draw(scene->PrimitiveRenderStates);
 }
\ No newline at end of file
@@ -15,7 +15,7 @@ Shader::Shader(std::string name,
 			   SHADER_TYPE type,
 			   std::string entryPoint,
 			   SHADER_SOURCE_LANGUAGE sourceLanguage)
-	: m_ShaderType(type)
+	: m_Name(name), m_Source(source), m_SourceLanguage(sourceLanguage), m_ShaderType(type)
 {
 	ShaderCreateInfo info;
 	info.Desc.Name = name.c_str();
@@ -34,4 +34,19 @@ Shader::Shader(std::string name, std::string& source, SHADER_TYPE type, SHADER_S
 	: Shader(name, source, type, "Main", sourceLanguage)
 {	
 	
+}
+
+
+std::shared_ptr<Shader> Shader::CreateVariant(const std::vector<std::string>& defines) const
+{
+	std::string source;
+
+	for(const std::string& define : defines)
+	{
+		source += "#define " + define + " 1\n";
+	}
+
+	source += m_Source;
+
+	return std::make_shared<Shader>(m_Name, source, m_ShaderType, m_SourceLanguage);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "graphics/Texture.h"
 
+#include <algorithm>
+
 #include "core/Game.h"
 
 
@@ -10,22 +12,57 @@ Texture2D::Texture2D(std::string name,
 	const void* data,
 	int dataStride)
 {
+	TextureSubResData resData;
+	resData.pData = data;
+	resData.Stride = dataStride * width;
+	resData.DepthStride = 0;
+
+	CreateHandle(name, width, height, format, std::span<TextureSubResData>(&resData, 1));
+}
+
+
+Texture2D::Texture2D(std::string name, 
+	unsigned int width, 
+	unsigned int height, 
+	TEXTURE_FORMAT format,
+	std::span<TextureSubResData> mips)
+{
+	CreateHandle(name, width, height, format, mips);
+}
+
+
+void Texture2D::CreateHandle(const std::string& name, 
+	unsigned int width, 
+	unsigned int height, 
+	TEXTURE_FORMAT format,
+	std::span<TextureSubResData> mips)
+{
+	m_Width = width;
+	m_Height = height;
+
+	// Rows of block compressed mip levels are rows of 4x4 blocks
+	const bool blockCompressed = format >= TEX_FORMAT_BC1_TYPELESS && format <= TEX_FORMAT_BC7_UNORM_SRGB;
+
+	for(size_t i = 0; i < mips.size(); i++)
+	{
+		const unsigned int mipHeight = std::max(height >> i, 1u);
+
+		m_GpuMemorySize += mips[i].Stride * (blockCompressed ? (mipHeight + 3) / 4 : mipHeight);
+	}
+
 	TextureDesc textureDesc;
 	textureDesc.Width = width;
 	textureDesc.Height = height;
 	textureDesc.Name = name.c_str();
 	textureDesc.Format = format;
+	textureDesc.MipLevels = mips.size();
 	textureDesc.Type = RESOURCE_DIMENSION::RESOURCE_DIM_TEX_2D;
 	textureDesc.BindFlags = BIND_SHADER_RESOURCE;
-
-	TextureSubResData resData;
-	resData.pData = data;
-	resData.Stride = dataStride * width;
-	resData.DepthStride = 0;
+	textureDesc.Usage = USAGE_IMMUTABLE;
 
 	TextureData texData;
-	texData.pSubResources = &resData;
-	texData.NumSubresources = 1;
+	texData.pSubResources = mips.data();
+	texData.NumSubresources = mips.size();
 
 	Game->GetGraphicsContext()->GetRenderDevice()->CreateTexture(textureDesc, &texData, &m_Handle);
-}
\ No newline at end of file
+}